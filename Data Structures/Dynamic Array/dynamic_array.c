@@ -13,13 +13,6 @@
 
 #include "dynamic_array.h"
 
-/*******************************************************************************
-* macro: hsize
-* purpose: size of struct darray_header, typically 16 bytes
-*******************************************************************************/
-
-#define HSIZE sizeof(struct darray_header)
-
 /*******************************************************************************
 * macro: darray_header_var
 * purpose: get a pointer to darray_header given a pointer to the data member
@@ -35,6 +28,18 @@
 *******************************************************************************/
 
 darray darray_create(size_t init_capacity, void (*destroy)(void *ptr))
+{
+    return darray_create_with(init_capacity, destroy, NULL);
+}
+
+/******************************************************************************/
+
+darray darray_create_with
+(
+    size_t init_capacity,
+    void (*destroy)(void *ptr),
+    const struct allocator *alloc
+)
 {
     struct darray_header *dh;
     
@@ -43,16 +48,22 @@ darray darray_create(size_t init_capacity, void (*destroy)(void *ptr))
     assert(destroy != NULL && "destroy function is null");
 
     //allocate memory for header + flexible array member
-    dh = malloc(HSIZE + sizeof(array_item) * init_capacity);
+    dh = ALLOCATOR_ALLOC(alloc, DARRAY_BYTES(init_capacity));
     if (dh == NULL) return NULL;
     
     //allocate memory for the queue pocket at the front of metadata   
-    dh->queue = malloc(sizeof(array_item));
-    if (dh->queue == NULL) return NULL;
+    dh->queue = ALLOCATOR_ALLOC(alloc, sizeof(array_item));
+    
+    if (dh->queue == NULL)
+    {
+        ALLOCATOR_RELEASE(alloc, dh, DARRAY_BYTES(init_capacity));
+        return NULL;
+    }
     
     //define remaining header metadata
     dh->cache = NULL;
     dh->destroy = destroy;
+    dh->alloc = alloc;
     dh->capacity = init_capacity;
     dh->count = 0;
     
@@ -76,8 +87,8 @@ void darray_destroy(darray d)
     
     if (dh->destroy == free)
     {
-        free(dh->queue);
-        free(dh);
+        ALLOCATOR_RELEASE(dh->alloc, dh->queue, sizeof(array_item));
+        ALLOCATOR_RELEASE(dh->alloc, dh, DARRAY_BYTES(dh->capacity));
     }
     else
     {
@@ -123,10 +134,11 @@ int darray_append(darray *d, array_item element)
             assert(new_capacity > dh->count && "capacity fx not monotonic");
 
             //determine total bytes needed
-            size_t new_size = HSIZE + sizeof(array_item) * new_capacity;
+            size_t old_size = DARRAY_BYTES(dh->capacity);
+            size_t new_size = DARRAY_BYTES(new_capacity);
 
             //reallocate memory and redirect dh pointer
-            struct darray_header *tmp = realloc(dh, new_size);
+            struct darray_header *tmp = ALLOCATOR_RESIZE(dh->alloc, dh, old_size, new_size);
             
             if (tmp == NULL) return 2;
             else dh = tmp;
@@ -11,6 +11,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "../../Memory/allocator.h"
+
 /*******************************************************************************
 * user-modifiable parameters
 * @ array_item : data type of item stored in array, set void* for a generic ADT
@@ -34,25 +36,26 @@ typedef array_item *darray;
 * @ cache : an empty void pointer pocket for any strange end-user needs
 * @ queue : pointer to popleft array items to allow implementation details
 * @ destroy : pointer to function, used during destructor call to free memory
+* @ alloc : allocator of the header, array and queue, null for the C library
 * @ capacity : maximum size of array
 * @ count : number of elements held in array
 * @ data : contents of the array
 *
 * note: For most standard array_items, those that appear in powers of 2, this 
 *       structure should remain fairly space-efficent because the header
-*       will pack to exactly 32 bytes and the malloc for the FLA will not
+*       will pack to exactly 40 bytes and the malloc for the FLA will not
 *       overcommit memory. There won't be a problem if you use a data type which
 *       overrides the packing, but you will possibly have extra padding within
 *       the header and after the data array. 
 *
 * diagram:
 *
-*   #---------#---------#-----------#------------#---------#-----------------#
-*   #  cache  #  queue  #  destroy  #  capacity  #  count  #  data --------> #
-*   #---------#---------#-----------#------------#---------#-----------------#
+*   #-------#-------#---------#-------#----------#-------#-----------------#
+*   # cache # queue # destroy # alloc # capacity # count #  data --------> #
+*   #-------#-------#---------#-------#----------#-------#-----------------#
 *
-*   \_____________________________________________________/ \________________/
-*                        hidden metadata                       exposed array
+*   \_____________________________________________________/ \______________/
+*                        hidden metadata                      exposed array
 *               
 *
 * note: The client does not need to interact with this structure or declare any
@@ -81,6 +84,12 @@ typedef array_item *darray;
 *           free(dh);
 *       }
 *
+*       A darray from darray_create_with() must instead hand the queue and the
+*       header back to its allocator, with the sizes they were allocated at:
+*
+*       ALLOCATOR_RELEASE(dh->alloc, dh->queue, sizeof(array_item));
+*       ALLOCATOR_RELEASE(dh->alloc, dh, DARRAY_BYTES(dh->capacity));
+*
 *******************************************************************************/
 
 struct darray_header
@@ -88,11 +97,19 @@ struct darray_header
     void *cache;
     array_item *queue;
     void (*destroy)(void *ptr);
+    const struct allocator *alloc;
     uint32_t capacity;
     uint32_t count;
     array_item data[];
 };
 
+/*******************************************************************************
+* macro: DARRAY_BYTES
+* purpose: byte-size of the header block of a darray with the given capacity
+*******************************************************************************/
+#define DARRAY_BYTES(capacity)                                                 \
+        (sizeof(struct darray_header) + sizeof(array_item) * (capacity))
+
 /*******************************************************************************
 * public function: darray_create
 * purpose: constructor
@@ -104,6 +121,23 @@ struct darray_header
 *******************************************************************************/
 darray darray_create(size_t init_capacity, void (*destroy)(void *ptr));
 
+/*******************************************************************************
+* public function: darray_create_with
+* purpose: constructor, the array and its metadata come from an allocator
+* @ init_capacity : initial capacity of array
+* @ destroy : pointer to function, used during destructor call to free memory.
+*             if a custom implementation is not needed, just pass stdlib free()
+*             and the header returns to the allocator on its own.
+* @ alloc : allocator, see Memory/allocator.h. Null for the C library.
+* returns: darray, NULL if the allocator failed.
+*******************************************************************************/
+darray darray_create_with
+(
+    size_t init_capacity,
+    void (*destroy)(void *ptr),
+    const struct allocator *alloc
+);
+
 /*******************************************************************************
 * public function: darray_destroy
 * purpose: destructor
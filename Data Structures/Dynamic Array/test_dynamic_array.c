@@ -9,6 +9,8 @@
 #include <stdbool.h>
 #include <assert.h>
 #include "dynamic_array.h"
+#include "../../Memory/mempool.h"
+#include "../../Memory/arena.h"
 #include "src\unity.h"
 
 
@@ -200,6 +202,75 @@ void alternating_series_of_pop_and_popleft_is_possible (void)
     darray_destroy(SUT);
 }
 
+/******************************************************************************/
+
+void array_growth_on_pool_reaches_the_allocator (void)
+{
+    //given an array of capacity 1 on a pool
+    struct mempool *pool = mempool_create(1 << 20);
+    struct allocator alloc = allocator_mempool(pool);
+    struct mempool_stats before, during, after;
+    int values[1000];
+    
+    mempool_stats(pool, &before);
+    darray SUT = darray_create_with(1, free, &alloc);
+    
+    //when 1000 elements are appended, doubling the capacity 10 times to 1024
+    for (int i = 0; i < 1000; ++i)
+    {
+        values[i] = i;
+        TEST_ASSERT_EQUAL_INT(0, darray_append(&SUT, values + i));
+    }
+    
+    //then every doubling was a resize request served by the pool
+    mempool_stats(pool, &during);
+    TEST_ASSERT_EQUAL_size_t(before.grows + 10, during.grows);
+    TEST_ASSERT_TRUE(during.in_use >= before.in_use + DARRAY_BYTES(1024));
+    
+    //and the elements survive the moves in order at both ends
+    TEST_ASSERT_EQUAL_INT(1000, darray_count(SUT));
+    TEST_ASSERT_EQUAL_INT(0, *(int *) darray_popleft(SUT));
+    TEST_ASSERT_EQUAL_INT(999, *(int *) darray_pop(SUT));
+    TEST_ASSERT_EQUAL_INT(998, *(int *) darray_peek(SUT));
+    
+    //afterwards every byte goes back to the pool
+    darray_destroy(SUT);
+    mempool_stats(pool, &after);
+    TEST_ASSERT_EQUAL_size_t(before.in_use, after.in_use);
+    
+    mempool_destroy(pool);
+}
+
+/******************************************************************************/
+
+void array_on_arena_keeps_every_element (void)
+{
+    //given an array on an arena, which grows by copying into new allocations
+    struct arena *arena = arena_create(4096, 8);
+    struct allocator alloc = allocator_arena(arena);
+    int values[1000];
+    
+    darray SUT = darray_create_with(1, free, &alloc);
+    
+    for (int i = 0; i < 1000; ++i)
+    {
+        values[i] = i;
+        darray_append(&SUT, values + i);
+    }
+    
+    //then every element survives the copies, in order
+    TEST_ASSERT_EQUAL_INT(1000, darray_count(SUT));
+    
+    for (int i = 999; i >= 0; --i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, *(int *) darray_pop(SUT));
+    }
+    
+    //the arena releases the array wholesale
+    darray_destroy(SUT);
+    arena_destroy(arena);
+}
+
 /******************************************************************************/
 //this section is tested with DynamoRio, not Unity
 
@@ -258,6 +329,8 @@ int main(void)
         RUN_TEST(popleft_several_elements_off_array_is_successful);
         RUN_TEST(calling_peek_does_not_accidentally_pop_element_off_array);
         RUN_TEST(alternating_series_of_pop_and_popleft_is_possible);
+        RUN_TEST(array_growth_on_pool_reaches_the_allocator);
+        RUN_TEST(array_on_arena_keeps_every_element);
     UNITY_END();
     
     
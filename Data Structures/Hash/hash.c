@@ -10,6 +10,7 @@
 #include <stddef.h>
 #include <string.h>
 #include "hash.h"
+#include "../../Memory/slab.h"
 
 /******************************************************************************/
 //Jenkin's one-at-a-time hash with biased integer multiplication mapping
@@ -32,15 +33,35 @@ static inline uint32_t hash(const char *key, uint32_t m)
     return (uint32_t) (((uint64_t) hash * (uint64_t) m) >> 32);
 }
 
+/******************************************************************************/
+//byte-size of a table, no need to worry about offset of slots b/c fully packed
+
+#define TABLE_BYTES(capacity)                                                  \
+        (sizeof(struct hash_table) + sizeof(struct node) * (capacity))
+
 /******************************************************************************/
 
 struct hash_table *htab_create(uint32_t capacity)
 {
-    //no need to worry about offset of slots b/c fully packed
-    size_t bytes = sizeof(struct hash_table) + sizeof(struct node) * capacity;
-    struct hash_table *ht = malloc(bytes);
+    return htab_create_with(capacity, NULL);
+}
+
+/******************************************************************************/
+
+struct hash_table *htab_create_with(uint32_t capacity, const struct allocator *alloc)
+{
+    struct hash_table *ht = ALLOCATOR_ALLOC(alloc, TABLE_BYTES(capacity));
     if (ht == NULL) return NULL;
     
+    ht->chains = slab_create_with(sizeof(struct node), alloc);
+    
+    if (ht->chains == NULL)
+    {
+        ALLOCATOR_RELEASE(alloc, ht, TABLE_BYTES(capacity));
+        return NULL;
+    }
+    
+    ht->alloc = alloc;
     ht->LF = 0.0;
     ht->capacity = capacity;
     ht->count = 0;
@@ -60,23 +81,9 @@ void htab_destroy(struct hash_table *ht)
 {
     assert(ht != NULL && "hash table pointer is null");
     
-    //whenever a slot is not available destroy the linked list stored there
-    for (uint32_t i = 0; i < ht->capacity; ++i)
-    {
-        if (ht->slots[i].key[0] != '\0' && ht->slots[i].next != NULL)
-        {
-            struct node *curr = ht->slots[i].next;
-            
-            while(curr != NULL)
-            {
-                struct node *next_node = curr->next;
-                free(curr);
-                curr = next_node;
-            }
-        }
-    }
-    
-    free(ht);
+    //every overflow node lives in the slab cache, so no chain needs walking
+    slab_destroy(ht->chains);
+    ALLOCATOR_RELEASE(ht->alloc, ht, TABLE_BYTES(ht->capacity));
 }
 
 /******************************************************************************/
@@ -113,7 +120,7 @@ bool htab_insert(struct hash_table *ht, const char *key, const int64_t value)
             else if (curr->next == NULL)
             {
                 //reached tail without match, add new tail node
-                struct node *new = malloc(sizeof(struct node));
+                struct node *new = slab_alloc(ht->chains);
                 if (new == NULL) return false;
                 
                 strcpy(new->key, key);
@@ -208,7 +215,7 @@ bool htab_remove(struct hash_table *ht, const char *key, int64_t *value)
                     lag->value = lead->value;
                     lag->next = lead->next;
                     
-                    free(lead);
+                    slab_free(ht->chains, lead);
                     
                     goto update_lf;
                 }
@@ -216,7 +223,7 @@ bool htab_remove(struct hash_table *ht, const char *key, int64_t *value)
             else //non-head removal
             {
                 lag->next = lead->next;
-                free(lead);
+                slab_free(ht->chains, lead);
                 goto update_lf;
             }
         }
@@ -246,7 +253,7 @@ bool htab_resize(struct hash_table **ht)
     assert(new_capacity > old_ht->capacity && "capacity overflow");
     
     //instead of reallocation, a new hash table receives rehashed contents
-    struct hash_table *new_ht = htab_create(new_capacity);
+    struct hash_table *new_ht = htab_create_with(new_capacity, old_ht->alloc);
     
     if (new_ht == NULL) return false;
     
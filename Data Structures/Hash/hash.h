@@ -10,6 +10,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "../../Memory/allocator.h"
+
 /******************************************************************************/
 //TBH the reason for 64 bit value is to completely pack the struct in this order
 
@@ -21,13 +23,17 @@ struct node
 };
 
 /******************************************************************************/
-//list heads embedded directly in the table for better cache locality
+//list heads embedded directly in the table for better cache locality, overflow
+//nodes are carved from the chains slab cache which the table owns. Both come
+//from alloc, which is null for the C library.
 
 typedef struct hash_table
 {
     double LF;
     uint32_t capacity;
     uint32_t count;
+    struct slab *chains;
+    const struct allocator *alloc;
     struct node slots[];
 } * htab;
 
@@ -36,6 +42,10 @@ typedef struct hash_table
 
 struct hash_table *htab_create(uint32_t capacity);
 
+//the table, its chains, and every table made by htab_resize use the allocator,
+//which must serve 4 KiB blocks aligned to 4 KiB for the chain slabs
+struct hash_table *htab_create_with(uint32_t capacity, const struct allocator *alloc);
+
 //ht is dangling after destruction
 void htab_destroy(struct hash_table *ht);
 
@@ -11,6 +11,8 @@
 
 #include "src/unity.h"
 #include "hash.h"
+#include "../../Memory/mempool.h"
+#include "../../Memory/slab.h"
 
 /******************************************************************************/
 
@@ -311,6 +313,94 @@ void test_dynamic_resize(void)
 
 /******************************************************************************/
 
+void test_lookups_survive_every_resize_on_pool(void)
+{
+    //arrange
+    struct mempool *pool = mempool_create(1 << 20);
+    struct allocator alloc = allocator_mempool(pool);
+    struct mempool_stats before, after;
+    char key[16];
+    int64_t value = 0;
+    
+    mempool_stats(pool, &before);
+    htab ht = htab_create_with(2, &alloc);
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        sprintf(key, "key %d", i);
+        htab_insert(ht, key, i);
+    }
+    
+    //act-assert, each resize rehashes the chains into a new table
+    for (uint32_t capacity = 4; capacity <= 256; capacity *= 2)
+    {
+        bool status = htab_resize(&ht);
+        
+        TEST_ASSERT_TRUE(status);
+        TEST_ASSERT_EQUAL_UINT32(capacity, ht->capacity);
+        TEST_ASSERT_EQUAL_UINT32(200, ht->count);
+        
+        for (int i = 0; i < 200; ++i)
+        {
+            sprintf(key, "key %d", i);
+            TEST_ASSERT_TRUE(htab_search(ht, key, &value));
+            TEST_ASSERT_EQUAL_INT64(i, value);
+        }
+    }
+    
+    //assert, tables replaced by a resize went back to the pool
+    htab_destroy(ht);
+    mempool_stats(pool, &after);
+    TEST_ASSERT_EQUAL_size_t(before.in_use, after.in_use);
+    mempool_destroy(pool);
+}
+
+/******************************************************************************/
+
+void test_chain_removals_on_slab_adapter_keep_other_keys(void)
+{
+    //arrange, the table is one slab object and its 100 keys in 4 slots chain
+    struct slab *cache = slab_create(sizeof(struct hash_table) + 4 * sizeof(struct node));
+    struct allocator alloc = allocator_slab(cache);
+    char key[16];
+    int64_t value = 0;
+    
+    htab ht = htab_create_with(4, &alloc);
+    TEST_ASSERT_NOT_NULL(ht);
+    
+    for (int i = 0; i < 100; ++i)
+    {
+        sprintf(key, "key %d", i);
+        htab_insert(ht, key, i);
+    }
+    
+    //act, remove the even keys from heads and middles of the chains alike
+    for (int i = 0; i < 100; i += 2)
+    {
+        sprintf(key, "key %d", i);
+        TEST_ASSERT_TRUE(htab_remove(ht, key, &value));
+        TEST_ASSERT_EQUAL_INT64(i, value);
+    }
+    
+    //assert
+    TEST_ASSERT_EQUAL_UINT32(50, ht->count);
+    
+    for (int i = 0; i < 100; ++i)
+    {
+        sprintf(key, "key %d", i);
+        bool found = htab_search(ht, key, &value);
+        
+        TEST_ASSERT_EQUAL(i % 2 == 1, found);
+        if (found) TEST_ASSERT_EQUAL_INT64(i, value);
+    }
+    
+    //clean
+    htab_destroy(ht);
+    slab_destroy(cache);
+}
+
+/******************************************************************************/
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -326,6 +416,8 @@ int main(void)
         RUN_TEST(test_remove_non_head_from_slot_with_multiple_elements);
         RUN_TEST(test_remove_empty_slot_is_false);
         RUN_TEST(test_dynamic_resize);
+        RUN_TEST(test_lookups_survive_every_resize_on_pool);
+        RUN_TEST(test_chain_removals_on_slab_adapter_keep_other_keys);
     UNITY_END();
     
     return EXIT_SUCCESS;
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <limits.h>
 #include "list.h"
+#include "../../../Memory/slab.h"
 
 /*******************************************************************************
 * public functions
@@ -15,9 +16,30 @@
 
 struct list *list_create(void (*destroy)(void *data))
 {
-    struct list *list = malloc(sizeof(struct list));
+    return list_create_with(destroy, NULL);
+}
+
+/******************************************************************************/
+
+struct list *list_create_with
+(
+    void (*destroy)(void *data),
+    const struct allocator *alloc
+)
+{
+    struct list *list = ALLOCATOR_ALLOC(alloc, sizeof(struct list));
     if (list == NULL) return NULL;
 
+    //nodes are carved from page-sized slabs rather than malloc'd one by one
+    list->nodes = slab_create_with(sizeof(struct list_node), alloc);
+    
+    if (list->nodes == NULL)
+    {
+        ALLOCATOR_RELEASE(alloc, list, sizeof(struct list));
+        return NULL;
+    }
+
+    list->alloc = alloc;
     list->destroy = destroy;
     list->head = NULL;
     list->tail = NULL;
@@ -32,13 +54,17 @@ void list_destroy(struct list *list)
 {
     assert(list != NULL && "input list pointer is null");
 
-    while (list->head != NULL)
+    //destroy the data in each node, the nodes themselves go with their slabs
+    if (list->destroy != NULL)
     {
-        if (list->destroy == NULL) list_pop_head(list);
-        else (*list->destroy)(list_pop_head(list));
+        for (struct list_node *curr = list->head; curr != NULL; curr = curr->next)
+        {
+            (*list->destroy)(curr->data);
+        }
     }
 
-    free(list);
+    slab_destroy(list->nodes);
+    ALLOCATOR_RELEASE(list->alloc, list, sizeof(struct list));
 }
 
 /******************************************************************************/
@@ -50,7 +76,7 @@ struct list_node *list_insert_pos(struct list *list, int pos, void *data)
     assert(pos <= list->size && pos >= 0 && "position out of bounds");
 
     //allocate memory for a new node
-    struct list_node *new_node = malloc(sizeof(struct list_node));
+    struct list_node *new_node = slab_alloc(list->nodes);
     if (new_node == NULL) return NULL;
 
     //configure pointers in metadata and the new node
@@ -167,7 +193,7 @@ void *list_remove_pos(struct list *list, int pos)
     //remove data from node, update metadata, and clean up memory
     void *data = removed_node->data;
 
-    free(removed_node);
+    slab_free(list->nodes, removed_node);
 
     --list->size;
 
@@ -223,7 +249,7 @@ struct list_node *list_insert_node
     assert((method == 1 || method == 2) && "invalid method");
 
     //allocate memory for a new node
-    struct list_node *new_node = malloc(sizeof(struct list_node));
+    struct list_node *new_node = slab_alloc(list->nodes);
     if (new_node == NULL) return NULL;
 
     //place data in the new node
@@ -321,7 +347,7 @@ void *list_remove_node(struct list *list, struct list_node *node, char method)
     }
 
     ret_data = del_node->data;
-    free(del_node);
+    slab_free(list->nodes, del_node);
     --list->size;
 
     return ret_data;
@@ -454,6 +480,9 @@ struct list_node *list_concat(struct list *A, struct list *B)
     //get ret val
     struct list_node *ret_node = B->head;
 
+    //the nodes of B now belong to A, and so do the slabs they live in
+    slab_absorb(A->nodes, B->nodes);
+
     //make B empty list, user responsibility to destroy if needed
     B->head = NULL;
     B->tail = NULL;
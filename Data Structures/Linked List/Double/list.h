@@ -8,6 +8,8 @@
 
 #include <stdbool.h>
 
+#include "../../../Memory/allocator.h"
+
 /*******************************************************************************
 * struct: list_node
 * purpose: list node returned on some functions, can be used as later input to
@@ -31,6 +33,8 @@ typedef struct list_node
 * @ head : pointer to the first node in the list
 * @ tail : pointer to the final node in the list
 * @ size : the total number of nodes in the list
+* @ nodes : slab cache that owns the memory of every node in the list
+* @ alloc : allocator of the list and its slabs, null for the C library
 *******************************************************************************/
 typedef struct list
 {
@@ -38,6 +42,8 @@ typedef struct list
     struct list_node *head;
     struct list_node *tail;
     int size;
+    struct slab *nodes;
+    const struct allocator *alloc;
 } *List;
 
 //constructors
@@ -50,6 +56,20 @@ typedef struct list
 *******************************************************************************/
 struct list *list_create(void (*destroy)(void *data));
 
+/*******************************************************************************
+* public function: list_create_with
+* purpose: constructor, the list and its node slabs come from an allocator
+* @ destroy : pointer to function for void * destruction, else NULL
+* @ alloc : allocator which serves 4 KiB blocks aligned to 4 KiB, null for the C
+*          library. Lists are only concatenated with lists of the same alloc.
+* returns: pointer to struct list
+*******************************************************************************/
+struct list *list_create_with
+(
+    void (*destroy)(void *data),
+    const struct allocator *alloc
+);
+
 /*******************************************************************************
 * public function: list_destroy
 * purpose: destructor, calls destroy passed on constructor unless NULL
@@ -9,6 +9,8 @@
 #include <string.h>
 
 #include "list.h"
+#include "../../../Memory/mempool.h"
+#include "../../../Memory/slab.h"
 #include "src/unity.h"
 
 /******************************************************************************/
@@ -461,6 +463,112 @@ void test_typedef_lists_and_nodes_are_accepted(void)
     list_destroy(list);
 }
 
+/******************************************************************************/
+
+void test_concat_on_pool_keeps_both_links_and_returns_every_byte(void)
+{
+    //given two lists on one pool with enough nodes to span several slabs each
+    struct mempool *pool = mempool_create(1 << 20);
+    struct allocator alloc = allocator_mempool(pool);
+    struct mempool_stats before, after;
+    int values[1000];
+    
+    mempool_stats(pool, &before);
+    struct list *A = list_create_with(NULL, &alloc);
+    struct list *B = list_create_with(NULL, &alloc);
+    
+    for (int i = 0; i < 1000; ++i)
+    {
+        values[i] = i;
+        list_push_tail(i < 500 ? A : B, values + i);
+    }
+    
+    //when list B is concatenated onto list A and every even value is removed
+    struct list_node *first_new_node = list_concat(A, B);
+    TEST_ASSERT_EQUAL_PTR(values + 500, first_new_node->data);
+    
+    for (int i = 0; i < 500; ++i) list_remove_pos(A, i);
+    
+    //then the odd values remain in order from either end across the join
+    TEST_ASSERT_EQUAL_INT(500, list_size(A));
+    TEST_ASSERT_EQUAL_INT(0, list_size(B));
+    
+    struct list_node *node = A->head;
+    
+    for (int i = 0; i < 500; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(2 * i + 1, *(int *) node->data);
+        node = node->next;
+    }
+    
+    TEST_ASSERT_NULL(node);
+    node = A->tail;
+    
+    for (int i = 499; i >= 0; --i)
+    {
+        TEST_ASSERT_EQUAL_INT(2 * i + 1, *(int *) node->data);
+        node = node->prev;
+    }
+    
+    TEST_ASSERT_NULL(node);
+    
+    //afterwards the absorbed slabs go back to the pool with list A
+    list_destroy(B);
+    list_destroy(A);
+    mempool_stats(pool, &after);
+    TEST_ASSERT_EQUAL_size_t(before.in_use, after.in_use);
+    mempool_destroy(pool);
+}
+
+/******************************************************************************/
+
+void test_copy_on_slab_adapter_leaves_source_list_intact(void)
+{
+    //given two lists whose handles and node caches come from the slab adapter
+    struct slab *cache = slab_create(64);
+    struct allocator alloc = allocator_slab(cache);
+    int values[200];
+    
+    struct list *A = list_create_with(NULL, &alloc);
+    struct list *B = list_create_with(NULL, &alloc);
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        values[i] = i;
+        list_push_tail(i < 100 ? A : B, values + i);
+    }
+    
+    //when list A gains a deep copy of list B, whose tail is then popped
+    struct list_node *first_new_node = list_copy(A, B);
+    TEST_ASSERT_NOT_NULL(first_new_node);
+    TEST_ASSERT_FALSE(list_search_node(B, first_new_node, 1, NULL));
+    
+    list_pop_tail(B);
+    
+    //then list A holds the copy in order from either end
+    TEST_ASSERT_EQUAL_INT(200, list_size(A));
+    TEST_ASSERT_EQUAL_INT(99, list_size(B));
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, *(int *) list_access_pos(A, i));
+    }
+    
+    for (int i = 199; i >= 100; --i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, *(int *) list_pop_tail(A));
+    }
+    
+    //and list B is untouched apart from its own pop
+    TEST_ASSERT_EQUAL_INT(100, *(int *) list_peek_head(B));
+    TEST_ASSERT_EQUAL_INT(198, *(int *) list_peek_tail(B));
+    
+    //afterwards
+    list_destroy(A);
+    list_destroy(B);
+    slab_destroy(cache);
+}
+
 /******************************************************************************/
 //integration test with DynamoRio, not Unity
 
@@ -526,6 +634,8 @@ int main(void)
         RUN_TEST(test_insert_node_before_first_new_node_after_concat);
         RUN_TEST(test_insert_node_after_first_new_node_after_concat);
         RUN_TEST(test_typedef_lists_and_nodes_are_accepted);
+        RUN_TEST(test_concat_on_pool_keeps_both_links_and_returns_every_byte);
+        RUN_TEST(test_copy_on_slab_adapter_leaves_source_list_intact);
     UNITY_END();
 
     INTEGRATION_BEGIN();
@@ -9,18 +9,40 @@
 #include <stdbool.h>
 
 #include "sll.h"
+#include "../../../Memory/slab.h"
 
 /*******************************************************************************
 * public functions
 *******************************************************************************/
 
 struct sll *sll_create(void (*destroy)(void *object))
+{
+    return sll_create_with(destroy, NULL);
+}
+
+/******************************************************************************/
+
+struct sll *sll_create_with
+(
+    void (*destroy)(void *object),
+    const struct allocator *alloc
+)
 {
     assert(destroy != NULL && "function pointer destroy is null");
     
-    struct sll *s = malloc(sizeof(struct sll));
+    struct sll *s = ALLOCATOR_ALLOC(alloc, sizeof(struct sll));
     if (s == NULL) return NULL;
     
+    //nodes are carved from page-sized slabs rather than malloc'd one by one
+    s->nodes = slab_create_with(sizeof(struct node), alloc);
+    
+    if (s->nodes == NULL)
+    {
+        ALLOCATOR_RELEASE(alloc, s, sizeof(struct sll));
+        return NULL;
+    }
+    
+    s->alloc = alloc;
     s->destroy = destroy;
     s->head = NULL;
     s->size = 0;
@@ -35,25 +57,23 @@ void sll_destroy(struct sll *s)
 {
     assert(s != NULL && "input sll pointer is null");
     
+    //the slab cache outlives a custom destroy, which frees the struct itself
+    struct slab *nodes = s->nodes;
+    
     if (s->destroy == free)
     {
-        //if this list has a type 1 concat, then the client should have already
-        //destroyed the parent list. This destruction doesn't influence the
-        //metadata on the current list so it has a dangling head pointer. In
-        //which case we want to skip this branch.
-        if (s->has_type_1_concat == false)
-        {
-            //free the individual list nodes first by popping off the heads
-            while (s->head != NULL) sll_remove_head(s);
-        }
-        
-        //now we can free the sll struct
-        free(s);
+        //if this list has a type 1 concat, then its nodes and their slabs were
+        //handed over to the parent list. The head pointer here may dangle, but
+        //the individual nodes never need popping because the slab cache below
+        //releases every node of this list at once.
+        ALLOCATOR_RELEASE(s->alloc, s, sizeof(struct sll));
     }
     else //client has passed their own implementation
     {
         (*s->destroy)(s);
     }
+    
+    slab_destroy(nodes);
 }
 
 /******************************************************************************/
@@ -65,7 +85,7 @@ struct node *sll_insert_idx(struct sll *s, uint32_t idx, sll_item datum)
     assert(s->size != UINT32_MAX);
     
     //create a new node
-    struct node *new_node = malloc(sizeof(struct node));
+    struct node *new_node = slab_alloc(s->nodes);
     if (new_node == NULL) return NULL;
     
     //set up next pointer on node, branch depending on if insertion at head
@@ -135,7 +155,7 @@ sll_item sll_remove_idx(struct sll *s, uint32_t idx)
     //give the data at the node to user and clean up node memory block
     sll_item datum = removed_node->datum;
     
-    free(removed_node);
+    slab_free(s->nodes, removed_node);
     
     --s->size;
     
@@ -208,8 +228,9 @@ struct node *sll_concat
                 first_new_node = from->head;
                 sll_access_tail(to)->next = first_new_node;
                 
-                //update metadata for 'to' list
+                //update metadata for 'to' list, which also takes the slabs
                 to->size += from->size;
+                slab_absorb(to->nodes, from->nodes);
                 
                 //modify 'from' list to revert to empty state
                 from->head = NULL;
@@ -221,8 +242,9 @@ struct node *sll_concat
                 first_new_node = from->head;
                 sll_access_tail(to)->next = first_new_node;
                 
-                //update metadata for 'to' list
+                //update metadata for 'to' list, which also takes the slabs
                 to->size += from->size;
+                slab_absorb(to->nodes, from->nodes);
                 
                 //modify 'from' concat flag so that destroy call will not fail
                 from->has_type_1_concat = true;
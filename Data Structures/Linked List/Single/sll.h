@@ -9,6 +9,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "../../../Memory/allocator.h"
+
 /*******************************************************************************
 * client-modifiable parameters
 * @ sll_item : the data type of items contained in the list
@@ -34,6 +36,8 @@ struct node
 * @ head : pointer to the first node in the list
 * @ size : number of nodes in list
 * @ has_type_1_concat : flag that this list has been concatenated with type 1
+* @ nodes : slab cache that owns the memory of every node in the list
+* @ alloc : allocator of the list and its slabs, null for the C library
 *
 *
 *       SLL  
@@ -50,6 +54,8 @@ struct sll
     struct node *head;
     uint32_t size;
     bool has_type_1_concat;
+    struct slab *nodes;
+    const struct allocator *alloc;
 };
 
 /*******************************************************************************
@@ -60,10 +66,28 @@ struct sll
 *******************************************************************************/
 struct sll *sll_create(void (*destroy)(void *object));
 
+/*******************************************************************************
+* public function: sll_create_with
+* purpose: constructor, the list and its node slabs come from an allocator
+* @ destroy : pointer to function used to clean up memory on destructor call
+* @ alloc : allocator which serves 4 KiB blocks aligned to 4 KiB, null for the C
+*           library. Lists are only concatenated with lists of the same alloc.
+* returns: pointer to struct sll, or NULL on failure
+* note: a custom destroy must release the struct with
+*       ALLOCATOR_RELEASE(s->alloc, s, sizeof(struct sll)) rather than free().
+*******************************************************************************/
+struct sll *sll_create_with
+(
+    void (*destroy)(void *object),
+    const struct allocator *alloc
+);
+
 /*******************************************************************************
 * public function: sll_destroy
 * purpose: destructor
 * @ s : pointer to struct sll
+* note: a custom destroy must not free() the nodes, their memory is released
+*       with the slab cache of the list once the custom destroy returns.
 *******************************************************************************/
 void sll_destroy(struct sll *s);
 
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 
 #include "sll.h"
+#include "../../../Memory/mempool.h"
+#include "../../../Memory/slab.h"
 #include "src/unity.h"
 
 
@@ -267,6 +269,100 @@ void test_search_for_tail_node_after_type_1_concat_is_successful(void)
     sll_destroy(list_2);
 }
 
+/******************************************************************************/
+
+void test_type_0_concat_on_pool_keeps_order_and_returns_every_byte(void)
+{
+    //given two lists on one pool with enough nodes to span several slabs each
+    struct mempool *pool = mempool_create(1 << 20);
+    struct allocator alloc = allocator_mempool(pool);
+    struct mempool_stats before, after;
+    int values[1000];
+    
+    mempool_stats(pool, &before);
+    struct sll *list_1 = sll_create_with(free, &alloc);
+    struct sll *list_2 = sll_create_with(free, &alloc);
+    
+    for (int i = 0; i < 1000; ++i)
+    {
+        struct sll *list = i < 500 ? list_1 : list_2;
+        values[i] = i;
+        sll_insert_tail(list, values + i);
+    }
+    
+    //when list 2 is concatenated onto list 1 and every even value is removed
+    struct node *first_new_node = sll_concat(list_1, list_2, 0, NULL);
+    TEST_ASSERT_EQUAL_PTR(values + 500, first_new_node->datum);
+    
+    for (uint32_t i = 0; i < 500; ++i) sll_remove_idx(list_1, i);
+    
+    //then the odd values of both lists remain in order across the join
+    TEST_ASSERT_EQUAL_UINT32(500, sll_size(list_1));
+    TEST_ASSERT_EQUAL_UINT32(0, sll_size(list_2));
+    
+    struct node *node = sll_access_head(list_1);
+    
+    for (int i = 0; i < 500; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(2 * i + 1, *(int *) node->datum);
+        node = node->next;
+    }
+    
+    TEST_ASSERT_NULL(node);
+    
+    //afterwards the absorbed slabs go back to the pool with list 1
+    sll_destroy(list_2);
+    sll_destroy(list_1);
+    mempool_stats(pool, &after);
+    TEST_ASSERT_EQUAL_size_t(before.in_use, after.in_use);
+    mempool_destroy(pool);
+}
+
+/******************************************************************************/
+
+void test_type_2_concat_on_slab_adapter_copies_nodes_in_order(void)
+{
+    //given two lists whose handles and node caches come from the slab adapter
+    struct slab *cache = slab_create(64);
+    struct allocator alloc = allocator_slab(cache);
+    int values[200];
+    
+    struct sll *list_1 = sll_create_with(free, &alloc);
+    struct sll *list_2 = sll_create_with(free, &alloc);
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        struct sll *list = i < 100 ? list_1 : list_2;
+        values[i] = i;
+        sll_insert_tail(list, values + i);
+    }
+    
+    //when list 1 gains a copy of list 2, which is then emptied
+    struct node *first_new_node = sll_concat(list_1, list_2, 2, NULL);
+    TEST_ASSERT_FALSE(sll_search_node(list_2, first_new_node));
+    
+    while (sll_size(list_2) > 0) sll_remove_head(list_2);
+    
+    //then the copied nodes survive in order after the originals
+    TEST_ASSERT_EQUAL_UINT32(200, sll_size(list_1));
+    TEST_ASSERT_EQUAL_PTR(values + 100, first_new_node->datum);
+    
+    struct node *node = sll_access_head(list_1);
+    
+    for (int i = 0; i < 200; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, *(int *) node->datum);
+        node = node->next;
+    }
+    
+    TEST_ASSERT_NULL(node);
+    
+    //afterwards
+    sll_destroy(list_1);
+    sll_destroy(list_2);
+    slab_destroy(cache);
+}
+
 /******************************************************************************/
 //integration test for memory leaks uses DynamoRio. unity framework not used.
 
@@ -312,6 +408,8 @@ int main(void)
         RUN_TEST(test_search_for_existing_node_is_successful);
         RUN_TEST(test_search_for_tail_node_after_type_0_concat_is_successful);
         RUN_TEST(test_search_for_tail_node_after_type_1_concat_is_successful);
+        RUN_TEST(test_type_0_concat_on_pool_keeps_order_and_returns_every_byte);
+        RUN_TEST(test_type_2_concat_on_slab_adapter_copies_nodes_in_order);
     UNITY_END();
     
     INTEGRATION_BEGIN();
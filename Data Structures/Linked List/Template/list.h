@@ -3,6 +3,8 @@
 * Description: doubly linked list mimic of a c++ template style data structure.
 * The void generics in the other repository folders contain documentation and
 * comments. This header should only serve for usage, not reference. 
+* name##_create_with places the list and its nodes on an allocator, the slab
+* adapter of Memory/allocator.h fits the nodes exactly.
 */
 
 #ifndef LIST_H
@@ -13,6 +15,8 @@
 #include <assert.h>
 #include <limits.h>
 
+#include "../../../Memory/allocator.h"
+
 #define LIST_TYPES(name, type)                                                 \
                                                                                \
 typedef struct name##_node_                                                    \
@@ -29,6 +33,7 @@ typedef struct name##_                                                         \
     struct name##_node_ *head;                                                 \
     struct name##_node_ *tail;                                                 \
     int size;                                                                  \
+    const struct allocator *alloc;                                             \
 } * name;                                                                      \
 
 
@@ -37,6 +42,7 @@ typedef struct name##_                                                         \
 #define LIST_PROTOTYPES(name, type, scope)                                     \
                                                                                \
 scope struct name##_ * name##_create (void (*destroy)(type data));             \
+scope struct name##_ * name##_create_with (void (*destroy)(type data), const struct allocator *alloc); \
 scope void name##_destroy (struct name##_ *list);                              \
 scope struct name##_node_ * name##_insert_pos( struct name##_  *list, int pos, type data); \
 scope type name##_remove_pos( struct name##_  *list, int pos);                 \
@@ -61,9 +67,15 @@ scope type name##_peek_tail(struct name##_ *list);                             \
                                                                                \
 scope struct name##_ * name##_create (void (*destroy)(type data))              \
 {                                                                              \
-    struct name##_ *list = malloc(sizeof(struct name##_));                     \
+    return name##_create_with (destroy, NULL);                                 \
+}                                                                              \
+                                                                               \
+scope struct name##_ * name##_create_with (void (*destroy)(type data), const struct allocator *alloc) \
+{                                                                              \
+    struct name##_ *list = ALLOCATOR_ALLOC(alloc, sizeof(struct name##_));     \
     if (list == NULL) return NULL;                                             \
                                                                                \
+    list->alloc = alloc;                                                       \
     list->destroy = destroy;                                                   \
     list->head = NULL;                                                         \
     list->tail = NULL;                                                         \
@@ -82,7 +94,7 @@ scope void name##_destroy (struct name##_ *list)                               \
         else (*list->destroy)(name##_pop_head  (list));                            \
     }                                                                          \
                                                                                \
-    free(list);                                                                \
+    ALLOCATOR_RELEASE(list->alloc, list, sizeof(struct name##_));              \
 }                                                                              \
                                                                                \
 scope struct name##_node_ * name##_insert_pos( struct name##_  *list, int pos, type data) \
@@ -91,7 +103,7 @@ scope struct name##_node_ * name##_insert_pos( struct name##_  *list, int pos, t
     assert(list->size < INT_MAX && "list is full");                            \
     assert(pos <= list->size && pos >= 0 && "position out of bounds");         \
                                                                                \
-    struct name##_node_  *new_node = malloc(sizeof( struct name##_node_ ));    \
+    struct name##_node_  *new_node = ALLOCATOR_ALLOC(list->alloc, sizeof( struct name##_node_ )); \
     if (new_node == NULL) return NULL;                                         \
                                                                                \
     if (list->size == 0)                                                       \
@@ -184,7 +196,7 @@ scope type name##_remove_pos( struct name##_  *list, int pos) \
 \
     type data = removed_node->data; \
 \
-    free(removed_node); \
+    ALLOCATOR_RELEASE(list->alloc, removed_node, sizeof(struct name##_node_)); \
  \
     --list->size; \
  \
@@ -229,7 +241,7 @@ scope struct name##_node_ * name##_insert_node( struct name##_  *list,  struct n
     assert(list->size < INT_MAX && "list is full"); \
     assert((method == 1 || method == 2) && "invalid method"); \
  \
-    struct name##_node_   *new_node = malloc(sizeof(struct name##_node_  )); \
+    struct name##_node_   *new_node = ALLOCATOR_ALLOC(list->alloc, sizeof(struct name##_node_  )); \
     if (new_node == NULL) return NULL; \
  \
     new_node->data = data; \
@@ -320,7 +332,7 @@ scope type name##_remove_node( struct name##_  *list,  struct name##_node_  *nod
     } \
  \
     ret_data = del_node->data; \
-    free(del_node); \
+    ALLOCATOR_RELEASE(list->alloc, del_node, sizeof(struct name##_node_)); \
     --list->size; \
  \
     return ret_data; \
@@ -423,6 +435,7 @@ scope struct name##_node_ * name##_concat( struct name##_  *A,  struct name##_
     assert(B != NULL && "input list pointer B is null"); \
     assert(A->size != 0 && "nothing to concatenate to"); \
     assert(B->size != 0 && "nothing to concatenate from"); \
+    assert(A->alloc == B->alloc && "lists use different allocators"); \
  \
     A->tail->next = B->head; \
     B->head->prev = A->tail; \
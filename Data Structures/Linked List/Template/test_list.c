@@ -0,0 +1,100 @@
+/*
+* Author: Biren Patel
+* Description: Unit tests for the template doubly linked list with Unity
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "list.h"
+#include "../../../Memory/slab.h"
+#include "src/unity.h"
+
+/******************************************************************************/
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/******************************************************************************/
+//system under test, whose nodes fit the slab adapter exactly
+
+define_list(ilist, int, static inline);
+
+/******************************************************************************/
+
+void test_template_list_on_slab_adapter_is_usable(void)
+{
+    //given a template list whose nodes are objects of a slab cache
+    struct slab *cache = slab_create(sizeof(struct ilist_node_));
+    struct allocator alloc = allocator_slab(cache);
+    
+    ilist list = ilist_create_with(NULL, &alloc);
+    TEST_ASSERT_NOT_NULL(list);
+    
+    //when enough nodes are pushed to span several slabs
+    for (int i = 0; i < 1000; ++i) ilist_push_tail(list, i);
+    
+    //then they come back in order
+    TEST_ASSERT_EQUAL_INT(1000, ilist_size(list));
+    
+    for (int i = 0; i < 1000; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, ilist_pop_head(list));
+    }
+    
+    //afterwards
+    ilist_destroy(list);
+    slab_destroy(cache);
+}
+
+/******************************************************************************/
+
+void test_template_concat_on_slab_adapter_keeps_both_links(void)
+{
+    //given two template lists sharing one slab cache for their nodes
+    struct slab *cache = slab_create(sizeof(struct ilist_node_));
+    struct allocator alloc = allocator_slab(cache);
+    
+    ilist A = ilist_create_with(NULL, &alloc);
+    ilist B = ilist_create_with(NULL, &alloc);
+    
+    for (int i = 0; i < 1000; ++i) ilist_push_tail(i < 500 ? A : B, i);
+    
+    //when list B is concatenated onto list A and the join is removed
+    ilist_node first_new_node = ilist_concat(A, B);
+    TEST_ASSERT_EQUAL_INT(500, first_new_node->data);
+    TEST_ASSERT_EQUAL_INT(500, ilist_remove_node(A, first_new_node, 0));
+    
+    //then list B is empty and list A reads in order from either end
+    TEST_ASSERT_EQUAL_INT(0, ilist_size(B));
+    TEST_ASSERT_EQUAL_INT(999, ilist_size(A));
+    TEST_ASSERT_EQUAL_INT(499, ilist_access_pos(A, 499));
+    TEST_ASSERT_EQUAL_INT(501, ilist_access_pos(A, 500));
+    
+    for (int i = 999; i > 500; --i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, ilist_pop_tail(A));
+    }
+    
+    for (int i = 0; i < 500; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, ilist_pop_head(A));
+    }
+    
+    //afterwards
+    ilist_destroy(A);
+    ilist_destroy(B);
+    slab_destroy(cache);
+}
+
+/******************************************************************************/
+
+int main(void)
+{
+    UNITY_BEGIN();
+        RUN_TEST(test_template_list_on_slab_adapter_is_usable);
+        RUN_TEST(test_template_concat_on_slab_adapter_keeps_both_links);
+    UNITY_END();
+    
+    return EXIT_SUCCESS;
+}
@@ -13,11 +13,13 @@
 * structure: struct stack
 * @ data : contains items pushed by client
 * @ top_of_stack : provides an index for data array
+* @ alloc : allocator of the stack, null for the C library
 *******************************************************************************/
 struct stack
 {
     stack_item data[STACK_SIZE];
     int top_of_stack;
+    const struct allocator *alloc;
 };
 
 /*******************************************************************************
@@ -27,14 +29,28 @@ struct stack
 //allocate memory for stack on heap and initialize
 struct stack *stack_create(void)
 {
-    struct stack *stack_ptr = malloc(sizeof(struct stack));
+    struct stack *stack_ptr = stack_create_with(NULL);
 
     if (stack_ptr == NULL)
     {
         exit(EXIT_FAILURE);
     }
 
+    return stack_ptr;
+}
+
+//allocate memory for stack from an allocator and initialize
+struct stack *stack_create_with(const struct allocator *alloc)
+{
+    struct stack *stack_ptr = ALLOCATOR_ALLOC(alloc, sizeof(struct stack));
+
+    if (stack_ptr == NULL)
+    {
+        return NULL;
+    }
+
     stack_ptr->top_of_stack = 0;
+    stack_ptr->alloc = alloc;
 
     return stack_ptr;
 }
@@ -42,7 +58,7 @@ struct stack *stack_create(void)
 //free memory used by stack
 void stack_destroy(struct stack *s)
 {
-    free(s);
+    ALLOCATOR_RELEASE(s->alloc, s, sizeof(struct stack));
 }
 
 //check if stack is empty
@@ -8,6 +8,8 @@
 
 #include <stdbool.h>
 
+#include "../../../Memory/allocator.h"
+
 /*******************************************************************************
 * purpose: pre-compilation modifiable parameters
 * @ typedef : change data type in stack without resorting to a generic ADT.
@@ -31,6 +33,14 @@ struct stack;
 *******************************************************************************/
 struct stack *stack_create(void);
 
+/*******************************************************************************
+* function: stack_create_with
+* purpose: constructor to initialize a stack from an allocator
+* @ alloc : allocator of the stack, null for the C library
+* returns: pointer to struct stack, or null pointer if allocation fails
+*******************************************************************************/
+struct stack *stack_create_with(const struct allocator *alloc);
+
 /*******************************************************************************
 * function: stack_destroy
 * purpose: destructor to free memory used by stack
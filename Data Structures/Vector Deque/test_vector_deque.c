@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include "vector_deque.h"
 #include "src/unity.h"
+#include "../../Memory/mempool.h"
 
 /******************************************************************************/
 
@@ -114,6 +115,92 @@ void test_push_back_and_front_on_empty_vector_with_offset(void)
 
 /******************************************************************************/
 
+void test_vector_on_pool_fills_to_capacity_from_both_ends(void)
+{
+    //given an empty vector on a pool, offset to the middle of its array member
+    struct mempool *pool = mempool_create(1 << 16);
+    struct allocator alloc = allocator_mempool(pool);
+    struct mempool_stats before, during, after;
+    
+    mempool_stats(pool, &before);
+    int_sut x = int_sut_create_with(1000, 500, &alloc);
+    TEST_ASSERT_NOT_NULL(x);
+    
+    //when we push to both ends until neither has room left
+    for (int i = 0; i < 500; ++i)
+    {
+        TEST_ASSERT_TRUE(int_sut_push_front(x, 499 - i));
+        TEST_ASSERT_TRUE(int_sut_push_back(x, 500 + i));
+    }
+    
+    bool status_push_front = int_sut_push_front(x, -1);
+    bool status_push_back = int_sut_push_back(x, -1);
+    
+    //then the full vector holds every element in order
+    TEST_ASSERT_FALSE(status_push_front);
+    TEST_ASSERT_FALSE(status_push_back);
+    TEST_ASSERT_EQUAL_INT(1000, x->count);
+    
+    for (int i = 0; i < 1000; ++i) TEST_ASSERT_EQUAL_INT(i, x->vector[i]);
+    
+    //and the pool holds 1000 elements rather than 1000 bytes
+    mempool_stats(pool, &during);
+    TEST_ASSERT_TRUE(during.in_use >= before.in_use + vector_bytes(int_sut, 1000));
+    
+    //afterwards every byte goes back to the pool
+    int_sut_destroy(x);
+    mempool_stats(pool, &after);
+    TEST_ASSERT_EQUAL_size_t(before.in_use, after.in_use);
+    TEST_ASSERT_EQUAL_size_t(before.available, after.available);
+    TEST_ASSERT_EQUAL_size_t(before.largest, after.largest);
+    TEST_ASSERT_EQUAL_size_t(during.allocs, after.frees);
+    
+    mempool_destroy(pool);
+}
+
+/******************************************************************************/
+
+void test_vector_of_pointers_on_pool_fills_to_capacity_from_both_ends(void)
+{
+    //given an empty vector of pointers on a pool, offset by one element
+    struct mempool *pool = mempool_create(1 << 16);
+    struct allocator alloc = allocator_mempool(pool);
+    struct mempool_stats before, after;
+    
+    mempool_stats(pool, &before);
+    str_sut x = str_sut_create_with(3, 1, &alloc);
+    TEST_ASSERT_NOT_NULL(x);
+    
+    //when we push to both ends until neither has room left
+    bool status_push_front = str_sut_push_front(x, "A");
+    bool status_push_back_1 = str_sut_push_back(x, "B");
+    bool status_push_back_2 = str_sut_push_back(x, "C");
+    bool status_overflow_front = str_sut_push_front(x, "X");
+    bool status_overflow_back = str_sut_push_back(x, "X");
+    
+    //then the last element sits in the final slot of the block
+    TEST_ASSERT_TRUE(status_push_front);
+    TEST_ASSERT_TRUE(status_push_back_1);
+    TEST_ASSERT_TRUE(status_push_back_2);
+    TEST_ASSERT_FALSE(status_overflow_front);
+    TEST_ASSERT_FALSE(status_overflow_back);
+    TEST_ASSERT_EQUAL_STRING("A", x->vector[0]);
+    TEST_ASSERT_EQUAL_STRING("B", x->vector[1]);
+    TEST_ASSERT_EQUAL_STRING("C", x->vector[2]);
+    TEST_ASSERT_EQUAL_INT(3, x->count);
+    
+    //afterwards the pool is back to where it started
+    str_sut_destroy(x);
+    mempool_stats(pool, &after);
+    TEST_ASSERT_EQUAL_size_t(before.in_use, after.in_use);
+    TEST_ASSERT_EQUAL_size_t(before.available, after.available);
+    TEST_ASSERT_EQUAL_size_t(before.largest, after.largest);
+    
+    mempool_destroy(pool);
+}
+
+/******************************************************************************/
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -121,6 +208,8 @@ int main(void)
         RUN_TEST(test_push_back_on_empty_vector_with_offset);
         RUN_TEST(test_push_front_on_empty_vector_with_offset);
         RUN_TEST(test_push_back_and_front_on_empty_vector_with_offset);
+        RUN_TEST(test_vector_on_pool_fills_to_capacity_from_both_ends);
+        RUN_TEST(test_vector_of_pointers_on_pool_fills_to_capacity_from_both_ends);
     UNITY_END();
     
     return EXIT_SUCCESS;
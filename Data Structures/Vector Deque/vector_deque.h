@@ -14,12 +14,15 @@
 #include <assert.h>
 #include <stdbool.h>
 
+#include "../../Memory/allocator.h"
+
 /*******************************************************************************
 * macro: vector_type
 * purpose: vector metadata struct used to access the API functionality
 * @ capacity : number of elements that vector can hold before resize triggers
 * @ L_idx : index of the first element in the vector
 * @ R_idx : index of the last element in the vector
+* @ alloc : allocator of the vector, null for the C library
 * @ vector : the flexible array member that the client interacts with
 *******************************************************************************/
 
@@ -31,9 +34,18 @@ typedef struct name##_                                                         \
     uint64_t count;                                                            \
     uint64_t L_idx;                                                            \
     uint64_t R_idx;                                                            \
+    const struct allocator *alloc;                                             \
     type vector[];                                                             \
 } * name;                                                                      \
-        
+
+/*******************************************************************************
+* macro: vector_bytes
+* purpose: byte-size of a vector of n elements, header included
+*******************************************************************************/
+
+#define vector_bytes(name, n)                                                  \
+        (offsetof(struct name##_, vector) + sizeof(*((name) 0)->vector) * (n))
+
 /*******************************************************************************
 * macro: vector_declarations
 * purpose: prototypes
@@ -42,6 +54,8 @@ typedef struct name##_                                                         \
 #define vector_declarations(scope, name, type)                                 \
                                                                                \
 scope name name##_create (uint64_t n, uint64_t offset);                        \
+scope name name##_create_with                                                  \
+    (uint64_t n, uint64_t offset, const struct allocator *alloc);              \
 scope void name##_destroy (name vector);                                       \
 scope bool name##_push_back (name vec, type item);                             \
 
@@ -57,9 +71,27 @@ scope bool name##_push_back (name vec, type item);                             \
                                                                                \
 scope name name##_create (uint64_t n, uint64_t offset)                         \
 {                                                                              \
-    name vec = malloc(offsetof(struct name##_, vector) + n);                   \
+    return name##_create_with(n, offset, NULL);                                \
+}                                                                              \
+
+/*******************************************************************************
+* function: name##_create_with
+* purpose: constructor, the vector comes from an allocator
+* @ n : initial capacity of vector
+* @ offset : offset of first element in vector, less than n
+* @ alloc : allocator, see Memory/allocator.h. Null for the C library.
+* returns: struct name_ or NULL if not successful
+*******************************************************************************/
+
+#define vector_definition_create_with(scope, name, type)                       \
+                                                                               \
+scope name name##_create_with                                                  \
+    (uint64_t n, uint64_t offset, const struct allocator *alloc)               \
+{                                                                              \
+    name vec = ALLOCATOR_ALLOC(alloc, vector_bytes(name, n));                  \
     if (vec == NULL) return NULL;                                              \
                                                                                \
+    vec->alloc = alloc;                                                        \
     vec->capacity = n;                                                         \
     vec->count = 0;                                                            \
     vec->L_idx = offset;                                                       \
@@ -79,7 +111,7 @@ scope name name##_create (uint64_t n, uint64_t offset)                         \
 scope void name##_destroy (name vec)                                           \
 {                                                                              \
     assert(vec != NULL && "input vector is null");                             \
-    free(vec);                                                                 \
+    ALLOCATOR_RELEASE(vec->alloc, vec, vector_bytes(name, vec->capacity));     \
 }                                                                              \
 
 /*******************************************************************************
@@ -143,6 +175,7 @@ scope bool name##_push_front(name vec, type item)                              \
 vector_type(name, type)                                                        \
 vector_declarations(scope, name, type)                                         \
 vector_definition_create(scope, name, type)                                    \
+vector_definition_create_with(scope, name, type)                               \
 vector_definition_destroy(scope, name, type)                                   \
 vector_defintion_push_back(scope, name, type)                                  \
 vector_definition_push_front(scope, name, type)                                \
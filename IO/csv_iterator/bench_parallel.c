@@ -0,0 +1,112 @@
+/*
+* author: Biren Patel
+* description: scaling of the parallel CSV reader. The same file is read with 1,
+* 2, 4, ... threads up to the requested maximum, in unordered and then ordered
+* mode, and the rate is reported in GB/s. The consumer parses every field as a
+* double so that each chunk does some real work besides splitting.
+*
+* usage: bench_parallel.exe <csv file> [max threads]
+* note: run once beforehand so that the file is in the page cache, otherwise the
+* first line measures the disk
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "csv_parallel.h"
+
+/*******************************************************************************
+* structure: struct totals
+* purpose: consumer state, shared by every worker in unordered mode
+*******************************************************************************/
+
+struct totals
+{
+    pthread_mutex_t lock;
+    size_t rows;
+    double sum;
+};
+
+/******************************************************************************/
+
+static void consume(const struct csv_chunk *chunk, void *context)
+{
+    struct totals *totals = context;
+    double sum = 0.0;
+
+    for (size_t i = 0; i < chunk->starts[chunk->rows]; ++i)
+    {
+        double value;
+        if (csv_field_double(chunk->fields[i], &value)) sum += value;
+    }
+
+    //one lock per chunk, not per field
+    pthread_mutex_lock(&totals->lock);
+    totals->rows += chunk->rows;
+    totals->sum += sum;
+    pthread_mutex_unlock(&totals->lock);
+}
+
+/******************************************************************************/
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <csv file> [max threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+
+    FILE *file = fopen(argv[1], "rb");
+
+    if (file == NULL || fseek(file, 0, SEEK_END) != 0)
+    {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    double bytes = (double) ftell(file);
+    fclose(file);
+
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        bool ordered = mode == 1;
+
+        for (int threads = 1; threads <= max_threads; threads *= 2)
+        {
+            struct totals totals = {PTHREAD_MUTEX_INITIALIZER, 0, 0.0};
+
+            double start = now();
+            bool status = csv_parallel_read(argv[1], ',', threads, ordered, consume, &totals);
+            double elapsed = now() - start;
+
+            if (status == false)
+            {
+                fprintf(stderr, "cannot map %s\n", argv[1]);
+                return EXIT_FAILURE;
+            }
+
+            printf("%-9s %3d threads: %7.3f GB/s   (%zu rows, checksum %g)\n",
+                ordered ? "ordered" : "unordered", threads,
+                elapsed > 0.0 ? 1e-9 * bytes / elapsed : 0.0, totals.rows, totals.sum);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
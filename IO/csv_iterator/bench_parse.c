@@ -0,0 +1,177 @@
+/*
+* author: Biren Patel
+* description: throughput of the CSV number parsers against strtol and strtod.
+* A buffer of comma-separated random numbers is parsed field by field several
+* times over, and the rate is reported in GB/s of CSV text consumed.
+*
+* usage: bench_parse.exe [fields]
+* note: compile with csv_parse.c and optimizations on, e.g. -O2
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "csv_parse.h"
+
+/*******************************************************************************
+* benchmark parameters
+* @ FIELDS : default total numbers in the buffer
+* @ PASSES : times each parser reads the whole buffer
+*******************************************************************************/
+
+#define FIELDS 1000000
+#define PASSES 10
+
+/*******************************************************************************
+* private function: next_random
+* purpose: xorshift64, the numbers only need to vary in length and digits
+*******************************************************************************/
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+/******************************************************************************/
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/*******************************************************************************
+* private function: fill
+* purpose: write fields comma-separated numbers to a new buffer
+* @ doubles : doubles with up to 17 significant digits if true, ints otherwise
+* @ len : receives the bytes written
+*******************************************************************************/
+
+static char *fill(size_t fields, int doubles, size_t *len)
+{
+    char *buffer = malloc(fields * 32);
+    if (buffer == NULL) return NULL;
+
+    uint64_t state = UINT64_C(88172645463325252);
+    char *p = buffer;
+
+    for (size_t i = 0; i < fields; ++i)
+    {
+        uint64_t r = next_random(&state);
+
+        if (doubles)
+        {
+            double x = (double) (r >> 11) / (double) (UINT64_C(1) << 53) * 1e4 - 5e3;
+            p += sprintf(p, "%.*g,", 1 + (int) (r % 17), x);
+        }
+        else
+        {
+            //lengths from one to ten digits, either sign
+            int bits = (int) (r >> 58) % 31;
+            int value = (int) (r % (UINT64_C(1) << bits));
+            p += sprintf(p, "%d,", r & 1 ? -value : value);
+        }
+    }
+
+    *len = (size_t) (p - buffer);
+    return buffer;
+}
+
+/*******************************************************************************
+* private function: report
+* purpose: print the rate of one parser and a checksum that keeps it alive
+*******************************************************************************/
+
+static void report(const char *name, size_t len, double elapsed, double checksum)
+{
+    double rate = elapsed > 0.0 ? 1e-9 * (double) len * PASSES / elapsed : 0.0;
+    printf("%-18s %7.3f GB/s   (checksum %g)\n", name, rate, checksum);
+}
+
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    size_t fields = argc > 1 ? strtoul(argv[1], NULL, 10) : FIELDS;
+
+    size_t int_len, double_len;
+    char *ints = fill(fields, 0, &int_len);
+    char *doubles = fill(fields, 1, &double_len);
+
+    if (ints == NULL || doubles == NULL)
+    {
+        fprintf(stderr, "malloc failed\n");
+        return EXIT_FAILURE;
+    }
+
+    //every parser stops at the comma that follows its field
+    const char *end = ints + int_len;
+    double start, checksum;
+
+    printf("%zu fields, %zu bytes of ints, %zu bytes of doubles\n", fields, int_len, double_len);
+
+    checksum = 0.0;
+    start = now();
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        for (const char *p = ints; p < end; ++p)
+        {
+            int value = 0;
+            p = csv_parse_int(p, end, &value);
+            checksum += value;
+        }
+    }
+    report("csv_parse_int", int_len, now() - start, checksum);
+
+    checksum = 0.0;
+    start = now();
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        for (char *p = ints; p < end; ++p)
+        {
+            checksum += (double) strtol(p, &p, 10);
+        }
+    }
+    report("strtol", int_len, now() - start, checksum);
+
+    end = doubles + double_len;
+
+    checksum = 0.0;
+    start = now();
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        for (const char *p = doubles; p < end; ++p)
+        {
+            double value = 0.0;
+            p = csv_parse_double(p, end, &value);
+            checksum += value;
+        }
+    }
+    report("csv_parse_double", double_len, now() - start, checksum);
+
+    checksum = 0.0;
+    start = now();
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        for (char *p = doubles; p < end; ++p)
+        {
+            checksum += strtod(p, &p);
+        }
+    }
+    report("strtod", double_len, now() - start, checksum);
+
+    free(ints);
+    free(doubles);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+/*
+* author: Biren Patel
+* description: implementation for CSV structural indexing. Both kernels reduce
+* a 64 byte block to three bitmasks, bit i standing for byte i of the block,
+* and then share the same quote resolution and offset extraction.
+*/
+
+#include <assert.h>
+#include <string.h>
+#include "csv_index.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+    #define CSV_INDEX_AVX2 1
+#else
+    #define CSV_INDEX_AVX2 0
+#endif
+
+#define BLOCK 64
+
+/*******************************************************************************
+* structure: struct masks
+* purpose: classification of one 64 byte block
+* @ seps : bytes equal to the separator
+* @ lines : line feeds
+* @ quotes : double quotes
+*******************************************************************************/
+
+struct masks
+{
+    uint64_t seps;
+    uint64_t lines;
+    uint64_t quotes;
+};
+
+/*******************************************************************************
+* private function: prefix_xor
+* purpose: bit i of the result is the xor of bits 0 to i of x. Over the quote
+* mask this sets every bit from an opening quote up to its closing quote, the
+* opening quote included. A doubled quote toggles twice and changes nothing.
+*******************************************************************************/
+
+static inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+
+    return x;
+}
+
+/*******************************************************************************
+* private function: flatten
+* purpose: write the position of every set bit of a block mask to offsets
+* @ bits : structural characters of the block
+* @ base : offset of the first byte of the block
+* returns: offsets advanced past the last entry written
+*******************************************************************************/
+
+static inline uint32_t *flatten(uint64_t bits, uint32_t base, uint32_t *offsets)
+{
+    while (bits != 0)
+    {
+        #if defined(__GNUC__)
+        *offsets++ = base + (uint32_t) __builtin_ctzll(bits);
+        #else
+        uint32_t i = 0;
+        while (((bits >> i) & 1) == 0) ++i;
+        *offsets++ = base + i;
+        #endif
+
+        bits &= bits - 1;
+    }
+
+    return offsets;
+}
+
+/*******************************************************************************
+* private function: structurals
+* purpose: resolve the quoted regions of a block and keep what lies outside them
+* @ m : block classification
+* @ inside : block quote mask after the prefix xor
+* @ quoted : carry from the previous block, updated for the next one
+*******************************************************************************/
+
+static inline uint64_t structurals(struct masks m, uint64_t inside, bool *quoted)
+{
+    if (*quoted) inside = ~inside;
+
+    //the top bit is the state after the last byte, padding included
+    *quoted = (inside >> 63) != 0;
+
+    return (m.seps | m.lines) & ~inside;
+}
+
+/*******************************************************************************
+* private function: classify_scalar
+* purpose: portable block classification, one byte at a time
+*******************************************************************************/
+
+static inline struct masks classify_scalar(const char *block, char sep)
+{
+    struct masks m = {0, 0, 0};
+
+    for (int i = 0; i < BLOCK; ++i)
+    {
+        uint64_t bit = UINT64_C(1) << i;
+
+        if (block[i] == sep) m.seps |= bit;
+        else if (block[i] == '\n') m.lines |= bit;
+        else if (block[i] == '"') m.quotes |= bit;
+    }
+
+    return m;
+}
+
+/*******************************************************************************
+* private function: scan_scalar
+* purpose: csv_index_scan over whole blocks with the portable kernel
+* returns: total offsets written
+*******************************************************************************/
+
+static size_t scan_scalar(const char *data, size_t blocks, char sep, bool *quoted, uint32_t *offsets)
+{
+    uint32_t *out = offsets;
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        struct masks m = classify_scalar(data + b * BLOCK, sep);
+        uint64_t bits = structurals(m, prefix_xor(m.quotes), quoted);
+        out = flatten(bits, (uint32_t) (b * BLOCK), out);
+    }
+
+    return (size_t) (out - offsets);
+}
+
+/*******************************************************************************
+* private function: scan_avx2
+* purpose: csv_index_scan over whole blocks, two 32 byte compares per character
+* class and a carry-less multiply by all ones for the prefix xor
+* returns: total offsets written
+*******************************************************************************/
+
+#if CSV_INDEX_AVX2
+
+__attribute__((target("avx2,pclmul")))
+static inline uint64_t movemask_eq(__m256i lo, __m256i hi, __m256i c)
+{
+    uint32_t low = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c));
+    uint32_t high = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c));
+
+    return (uint64_t) high << 32 | low;
+}
+
+__attribute__((target("avx2,pclmul")))
+static size_t scan_avx2(const char *data, size_t blocks, char sep, bool *quoted, uint32_t *offsets)
+{
+    const __m256i vsep = _mm256_set1_epi8(sep);
+    const __m256i vline = _mm256_set1_epi8('\n');
+    const __m256i vquote = _mm256_set1_epi8('"');
+    const __m128i ones = _mm_set1_epi8((char) 0xFF);
+
+    uint32_t *out = offsets;
+
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        const char *block = data + b * BLOCK;
+
+        __m256i lo = _mm256_loadu_si256((const __m256i *) block);
+        __m256i hi = _mm256_loadu_si256((const __m256i *) (block + 32));
+
+        struct masks m;
+        m.seps = movemask_eq(lo, hi, vsep);
+        m.lines = movemask_eq(lo, hi, vline);
+        m.quotes = movemask_eq(lo, hi, vquote);
+
+        __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long) m.quotes), ones, 0);
+        uint64_t inside = (uint64_t) _mm_cvtsi128_si64(product);
+
+        uint64_t bits = structurals(m, inside, quoted);
+        out = flatten(bits, (uint32_t) (b * BLOCK), out);
+    }
+
+    return (size_t) (out - offsets);
+}
+
+static bool has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul");
+}
+
+#endif
+
+/*******************************************************************************
+* public functions
+*******************************************************************************/
+
+size_t csv_index_scan(const char *data, size_t len, char sep, bool *quoted, uint32_t *offsets)
+{
+    assert(data != NULL || len == 0);
+    assert(quoted != NULL);
+    assert(offsets != NULL);
+    assert(len <= UINT32_MAX && "offsets are 32 bits");
+
+    size_t blocks = len / BLOCK;
+    size_t total;
+
+    #if CSV_INDEX_AVX2
+    if (has_avx2()) total = scan_avx2(data, blocks, sep, quoted, offsets);
+    else total = scan_scalar(data, blocks, sep, quoted, offsets);
+    #else
+    total = scan_scalar(data, blocks, sep, quoted, offsets);
+    #endif
+
+    //the tail is padded to a whole block, nul bytes are never structural
+    size_t rest = len - blocks * BLOCK;
+
+    if (rest != 0)
+    {
+        char block[BLOCK] = {0};
+        memcpy(block, data + blocks * BLOCK, rest);
+
+        struct masks m = classify_scalar(block, sep);
+        uint64_t valid = (UINT64_C(1) << rest) - 1;
+
+        m.seps &= valid;
+        m.lines &= valid;
+
+        uint64_t bits = structurals(m, prefix_xor(m.quotes), quoted);
+        total += (size_t) (flatten(bits, (uint32_t) (blocks * BLOCK), offsets + total) - (offsets + total));
+    }
+
+    return total;
+}
+
+/******************************************************************************/
+
+const char *csv_index_kernel(void)
+{
+    #if CSV_INDEX_AVX2
+    if (has_avx2()) return "avx2";
+    #endif
+
+    return "scalar";
+}
@@ -0,0 +1,41 @@
+/*
+* author: Biren Patel
+* description: Structural indexing for CSV text. The input is classified 64
+* bytes at a time into separator, line feed, and quote bitmasks, the quoted
+* regions are resolved with a prefix XOR over the quote mask, and every
+* separator and line feed outside quotes is written to an offset array. The
+* readers then cut rows and fields straight from the offsets instead of
+* searching each field for the next separator.
+*
+* note: on x86-64 the AVX2 and PCLMUL kernel is picked at runtime if the CPU
+* supports it, every other target uses the portable scalar kernel
+*/
+
+#ifndef CSV_INDEX_H
+#define CSV_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+* public function: csv_index_scan
+* purpose: find every separator and line feed of a buffer that is not quoted
+* @ data : text to scan, need not be nul-terminated
+* @ len : total bytes in data, at most UINT32_MAX
+* @ sep : separator between data items
+* @ quoted : true if data starts inside a quoted field, receives the same for
+*           the byte after data so that a buffer can be scanned in pieces
+* @ offsets : receives the offsets into data, must have room for len entries
+* returns: total offsets written, in ascending order
+*******************************************************************************/
+size_t csv_index_scan(const char *data, size_t len, char sep, bool *quoted, uint32_t *offsets);
+
+/*******************************************************************************
+* public function: csv_index_kernel
+* purpose: name of the kernel csv_index_scan runs on this CPU
+* returns: "avx2" or "scalar"
+*******************************************************************************/
+const char *csv_index_kernel(void);
+
+#endif
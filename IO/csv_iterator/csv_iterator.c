@@ -10,6 +10,9 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include "csv_iterator.h"
+#include "csv_index.h"
+#include "csv_parse.h"
+#include "../../Memory/arena.h"
 
 /*******************************************************************************
 * macro: verify_pointer
@@ -31,9 +34,29 @@
 * @ curr_row : pointer to the current row loaded in memory, 0 before first load
 * @ data_available : 0 if no data left to read, 1 otherwise.
 * @ sep : character used for row tokenization
-* @ total_columns : total columns in csv file
+* @ total_columns : total columns selected by the format string, %x excluded
 * @ column_formats : array of data types of each column, encoded as characters
+* @ positions : index within a row of each selected column
+* @ header : copy of the header row, split into nul-terminated names
+* @ names : header name of each selected column, NULL without a header
 * @ data : array of void pointers to one row of data, one pointer per column.
+* @ cells : arena holding the items of the current row, rewound on each load
+* @ block : raw bytes read from the file in blocks of CSV_ITERATOR_BLOCK_LEN
+* @ block_pos : first byte of block not yet handed out as part of a row
+* @ block_len : total bytes in block
+* @ line : assembles a row that spans two or more blocks
+* @ line_capacity : total bytes line can hold, grows to fit the longest row
+* @ offsets : separator positions of the current row, from csv_index_scan
+* @ offset_capacity : total entries offsets can hold, one per byte of a row
+* @ stats : running totals, see struct csv_stats
+* @ fields : start of each item of the current row in the line buffer, NULL if
+*            the item is missing
+* @ lengths : byte length of each item of the current row
+* @ columns : typed arrays of the current batch, NULL until the first batch
+* @ batch_capacity : total rows the arrays of each column can hold
+* @ filter : rows failing the filter are skipped, NULL to keep every row
+* @ values : number each item of the current row converts to, set by the filter
+* @ converted : true for the items of the current row whose values are set
 * purpose: holds CSV metadata
 *******************************************************************************/
 
@@ -45,17 +68,175 @@ struct csv
     char sep;
     int total_columns;
     char *column_formats;
+    int *positions;
+    char *header;
+    char **names;
     void **data;
+    struct arena *cells;
+    char *block;
+    size_t block_pos;
+    size_t block_len;
+    char *line;
+    size_t line_capacity;
+    uint32_t *offsets;
+    size_t offset_capacity;
+    struct csv_stats stats;
+    char **fields;
+    size_t *lengths;
+    struct csv_column *columns;
+    int batch_capacity;
+    struct csv_filter *filter;
+    double *values;
+    bool *converted;
+};
+
+/*******************************************************************************
+* structure: struct csv_filter
+* @ kind : '&' and, '|' or, '<' comparison, '[' range, '=' string equality
+* @ index : column tested by a comparison, range, or string equality
+* @ op : operator of a comparison
+* @ low : value of a comparison, lower bound of a range
+* @ high : upper bound of a range
+* @ text : nul-terminated value of a string equality
+* @ len : byte length of text
+* @ left : first operand of and, or
+* @ right : second operand of and, or
+* purpose: one node of a predicate tree
+*******************************************************************************/
+
+struct csv_filter
+{
+    char kind;
+    int index;
+    enum csv_op op;
+    double low;
+    double high;
+    char *text;
+    size_t len;
+    struct csv_filter *left;
+    struct csv_filter *right;
 };
 
 /*******************************************************************************
 * private function: parse_format_string
-* purpose: use format string to determine number of columns and type of each
+* purpose: use format string to determine number of columns and type of each,
+* and where each column that is not %x sits within a row
 * @ csvfile : pointer to struct csv
 * @ fmt : format string passed by user on contructor
 *******************************************************************************/
 static void parse_format_string(struct csv *csvfile, char *fmt);
 
+/*******************************************************************************
+* private function: read_header
+* purpose: consume the first row as the header and name the selected columns
+* @ csvfile : pointer to struct csv
+* @ names : column names to select, NULL to keep the format string positions
+* returns: false if one of the names is not in the header, true otherwise
+*******************************************************************************/
+static bool read_header(struct csv *csvfile, char **names);
+
+/*******************************************************************************
+* private function: read_line
+* purpose: hand out the next row without its line feed, nul-terminated. A row
+* that lies within the current block is returned in place, only a row that
+* spans blocks is copied into the line buffer.
+* @ csvfile : pointer to struct csv
+* @ len : receives the byte length of the row
+* returns: pointer to the row, NULL at the end of the file
+*******************************************************************************/
+static char *read_line(struct csv *csvfile, size_t *len);
+
+/*******************************************************************************
+* private function: read_fields
+* purpose: read the next row that passes the filter and split it into
+* nul-terminated items
+* @ csvfile : pointer to struct csv
+* returns: false at the end of the file, true otherwise with fields set
+*******************************************************************************/
+static bool read_fields(struct csv *csvfile);
+
+/*******************************************************************************
+* private function: split_fields
+* purpose: read the next row and split it into nul-terminated items
+* @ csvfile : pointer to struct csv
+* returns: false at the end of the file, true otherwise with fields set
+*******************************************************************************/
+static bool split_fields(struct csv *csvfile);
+
+/*******************************************************************************
+* private function: index_line
+* purpose: find every separator of a row outside quotes
+* @ csvfile : pointer to struct csv, receives the positions in offsets
+* @ buffer : the row
+* @ len : byte length of the row
+* returns: total separators found
+*******************************************************************************/
+static size_t index_line(struct csv *csvfile, char *buffer, size_t len);
+
+/*******************************************************************************
+* private function: trim_item
+* purpose: strip the quotes around an item, or the carriage return that ends the
+* last item of a row from a windows file, the same as the views of csv_mmap
+* @ start : first byte of the item, moved past an opening quote
+* @ end : one past the last byte of the item
+* @ last : true if the item ends the row
+* returns: one past the last byte of the trimmed item
+*******************************************************************************/
+static char *trim_item(char **start, char *end, bool last);
+
+/*******************************************************************************
+* private function: filter_create
+* purpose: allocate a predicate node with every operand empty
+* @ kind : node kind, see struct csv_filter
+* @ index : column tested by the node, -1 for and, or
+* returns: pointer to struct csv_filter
+*******************************************************************************/
+static struct csv_filter *filter_create(char kind, int index);
+
+/*******************************************************************************
+* private function: filter_check
+* purpose: assert that every column of a predicate exists and has a matching type
+* @ csvfile : pointer to struct csv
+* @ filter : pointer to struct csv_filter
+*******************************************************************************/
+static void filter_check(struct csv *csvfile, struct csv_filter *filter);
+
+/*******************************************************************************
+* private function: filter_test
+* purpose: evaluate a predicate on the items of the current row, converting only
+* the items that the predicate reaches
+* @ csvfile : pointer to struct csv, with fields set by read_fields
+* @ filter : pointer to struct csv_filter
+* returns: true if the row passes
+*******************************************************************************/
+static bool filter_test(struct csv *csvfile, struct csv_filter *filter);
+
+/*******************************************************************************
+* private function: filter_destroy
+* purpose: release a predicate tree
+* @ filter : pointer to struct csv_filter, may be NULL
+*******************************************************************************/
+static void filter_destroy(struct csv_filter *filter);
+
+/*******************************************************************************
+* private function: reserve_batch
+* purpose: make sure every column can hold n rows, and empty every column
+* @ csvfile : pointer to struct csv
+* @ n : total rows requested for the batch
+*******************************************************************************/
+static void reserve_batch(struct csv *csvfile, int n);
+
+/*******************************************************************************
+* private function: append_cell
+* purpose: convert one item into the next row of its column
+* @ column : column receiving the item
+* @ row : row index of the item within the batch
+* @ start_pos : nul-terminated item, NULL if the item is missing
+* @ len : byte length of the item
+* @ value : the item as converted by the filter, NULL if it is not converted yet
+*******************************************************************************/
+static void append_cell(struct csv_column *column, int row, char *start_pos, size_t len, const double *value);
+
 /*******************************************************************************
 * private function: csv_destroy_row
 * purpose: return the memory blocks held by the current row
@@ -68,10 +249,11 @@ static void csv_destroy_row(struct csv *csvfile);
 * purpose: convert an area in buffer to a specific data type and reserve memory
 * @ csvfile : pointer to struct csv
 * @ start_pos : pointer to a starting point in a buffer
+* @ len : byte length of the item at start_pos
 * @ col : current column undergoing conversion
 * returns: true if successful conversion and allocation, false otherwise.
 *******************************************************************************/
-static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, int col);
+static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, size_t len, int col);
 
 /*******************************************************************************
 * public functions
@@ -86,6 +268,11 @@ struct csv *csv_create(char* filename, char *fmt, char sep)
     parse_format_string(csvfile, fmt);
     assert(csvfile->total_columns >= 1);
     assert(csvfile->column_formats != NULL);
+    assert(csvfile->positions != NULL);
+
+    //names only exist once csv_create_header reads them
+    csvfile->header = NULL;
+    csvfile->names = NULL;
 
     //open the csv file
     csvfile->file_ptr = fopen(filename, "r");
@@ -95,6 +282,46 @@ struct csv *csv_create(char* filename, char *fmt, char sep)
     csvfile->data = malloc(csvfile->total_columns * sizeof(void*));
     VERIFY_POINTER(malloc, csvfile->data);
 
+    //row items are request-scoped, so they are bumped out of a single arena
+    csvfile->cells = arena_create(CSV_ITERATOR_BUF_LEN, sizeof(double));
+    VERIFY_POINTER(arena_create, csvfile->cells);
+
+    //the file is read in large blocks, rows are cut from them in memory
+    csvfile->block = malloc(CSV_ITERATOR_BLOCK_LEN);
+    VERIFY_POINTER(malloc, csvfile->block);
+    csvfile->block_pos = 0;
+    csvfile->block_len = 0;
+
+    csvfile->line = malloc(CSV_ITERATOR_BUF_LEN);
+    VERIFY_POINTER(malloc, csvfile->line);
+    csvfile->line_capacity = CSV_ITERATOR_BUF_LEN;
+
+    //a row can hold no more separators than it holds bytes
+    csvfile->offsets = malloc(CSV_ITERATOR_BUF_LEN * sizeof(uint32_t));
+    VERIFY_POINTER(malloc, csvfile->offsets);
+    csvfile->offset_capacity = CSV_ITERATOR_BUF_LEN;
+
+    csvfile->stats = (struct csv_stats) {0, 0, 0, 0};
+
+    csvfile->fields = malloc(csvfile->total_columns * sizeof(char*));
+    VERIFY_POINTER(malloc, csvfile->fields);
+
+    csvfile->lengths = malloc(csvfile->total_columns * sizeof(size_t));
+    VERIFY_POINTER(malloc, csvfile->lengths);
+
+    //batch arrays are only needed once csv_next_batch is called
+    csvfile->columns = NULL;
+    csvfile->batch_capacity = 0;
+
+    csvfile->filter = NULL;
+
+    //a filter keeps the numbers it converts, so a kept row is parsed only once
+    csvfile->values = malloc(csvfile->total_columns * sizeof(double));
+    VERIFY_POINTER(malloc, csvfile->values);
+
+    csvfile->converted = calloc(csvfile->total_columns, sizeof(bool));
+    VERIFY_POINTER(calloc, csvfile->converted);
+
     //set remaining members
     csvfile->curr_row = 0;
     csvfile->data_available = true;
@@ -117,6 +344,33 @@ struct csv *csv_create(char* filename, char *fmt, char sep)
 
 /******************************************************************************/
 
+struct csv *csv_create_header(char *filename, char *fmt, char sep, char **names)
+{
+    //names select the columns, so a %x column to skip has no place in fmt
+    if (names != NULL)
+    {
+        for (char *curr = strchr(fmt, '%'); curr != NULL; curr = strchr(curr + 1, '%'))
+        {
+            char *type = curr + 1;
+            while (isdigit(*type)) ++type;
+
+            if (*type == 'x') return NULL;
+        }
+    }
+
+    struct csv *csvfile = csv_create(filename, fmt, sep);
+
+    if (read_header(csvfile, names) == false)
+    {
+        csv_destroy(csvfile, false);
+        return NULL;
+    }
+
+    return csvfile;
+}
+
+/******************************************************************************/
+
 void csv_destroy(struct csv *csvfile, bool flush_curr)
 {
     #if CSV_ITERATOR_DEBUG
@@ -132,7 +386,37 @@ void csv_destroy(struct csv *csvfile, bool flush_curr)
 
     fclose(csvfile->file_ptr);
     free(csvfile->column_formats);
+    free(csvfile->positions);
+    free(csvfile->header);
+    free(csvfile->names);
     free(csvfile->data); //make sure pointed data gets free'd beforehand
+    arena_destroy(csvfile->cells);
+    free(csvfile->block);
+    free(csvfile->line);
+    free(csvfile->offsets);
+    free(csvfile->fields);
+    free(csvfile->lengths);
+
+    if (csvfile->columns != NULL)
+    {
+        for (int i = 0; i < csvfile->total_columns; ++i)
+        {
+            struct csv_column *column = csvfile->columns + i;
+
+            free(column->ints);
+            free(column->doubles);
+            free(column->chars);
+            free(column->offsets);
+            free(column->bytes);
+            free(column->nulls);
+        }
+
+        free(csvfile->columns);
+    }
+
+    filter_destroy(csvfile->filter);
+    free(csvfile->values);
+    free(csvfile->converted);
     free(csvfile);
 
     #if CSV_ITERATOR_DEBUG
@@ -167,19 +451,15 @@ bool csv_next(struct csv *csvfile)
         csv_destroy_row(csvfile);
     }
 
-    //stage 2: set up a temporary buffer to hold next line in csv
+    //stage 2: read next line, but if end of CSV then flip flag and return early.
     assert(csvfile->data_available == true);
-    char *buffer = malloc(CSV_ITERATOR_BUF_LEN);
-    VERIFY_POINTER(malloc, buffer)
 
-    //read next line, but if end of CSV then flip flag and return early.
-    if (fgets(buffer, CSV_ITERATOR_BUF_LEN, csvfile->file_ptr) == NULL)
+    if (read_fields(csvfile) == false)
     {
         #if CSV_ITERATOR_DEBUG
         printf("no data available to read, exiting early\n\n");
         #endif
 
-        free(buffer);
         csvfile->data_available = false;
         return false;
     }
@@ -187,67 +467,43 @@ bool csv_next(struct csv *csvfile)
     //a final paranoid check for data availability
     assert(csvfile->data_available == true);
 
-    //replace line feed in buffer with a null character
-    if (strchr(buffer, '\n'))
-    {
-        #if CSV_ITERATOR_DEBUG
-        printf("read line into buffer, replaced line feed with null char\n");
-        #endif
-
-        buffer[strcspn(buffer, "\n")] = '\0';
-    }
-
-    //variables used in the following for loop
-    char *lag = buffer;
-    char *lead;
-
     //on each loop, load into memory the data from column i of the current row
-    for(size_t i = 0; i < csvfile->total_columns; ++i)
+    for(int i = 0; i < csvfile->total_columns; ++i)
     {
-        //replace the next separator on or ahead of lag with a null character
-        char *next_separator = strchr(lag, csvfile->sep);
-        if (next_separator != NULL) *next_separator = '\0';
-
-        //track the lead pointer to this new null character
-        lead = strchr(lag, '\0');
-
-        #if CSV_ITERATOR_DEBUG
-        printf("now on loop iteration: %d\n", (int) i);
-        printf("\tlag points to character: %c\n", *lag);
-        printf("\tlead points just before character: %c\n", *(lead+1));
-        #endif
-
-        //at this specific point in the loop, after lag and lead have been set,
-        //there is a missing value if lag points to the null character.
-        if (*lag == '\0')
+        //NULL indicates that there is a missing value
+        if (csvfile->fields[i] == NULL)
         {
-            #if CSV_ITERATOR_DEBUG
-            printf("\tmissing value, moving to next iteration\n");
-            #endif
-
-            //NULL indicates that there is a missing value
             csvfile->data[i] = NULL;
-            lag = lead + 1;
             continue;
         }
 
         //no missing data, convert the item data type and reserve memory for it
         bool status;
-        status = csv_convert_reserve(csvfile, lag, i);
+        status = csv_convert_reserve(csvfile, csvfile->fields[i], csvfile->lengths[i], i);
         assert(status == true);
-
-        //lag leaps over lead to new position before start of next iteration.
-        lag = lead + 1;
-        assert(lag == lead + 1);
     }
 
     ++csvfile->curr_row;
-    free(buffer);
     return true;
 }
 
 /******************************************************************************/
 
+const char *csv_get_name(struct csv *csvfile, int index)
+{
+    assert(csvfile != NULL);
+    assert(index >= 0);
+
+    if (csvfile->names == NULL || index >= csvfile->total_columns)
+    {
+        return NULL;
+    }
+
+    return csvfile->names[index];
+}
+
+/******************************************************************************/
+
 void *csv_get_ptr(struct csv *csvfile, int index)
 {
     assert(csvfile != NULL);
@@ -263,6 +519,156 @@ void *csv_get_ptr(struct csv *csvfile, int index)
     }
 }
 
+/******************************************************************************/
+
+int csv_next_batch(struct csv *csvfile, int n)
+{
+    assert(csvfile != NULL);
+    assert(n >= 1);
+
+    if (csvfile->data_available == false) return 0;
+
+    //the batch replaces the current row, whose items are no longer reachable
+    if (csvfile->curr_row != 0) csv_destroy_row(csvfile);
+
+    reserve_batch(csvfile, n);
+
+    int rows = 0;
+
+    while (rows < n)
+    {
+        if (read_fields(csvfile) == false)
+        {
+            csvfile->data_available = false;
+            break;
+        }
+
+        for (int i = 0; i < csvfile->total_columns; ++i)
+        {
+            const double *value = csvfile->converted[i] ? csvfile->values + i : NULL;
+            append_cell(csvfile->columns + i, rows, csvfile->fields[i], csvfile->lengths[i], value);
+        }
+
+        ++rows;
+    }
+
+    //csv_get_ptr has no row to point into until the next csv_next
+    for (int i = 0; i < csvfile->total_columns; ++i) csvfile->data[i] = NULL;
+
+    csvfile->curr_row += rows;
+    return rows;
+}
+
+/******************************************************************************/
+
+struct csv_stats csv_get_stats(struct csv *csvfile)
+{
+    assert(csvfile != NULL);
+
+    return csvfile->stats;
+}
+
+/******************************************************************************/
+
+const struct csv_column *csv_get_column(struct csv *csvfile, int index)
+{
+    assert(csvfile != NULL);
+    assert(index >= 0);
+
+    if (csvfile->columns == NULL || index >= csvfile->total_columns)
+    {
+        return NULL;
+    }
+
+    return csvfile->columns + index;
+}
+
+/******************************************************************************/
+
+struct csv_filter *csv_filter_compare(int index, enum csv_op op, double value)
+{
+    assert(index >= 0);
+
+    struct csv_filter *filter = filter_create('<', index);
+    filter->op = op;
+    filter->low = value;
+
+    return filter;
+}
+
+/******************************************************************************/
+
+struct csv_filter *csv_filter_range(int index, double low, double high)
+{
+    assert(index >= 0);
+
+    struct csv_filter *filter = filter_create('[', index);
+    filter->low = low;
+    filter->high = high;
+
+    return filter;
+}
+
+/******************************************************************************/
+
+struct csv_filter *csv_filter_equal(int index, const char *value)
+{
+    assert(index >= 0);
+    assert(value != NULL);
+
+    struct csv_filter *filter = filter_create('=', index);
+    filter->len = strlen(value);
+
+    filter->text = malloc(filter->len + 1);
+    VERIFY_POINTER(malloc, filter->text);
+    memcpy(filter->text, value, filter->len + 1);
+
+    return filter;
+}
+
+/******************************************************************************/
+
+struct csv_filter *csv_filter_and(struct csv_filter *left, struct csv_filter *right)
+{
+    assert(left != NULL);
+    assert(right != NULL);
+
+    struct csv_filter *filter = filter_create('&', -1);
+    filter->left = left;
+    filter->right = right;
+
+    return filter;
+}
+
+/******************************************************************************/
+
+struct csv_filter *csv_filter_or(struct csv_filter *left, struct csv_filter *right)
+{
+    assert(left != NULL);
+    assert(right != NULL);
+
+    struct csv_filter *filter = filter_create('|', -1);
+    filter->left = left;
+    filter->right = right;
+
+    return filter;
+}
+
+/******************************************************************************/
+
+void csv_set_filter(struct csv *csvfile, struct csv_filter *filter)
+{
+    assert(csvfile != NULL);
+
+    if (filter != NULL) filter_check(csvfile, filter);
+
+    filter_destroy(csvfile->filter);
+    csvfile->filter = filter;
+
+    //values converted by the previous filter must not outlive it
+    memset(csvfile->converted, 0, csvfile->total_columns * sizeof(bool));
+}
+
 /*******************************************************************************
 * private functions
 *******************************************************************************/
@@ -295,8 +701,9 @@ static void parse_format_string(struct csv *csvfile, char *fmt)
             new_character = *curr;
 
             //reallocate column_formats array
-            realloc(column_formats, num_curr_columns + num_new_columns);
-            VERIFY_POINTER(realloc, column_formats);
+            char *tmp = realloc(column_formats, num_curr_columns + num_new_columns);
+            VERIFY_POINTER(realloc, tmp);
+            column_formats = tmp;
 
             //and populate each new byte with the new character
             size_t i = num_curr_columns;
@@ -311,31 +718,517 @@ static void parse_format_string(struct csv *csvfile, char *fmt)
         }
     }
 
+    assert(num_curr_columns >= 1 && "format string holds no columns");
+
+    //skipped columns keep their place in the row but get no slot in data
+    int *positions = malloc(num_curr_columns * sizeof(int));
+    VERIFY_POINTER(malloc, positions);
+
+    int num_selected = 0;
+
+    for (int i = 0; i < num_curr_columns; ++i)
+    {
+        if (column_formats[i] == 'x') continue;
+
+        column_formats[num_selected] = column_formats[i];
+        positions[num_selected] = i;
+        ++num_selected;
+    }
+
     //set struct members
-    csvfile->total_columns = num_curr_columns;
+    csvfile->total_columns = num_selected;
     csvfile->column_formats = column_formats;
+    csvfile->positions = positions;
 }
 
 /******************************************************************************/
 
-static void csv_destroy_row(struct csv *csvfile)
+static bool read_header(struct csv *csvfile, char **names)
 {
-    assert(csvfile != NULL);
-    assert(csvfile->data_available == true);
+    size_t len = 0;
+    char *line = read_line(csvfile, &len);
 
-    for(size_t i = 0; i < csvfile->total_columns; ++i)
+    //the copy outlives the block, and its separators become nul characters
+    csvfile->header = malloc(len + 1);
+    VERIFY_POINTER(malloc, csvfile->header);
+
+    if (line != NULL) memcpy(csvfile->header, line, len);
+    csvfile->header[len] = '\0';
+
+    size_t total_separators = index_line(csvfile, csvfile->header, len);
+
+    char **titles = malloc((total_separators + 1) * sizeof(char*));
+    VERIFY_POINTER(malloc, titles);
+
+    for (size_t p = 0; p <= total_separators; ++p)
     {
+        char *start = p == 0 ? csvfile->header : csvfile->header + csvfile->offsets[p - 1] + 1;
+        char *end = p < total_separators ? csvfile->header + csvfile->offsets[p] : csvfile->header + len;
+
+        end = trim_item(&start, end, p == total_separators);
+        *end = '\0';
+        titles[p] = start;
+    }
+
+    //every name is looked up once, so a linear search of the header is enough
+    if (names != NULL)
+    {
+        for (int i = 0; i < csvfile->total_columns; ++i)
+        {
+            assert(names[i] != NULL);
+
+            size_t p = 0;
+            while (p <= total_separators && strcmp(titles[p], names[i]) != 0) ++p;
+
+            if (p > total_separators)
+            {
+                free(titles);
+                return false;
+            }
+
+            csvfile->positions[i] = (int) p;
+        }
+    }
+
+    csvfile->names = malloc(csvfile->total_columns * sizeof(char*));
+    VERIFY_POINTER(malloc, csvfile->names);
+
+    for (int i = 0; i < csvfile->total_columns; ++i)
+    {
+        size_t p = (size_t) csvfile->positions[i];
+        csvfile->names[i] = p <= total_separators ? titles[p] : NULL;
+    }
+
+    free(titles);
+    return true;
+}
+
+/******************************************************************************/
+
+static char *read_line(struct csv *csvfile, size_t *len)
+{
+    size_t used = 0;
+
+    while (true)
+    {
+        //refill once every byte of the block has been handed out
+        if (csvfile->block_pos == csvfile->block_len)
+        {
+            csvfile->block_len = fread(csvfile->block, 1, CSV_ITERATOR_BLOCK_LEN, csvfile->file_ptr);
+            csvfile->block_pos = 0;
+
+            if (csvfile->block_len == 0)
+            {
+                //the last row of a file without a final line feed
+                if (used == 0) return NULL;
+
+                csvfile->line[used] = '\0';
+                *len = used;
+                return csvfile->line;
+            }
+        }
+
+        char *start = csvfile->block + csvfile->block_pos;
+        size_t available = csvfile->block_len - csvfile->block_pos;
+
+        char *feed = memchr(start, '\n', available);
+        size_t take = feed != NULL ? (size_t) (feed - start) : available;
+
+        if (feed != NULL && used == 0)
+        {
+            #if CSV_ITERATOR_DEBUG
+            printf("row lies within the block, replaced line feed with null char\n");
+            #endif
+
+            *feed = '\0';
+            csvfile->block_pos += take + 1;
+            *len = take;
+            return start;
+        }
+
+        //the row continues past the block, so it is assembled in the line buffer
+        if (used + take + 1 > csvfile->line_capacity)
+        {
+            size_t capacity = csvfile->line_capacity * 2;
+            while (used + take + 1 > capacity) capacity *= 2;
+
+            char *tmp = realloc(csvfile->line, capacity);
+            VERIFY_POINTER(realloc, tmp);
+
+            csvfile->line = tmp;
+            csvfile->line_capacity = capacity;
+        }
+
+        memcpy(csvfile->line + used, start, take);
+        used += take;
+        csvfile->block_pos += feed != NULL ? take + 1 : take;
+
+        if (feed != NULL)
+        {
+            csvfile->line[used] = '\0';
+            *len = used;
+            return csvfile->line;
+        }
+    }
+}
+
+/******************************************************************************/
+
+static bool read_fields(struct csv *csvfile)
+{
+    //rows are read until one passes the filter, a rejected row costs no more
+    //than locating its items and converting the ones the filter tests
+    do
+    {
+        if (split_fields(csvfile) == false) return false;
+        if (csvfile->filter != NULL) memset(csvfile->converted, 0, csvfile->total_columns * sizeof(bool));
+    }
+    while (csvfile->filter != NULL && filter_test(csvfile, csvfile->filter) == false);
+
+    ++csvfile->stats.rows_emitted;
+    return true;
+}
+
+/******************************************************************************/
+
+static bool split_fields(struct csv *csvfile)
+{
+    size_t len;
+    char *buffer = read_line(csvfile, &len);
+
+    if (buffer == NULL) return false;
+
+    ++csvfile->stats.rows_scanned;
+    csvfile->stats.bytes_scanned += len + 1;
+    if (len > csvfile->stats.max_row_len) csvfile->stats.max_row_len = len;
+
+    size_t total_separators = index_line(csvfile, buffer, len);
+
+    //only the selected columns are cut out of the row, in whatever order
+    for(int i = 0; i < csvfile->total_columns; ++i)
+    {
+        size_t p = (size_t) csvfile->positions[i];
+
+        //a short row is missing every column past its last item
+        if (p > total_separators)
+        {
+            csvfile->fields[i] = NULL;
+            continue;
+        }
+
+        //the item runs from just past separator p - 1 up to separator p
+        char *start = p == 0 ? buffer : buffer + csvfile->offsets[p - 1] + 1;
+        char *end = p < total_separators ? buffer + csvfile->offsets[p] : buffer + len;
+
+        end = trim_item(&start, end, p == total_separators);
+        *end = '\0';
+
         #if CSV_ITERATOR_DEBUG
-        printf("freeing memory held by previous row\n");
+        printf("column %d is item %zu of the row\n", i, p);
+        if (start == end) printf("\tmissing value, moving to next iteration\n");
         #endif
 
-        free(csvfile->data[i]);
+        csvfile->fields[i] = start == end ? NULL : start;
+        csvfile->lengths[i] = (size_t) (end - start);
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+
+static size_t index_line(struct csv *csvfile, char *buffer, size_t len)
+{
+    //the offset array grows with the longest row, the same as the line buffer
+    if (len > csvfile->offset_capacity)
+    {
+        size_t capacity = csvfile->offset_capacity * 2;
+        while (len > capacity) capacity *= 2;
+
+        uint32_t *tmp = realloc(csvfile->offsets, capacity * sizeof(uint32_t));
+        VERIFY_POINTER(realloc, tmp);
+
+        csvfile->offsets = tmp;
+        csvfile->offset_capacity = capacity;
+    }
+
+    //index every separator of the row in one pass instead of one per column
+    bool quoted = false;
+    return csv_index_scan(buffer, len, csvfile->sep, &quoted, csvfile->offsets);
+}
+
+/******************************************************************************/
+
+static char *trim_item(char **start, char *end, bool last)
+{
+    char *first = *start;
+
+    if (first < end && *first == '"')
+    {
+        //the item runs to its last quote, trailing bytes are dropped
+        char *close = end - 1;
+        while (close > first && *close != '"') --close;
+
+        if (close == first) close = end;
+
+        *start = first + 1;
+        return close;
+    }
+
+    if (last && end > first && end[-1] == '\r') --end;
+
+    return end;
+}
+
+/******************************************************************************/
+
+static struct csv_filter *filter_create(char kind, int index)
+{
+    struct csv_filter *filter = malloc(sizeof(struct csv_filter));
+    VERIFY_POINTER(malloc, filter);
+
+    filter->kind = kind;
+    filter->index = index;
+    filter->op = CSV_EQ;
+    filter->low = 0.0;
+    filter->high = 0.0;
+    filter->text = NULL;
+    filter->len = 0;
+    filter->left = NULL;
+    filter->right = NULL;
+
+    return filter;
+}
+
+/******************************************************************************/
+
+static void filter_check(struct csv *csvfile, struct csv_filter *filter)
+{
+    if (filter->kind == '&' || filter->kind == '|')
+    {
+        filter_check(csvfile, filter->left);
+        filter_check(csvfile, filter->right);
+        return;
+    }
+
+    assert(filter->index < csvfile->total_columns && "filter column out of bounds");
+
+    char format = csvfile->column_formats[filter->index];
+
+    if (filter->kind == '=')
+    {
+        assert((format == 's' || format == 'c') && "string filter on a number column");
+    }
+    else
+    {
+        assert((format == 'd' || format == 'f') && "number filter on a text column");
+    }
+
+    (void) format;
+}
+
+/******************************************************************************/
+
+static bool filter_test(struct csv *csvfile, struct csv_filter *filter)
+{
+    switch (filter->kind)
+    {
+        case '&':
+                return filter_test(csvfile, filter->left) && filter_test(csvfile, filter->right);
+
+        case '|':
+                return filter_test(csvfile, filter->left) || filter_test(csvfile, filter->right);
+    }
+
+    char *item = csvfile->fields[filter->index];
+    size_t len = csvfile->lengths[filter->index];
+
+    if (item == NULL) return false;
+
+    if (filter->kind == '=')
+    {
+        return len == filter->len && memcmp(item, filter->text, len) == 0;
+    }
+
+    //the same conversion as csv_convert_reserve, so the filter sees the value
+    //that the client would get, and kept for it when the row passes
+    double *value = csvfile->values + filter->index;
+
+    if (csvfile->converted[filter->index] == false)
+    {
+        if (csvfile->column_formats[filter->index] == 'd')
+        {
+            int integer = 0;
+            csv_parse_int(item, item + len, &integer);
+            *value = (double) integer;
+        }
+        else
+        {
+            *value = 0.0;
+            csv_parse_double(item, item + len, value);
+        }
+
+        csvfile->converted[filter->index] = true;
+    }
+
+    if (filter->kind == '[')
+    {
+        return filter->low <= *value && *value <= filter->high;
     }
+
+    switch (filter->op)
+    {
+        case CSV_LT: return *value < filter->low;
+        case CSV_LE: return *value <= filter->low;
+        case CSV_EQ: return *value == filter->low;
+        case CSV_NE: return *value != filter->low;
+        case CSV_GE: return *value >= filter->low;
+        case CSV_GT: return *value > filter->low;
+    }
+
+    return false;
+}
+
+/******************************************************************************/
+
+static void filter_destroy(struct csv_filter *filter)
+{
+    if (filter == NULL) return;
+
+    filter_destroy(filter->left);
+    filter_destroy(filter->right);
+    free(filter->text);
+    free(filter);
+}
+
+/******************************************************************************/
+
+static void reserve_batch(struct csv *csvfile, int n)
+{
+    if (csvfile->columns == NULL)
+    {
+        csvfile->columns = calloc(csvfile->total_columns, sizeof(struct csv_column));
+        VERIFY_POINTER(calloc, csvfile->columns);
+
+        for (int i = 0; i < csvfile->total_columns; ++i)
+        {
+            csvfile->columns[i].format = csvfile->column_formats[i];
+        }
+    }
+
+    for (int i = 0; i < csvfile->total_columns; ++i)
+    {
+        struct csv_column *column = csvfile->columns + i;
+
+        //only the array matching the format of the column is ever allocated
+        if (n > csvfile->batch_capacity)
+        {
+            size_t mask_bytes = (size_t) (n + 7) / 8;
+
+            column->nulls = realloc(column->nulls, mask_bytes);
+            VERIFY_POINTER(realloc, column->nulls);
+
+            switch (column->format)
+            {
+                case 'd':
+                        column->ints = realloc(column->ints, n * sizeof(int));
+                        VERIFY_POINTER(realloc, column->ints);
+                        break;
+
+                case 'f':
+                        column->doubles = realloc(column->doubles, n * sizeof(double));
+                        VERIFY_POINTER(realloc, column->doubles);
+                        break;
+
+                case 'c':
+                        column->chars = realloc(column->chars, n);
+                        VERIFY_POINTER(realloc, column->chars);
+                        break;
+
+                case 's':
+                        column->offsets = realloc(column->offsets, (n + 1) * sizeof(size_t));
+                        VERIFY_POINTER(realloc, column->offsets);
+                        break;
+            }
+        }
+
+        memset(column->nulls, 0, (size_t) (n + 7) / 8);
+        if (column->format == 's') column->offsets[0] = 0;
+    }
+
+    if (n > csvfile->batch_capacity) csvfile->batch_capacity = n;
+}
+
+/******************************************************************************/
+
+static void append_cell(struct csv_column *column, int row, char *start_pos, size_t len, const double *value)
+{
+    if (start_pos == NULL)
+    {
+        column->nulls[row / 8] |= (unsigned char) (1u << (row % 8));
+    }
+
+    switch (column->format)
+    {
+        case 'd':
+                column->ints[row] = 0;
+                if (value) column->ints[row] = (int) *value;
+                else if (start_pos) csv_parse_int(start_pos, start_pos + len, column->ints + row);
+                break;
+
+        case 'f':
+                column->doubles[row] = 0.0;
+                if (value) column->doubles[row] = *value;
+                else if (start_pos) csv_parse_double(start_pos, start_pos + len, column->doubles + row);
+                break;
+
+        case 'c':
+                column->chars[row] = start_pos ? *start_pos : '\0';
+                break;
+
+        case 's':
+        {
+                //strings are packed back to back, each one nul-terminated
+                size_t used = column->offsets[row];
+                if (start_pos) ++len; else len = 0;
+
+                if (used + len > column->capacity)
+                {
+                    size_t capacity = column->capacity ? column->capacity : CSV_ITERATOR_BUF_LEN;
+                    while (used + len > capacity) capacity *= 2;
+
+                    char *tmp = realloc(column->bytes, capacity);
+                    VERIFY_POINTER(realloc, tmp);
+
+                    column->bytes = tmp;
+                    column->capacity = capacity;
+                }
+
+                if (len != 0) memcpy(column->bytes + used, start_pos, len);
+                column->offsets[row + 1] = used + len;
+                break;
+        }
+    }
+}
+
+/******************************************************************************/
+
+static void csv_destroy_row(struct csv *csvfile)
+{
+    assert(csvfile != NULL);
+    assert(csvfile->data_available == true);
+
+    #if CSV_ITERATOR_DEBUG
+    printf("freeing memory held by previous row\n");
+    #endif
+
+    //every item of the row was bumped out of the arena, release them at once
+    arena_reset(csvfile->cells);
 }
 
 /******************************************************************************/
 
-static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, int col)
+static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, size_t len, int col)
 {
     bool status = false;
 
@@ -346,9 +1239,11 @@ static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, int col)
     switch (csvfile->column_formats[col])
     {
         case 'd':
-                i_ptr = malloc(sizeof(int));
-                VERIFY_POINTER(malloc, i_ptr);
-                *i_ptr = strtol(start_pos, NULL, 10);
+                i_ptr = arena_alloc(csvfile->cells, sizeof(int));
+                VERIFY_POINTER(arena_alloc, i_ptr);
+                *i_ptr = 0;
+                if (csvfile->converted[col]) *i_ptr = (int) csvfile->values[col];
+                else csv_parse_int(start_pos, start_pos + len, i_ptr);
                 csvfile->data[col] = i_ptr;
 
                 #if CSV_ITERATOR_DEBUG
@@ -359,8 +1254,8 @@ static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, int col)
                 break;
 
         case 'c':
-                c_ptr = malloc(1);
-                VERIFY_POINTER(malloc, c_ptr);
+                c_ptr = arena_alloc(csvfile->cells, 1);
+                VERIFY_POINTER(arena_alloc, c_ptr);
                 *c_ptr = *start_pos;
                 csvfile->data[col] = c_ptr;
 
@@ -372,9 +1267,11 @@ static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, int col)
                 break;
 
         case 'f':
-                d_ptr = malloc(sizeof(double));
-                VERIFY_POINTER(malloc, d_ptr);
-                *d_ptr = strtod(start_pos, NULL);
+                d_ptr = arena_alloc(csvfile->cells, sizeof(double));
+                VERIFY_POINTER(arena_alloc, d_ptr);
+                *d_ptr = 0.0;
+                if (csvfile->converted[col]) *d_ptr = csvfile->values[col];
+                else csv_parse_double(start_pos, start_pos + len, d_ptr);
                 csvfile->data[col] = d_ptr;
 
                 #if CSV_ITERATOR_DEBUG
@@ -385,9 +1282,9 @@ static bool csv_convert_reserve(struct csv *csvfile, char *start_pos, int col)
                 break;
 
         case 's':
-                c_ptr = malloc(strlen(start_pos) + 1);
-                VERIFY_POINTER(malloc, c_ptr);
-                strcpy(c_ptr, start_pos);
+                c_ptr = arena_alloc(csvfile->cells, len + 1);
+                VERIFY_POINTER(arena_alloc, c_ptr);
+                memcpy(c_ptr, start_pos, len + 1);
                 csvfile->data[col] = c_ptr;
 
                 #if CSV_ITERATOR_DEBUG
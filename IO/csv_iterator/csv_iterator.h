@@ -7,21 +7,30 @@
 * from memory. The goal of this API is to obtain some functionality and memory
 * efficiency similar to a python generator.
 *
-* note: does not yet handle csv with header
 * note: only handles data types int (%d), double (%f), char(%c), and string (%s)
+* note: %x skips a column, it is only scanned for its separator and never
+*       converted or allocated. csv_create_header also selects columns by name.
+* note: a filter drops rows as soon as the columns it tests are converted, the
+*       other columns of a rejected row are never converted
+* note: row items live in an arena, compile with ../../Memory/arena.c
+* note: rows are split with the structural index and numbers are converted with
+*       the fast parsers, compile with csv_index.c and csv_parse.c
 */
 
 #ifndef CSV_ITERATOR_H
 #define CSV_ITERATOR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /*******************************************************************************
 * client-modifiable parameters
-* @ CSV_ITERATOR_BUF_LEN : 1 KiB temp buffer holds raw contents of a csv row
+* @ CSV_ITERATOR_BUF_LEN : 1 KiB initial row buffer, grows to fit the longest row
+* @ CSV_ITERATOR_BLOCK_LEN : 256 KiB of the file are read at a time
 * @ CSV_ITERATOR_DEBUG : set to 1 for verbose debugging output to stdout
 *******************************************************************************/
 #define CSV_ITERATOR_BUF_LEN 1024
+#define CSV_ITERATOR_BLOCK_LEN (256 * 1024)
 #define CSV_ITERATOR_DEBUG 0
 
 /*******************************************************************************
@@ -30,6 +39,70 @@
 *******************************************************************************/
 struct csv;
 
+/*******************************************************************************
+* structure: struct csv_stats
+* purpose: running totals over the life of a struct csv
+* @ rows_scanned : total rows read from the file, header excluded
+* @ rows_emitted : total rows that passed the filter, all rows without one
+* @ bytes_scanned : total bytes of those rows, line feeds included
+* @ max_row_len : byte length of the longest row, line feed excluded
+*******************************************************************************/
+struct csv_stats
+{
+    size_t rows_scanned;
+    size_t rows_emitted;
+    size_t bytes_scanned;
+    size_t max_row_len;
+};
+
+/*******************************************************************************
+* structure: struct csv_filter
+* purpose: predicate on the columns of a row, built with the csv_filter_*
+* functions and handed to csv_set_filter
+*******************************************************************************/
+struct csv_filter;
+
+/*******************************************************************************
+* enum: csv_op
+* purpose: comparison operators of csv_filter_compare, item op value
+*******************************************************************************/
+enum csv_op
+{
+    CSV_LT,
+    CSV_LE,
+    CSV_EQ,
+    CSV_NE,
+    CSV_GE,
+    CSV_GT
+};
+
+/*******************************************************************************
+* structure: struct csv_column
+* purpose: one column of a batch from csv_next_batch, stored contiguously
+* @ format : column type from the format string, one of d, f, c, s
+* @ ints : values of a %d column
+* @ doubles : values of a %f column
+* @ chars : values of a %c column
+* @ offsets : for a %s column, row i is the nul-terminated string at
+*             bytes + offsets[i], and offsets[i + 1] is where the next row starts
+* @ bytes : packed strings of a %s column
+* @ capacity : bytes reserved for bytes, managed by csv_next_batch
+* @ nulls : bitmap of missing values, bit i % 8 of byte i / 8 is set if row i
+*           is missing. A missing number or char reads as zero.
+* note: only the array matching the format is allocated, the others are NULL
+*******************************************************************************/
+struct csv_column
+{
+    char format;
+    int *ints;
+    double *doubles;
+    char *chars;
+    size_t *offsets;
+    char *bytes;
+    size_t capacity;
+    unsigned char *nulls;
+};
+
 /*******************************************************************************
 * public function: csv_create
 * purpose: constructor
@@ -37,9 +110,25 @@ struct csv;
 * @ fmt : string specifiying format of a single row in the CSV file
 * @ sep : separator between data items in CSV, must be same separator in fmt
 * returns: pointer to struct csv
+* note: index 0 of csv_get_ptr and csv_get_column is the first column of fmt
+*       that is not %x, index 1 the next one, and so on
 *******************************************************************************/
 struct csv *csv_create(char* filename, char *fmt, char sep);
 
+/*******************************************************************************
+* public function: csv_create_header
+* purpose: constructor for a CSV file whose first row holds the column names
+* @ filename : path for CSV file
+* @ fmt : if names is NULL, the same as csv_create. otherwise the type of each
+*        name in order, i.e. "%1f %2d" for three names, and %x is not allowed.
+* @ sep : separator between data items in CSV
+* @ names : NULL, or the column names to select, in the order they are wanted.
+*          a name may surround itself in quotes in the header row.
+* returns: pointer to struct csv, NULL if a name is not in the header row or if
+*          names is not NULL and fmt holds a %x
+*******************************************************************************/
+struct csv *csv_create_header(char *filename, char *fmt, char sep, char **names);
+
 /*******************************************************************************
 * public function: csv_destroy
 * purpose: destructor
@@ -58,6 +147,16 @@ void csv_destroy(struct csv *csvfile, bool flush_curr);
 *******************************************************************************/
 bool csv_next(struct csv *csvfile);
 
+/*******************************************************************************
+* public function: csv_get_name
+* purpose: get the header name of a column
+* @ csvfile : pointer to struct csv
+* @ index : index of the column, the same as for csv_get_ptr
+* returns: the name, NULL if out of bounds or if csvfile was not created with
+*          csv_create_header
+*******************************************************************************/
+const char *csv_get_name(struct csv *csvfile, int index);
+
 /*******************************************************************************
 * public function: csv_get_ptr
 * purpose: get pointer to an item in the current row
@@ -82,4 +181,92 @@ void *csv_get_ptr(struct csv *csvfile, int index);
 #define csv_get(struct_csv_pointer, index, dtype)                              \
         *((dtype *) csv_get_ptr(struct_csv_pointer, index))                    \
 
+/*******************************************************************************
+* public function: csv_next_batch
+* purpose: load up to n rows at once, column by column, into typed arrays
+* @ csvfile : pointer to struct csv
+* @ n : maximum rows to load
+* returns: total rows loaded, 0 if no data was left to read
+* note: the batch replaces both the previous batch and the current row, so
+*       csv_get_ptr returns NULL until the next csv_next. the arrays are reused
+*       by the next batch, copy out anything that must outlive it.
+*******************************************************************************/
+int csv_next_batch(struct csv *csvfile, int n);
+
+/*******************************************************************************
+* public function: csv_get_stats
+* purpose: snapshot of the running totals
+* @ csvfile : pointer to struct csv
+*******************************************************************************/
+struct csv_stats csv_get_stats(struct csv *csvfile);
+
+/*******************************************************************************
+* public function: csv_get_column
+* purpose: get a column of the current batch
+* @ csvfile : pointer to struct csv
+* @ index : index of the column in the format string
+* returns: pointer to the column, NULL if out of bounds or before any batch
+*******************************************************************************/
+const struct csv_column *csv_get_column(struct csv *csvfile, int index);
+
+/*******************************************************************************
+* public function: csv_filter_compare
+* purpose: predicate comparing a %d or %f column with a number
+* @ index : index of the column, the same as for csv_get_ptr
+* @ op : comparison operator, the item is on the left
+* @ value : right-hand side of the comparison
+* returns: pointer to struct csv_filter
+*******************************************************************************/
+struct csv_filter *csv_filter_compare(int index, enum csv_op op, double value);
+
+/*******************************************************************************
+* public function: csv_filter_range
+* purpose: predicate on a %d or %f column, true if low <= item <= high
+* @ index : index of the column, the same as for csv_get_ptr
+* @ low : lower bound, inclusive
+* @ high : upper bound, inclusive
+* returns: pointer to struct csv_filter
+*******************************************************************************/
+struct csv_filter *csv_filter_range(int index, double low, double high);
+
+/*******************************************************************************
+* public function: csv_filter_equal
+* purpose: predicate on a %s or %c column, true if the item reads exactly value
+* @ index : index of the column, the same as for csv_get_ptr
+* @ value : nul-terminated string, copied
+* returns: pointer to struct csv_filter
+*******************************************************************************/
+struct csv_filter *csv_filter_equal(int index, const char *value);
+
+/*******************************************************************************
+* public function: csv_filter_and, csv_filter_or
+* purpose: combine two predicates, the right one is only tested when the left
+* one does not already decide the row
+* @ left : pointer to struct csv_filter, now owned by the result
+* @ right : pointer to struct csv_filter, now owned by the result
+* returns: pointer to struct csv_filter
+*******************************************************************************/
+struct csv_filter *csv_filter_and(struct csv_filter *left, struct csv_filter *right);
+struct csv_filter *csv_filter_or(struct csv_filter *left, struct csv_filter *right);
+
+/*******************************************************************************
+* public function: csv_set_filter
+* purpose: only hand out rows that pass the filter from csv_next and
+* csv_next_batch
+* @ csvfile : pointer to struct csv
+* @ filter : pointer to struct csv_filter now owned by csvfile, NULL to clear
+* note: a missing item fails every predicate on its column
+* note: the previous filter is released, and csv_destroy releases the last one
+*******************************************************************************/
+void csv_set_filter(struct csv *csvfile, struct csv_filter *filter);
+
+/*******************************************************************************
+* macro: csv_is_null
+* purpose: test the null bitmap of a batch column
+* @ column : pointer to struct csv_column
+* @ row : row index within the batch
+*******************************************************************************/
+#define csv_is_null(column, row)                                               \
+        (((column)->nulls[(row) / 8] >> ((row) % 8)) & 1)                      \
+
 #endif
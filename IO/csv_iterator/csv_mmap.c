@@ -0,0 +1,488 @@
+/*
+* author: Biren Patel
+* description: implementation for the zero-copy CSV reader. The mapping is
+* indexed one window at a time with csv_index_scan, and each row is then cut
+* from consecutive offsets in the window without looking at the bytes between.
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "csv_mmap.h"
+#include "csv_index.h"
+#include "csv_parse.h"
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/*******************************************************************************
+* macro: verify_pointer
+* purpose: exit if a pointer is null
+* @ test : one word name of the test being performed
+* @ pointer : pointer returned by some function
+*******************************************************************************/
+
+#define VERIFY_POINTER(test, pointer)                                          \
+        if (pointer == NULL)                                                   \
+        {                                                                      \
+            fprintf(stderr, #test " fail: %s in %s\n", __func__, __FILE__);    \
+            exit(EXIT_FAILURE);                                                \
+        }                                                                      \
+
+/*******************************************************************************
+* client-modifiable parameters
+* @ FIELDS_INIT : initial capacity of the field array
+* @ WINDOW_INIT : bytes indexed at once, doubled for a row that does not fit
+*******************************************************************************/
+
+#define FIELDS_INIT 16
+#define WINDOW_INIT (64 * 1024)
+
+/*******************************************************************************
+* structure: struct csv_mmap
+* @ base : first byte of the file in memory, NULL for a slice
+* @ end : one past the last byte of the file or of the slice
+* @ pos : first byte of the next row
+* @ length : byte-size of the mapping, 0 if there is no mapping to release
+* @ sep : character used for row tokenization
+* @ count : total fields in the current row
+* @ capacity : total fields the field array can hold
+* @ fields : views of the fields of the current row
+* @ window : capacity of the offset array, the most bytes indexed at once
+* @ indexed : first byte of the indexed window, always the start of a row
+* @ limit : one past the last byte of the indexed window
+* @ offsets : separators and line feeds of the window, relative to indexed
+* @ total : total offsets in the window
+* @ cursor : first offset not yet consumed by a row
+* purpose: holds the mapping and the state of the row iteration
+*******************************************************************************/
+
+struct csv_mmap
+{
+    const char *base;
+    const char *end;
+    const char *pos;
+    size_t length;
+    char sep;
+    int count;
+    int capacity;
+    struct csv_field *fields;
+    size_t window;
+    const char *indexed;
+    const char *limit;
+    uint32_t *offsets;
+    size_t total;
+    size_t cursor;
+};
+
+/*******************************************************************************
+* private function: map_file, unmap_file
+* purpose: bring the whole file into memory for reading, sequential access
+* @ length : receives the byte-size of the file
+* returns: the file contents, NULL if the file cannot be read or is empty
+*******************************************************************************/
+static const char *map_file(const char *filename, size_t *length);
+static void unmap_file(const char *base, size_t length);
+
+/*******************************************************************************
+* private function: init_rows
+* purpose: set up row iteration over [pos, end), once the bytes are in place
+*******************************************************************************/
+static void init_rows(struct csv_mmap *reader, char sep);
+
+/*******************************************************************************
+* private function: push_field
+* purpose: append a view to the current row, growing the field array if needed
+*******************************************************************************/
+static void push_field(struct csv_mmap *reader, const char *ptr, size_t len);
+
+/*******************************************************************************
+* private function: push_view
+* purpose: push the field between two structural characters, without its quotes
+* or the carriage return of a \r\n line ending
+* @ start : first byte of the field
+* @ stop : separator or line feed after the field, or the end of the file
+*******************************************************************************/
+static void push_view(struct csv_mmap *reader, const char *start, const char *stop);
+
+/*******************************************************************************
+* private function: index_window
+* purpose: index the bytes from reader->pos, at most one window of them
+*******************************************************************************/
+static void index_window(struct csv_mmap *reader);
+
+/*******************************************************************************
+* private function: split_row
+* purpose: push the fields of the row at reader->pos from the indexed offsets
+* returns: NULL if the row is complete and pos has moved past it, otherwise the
+* start of the field left open where the offsets ran out
+*******************************************************************************/
+static const char *split_row(struct csv_mmap *reader);
+
+/*******************************************************************************
+* public functions
+*******************************************************************************/
+
+struct csv_mmap *csv_mmap_open(const char *filename, char sep)
+{
+    assert(filename != NULL);
+
+    struct csv_mmap *reader = malloc(sizeof(struct csv_mmap));
+    VERIFY_POINTER(malloc, reader);
+
+    reader->base = map_file(filename, &reader->length);
+
+    //an empty file is valid and simply has no rows, any other failure is not
+    if (reader->base == NULL && reader->length != 0)
+    {
+        free(reader);
+        return NULL;
+    }
+
+    reader->end = reader->base + reader->length;
+    reader->pos = reader->base;
+    init_rows(reader, sep);
+
+    return reader;
+}
+
+/******************************************************************************/
+
+struct csv_mmap *csv_mmap_slice(struct csv_mmap *reader, size_t begin, size_t end)
+{
+    assert(reader != NULL);
+    assert(begin <= end && end <= (size_t) (reader->end - reader->pos));
+
+    struct csv_mmap *slice = malloc(sizeof(struct csv_mmap));
+    VERIFY_POINTER(malloc, slice);
+
+    //the slice borrows the mapping, so it has nothing to release on close
+    slice->base = NULL;
+    slice->length = 0;
+    slice->pos = reader->pos + begin;
+    slice->end = reader->pos + end;
+    init_rows(slice, reader->sep);
+
+    return slice;
+}
+
+/******************************************************************************/
+
+const char *csv_mmap_data(struct csv_mmap *reader, size_t *length)
+{
+    assert(reader != NULL);
+    assert(length != NULL);
+
+    *length = (size_t) (reader->end - reader->pos);
+    return reader->pos;
+}
+
+/******************************************************************************/
+
+void csv_mmap_close(struct csv_mmap *reader)
+{
+    assert(reader != NULL);
+
+    if (reader->base != NULL) unmap_file(reader->base, reader->length);
+
+    free(reader->fields);
+    free(reader->offsets);
+    free(reader);
+}
+
+/******************************************************************************/
+
+bool csv_mmap_next(struct csv_mmap *reader)
+{
+    assert(reader != NULL);
+
+    reader->count = 0;
+
+    if (reader->pos == reader->end) return false;
+
+    const char *open;
+
+    while ((open = split_row(reader)) != NULL)
+    {
+        //the last row of a file without a final line feed
+        if (reader->limit == reader->end)
+        {
+            push_view(reader, open, reader->end);
+            reader->pos = reader->end;
+            break;
+        }
+
+        //the row runs past the window, which is too small if it held the row
+        if (reader->indexed == reader->pos)
+        {
+            reader->window *= 2;
+
+            uint32_t *tmp = realloc(reader->offsets, reader->window * sizeof(uint32_t));
+            VERIFY_POINTER(realloc, tmp);
+
+            reader->offsets = tmp;
+        }
+
+        reader->count = 0;
+        index_window(reader);
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+
+int csv_mmap_count(struct csv_mmap *reader)
+{
+    assert(reader != NULL);
+
+    return reader->count;
+}
+
+/******************************************************************************/
+
+struct csv_field csv_mmap_field(struct csv_mmap *reader, int index)
+{
+    assert(reader != NULL);
+    assert(index >= 0);
+
+    if (index >= reader->count) return (struct csv_field) {NULL, 0};
+
+    return reader->fields[index];
+}
+
+/*******************************************************************************
+The conversions parse the view in place, it is never copied or nul-terminated.
+*/
+
+bool csv_field_int(struct csv_field field, int *value)
+{
+    if (field.len == 0) return false;
+
+    const char *end = field.ptr + field.len;
+    int result;
+
+    //trailing bytes fail the field, and the value is only written on success
+    if (csv_parse_int(field.ptr, end, &result) != end) return false;
+
+    *value = result;
+    return true;
+}
+
+/******************************************************************************/
+
+bool csv_field_double(struct csv_field field, double *value)
+{
+    if (field.len == 0) return false;
+
+    const char *end = field.ptr + field.len;
+    double result;
+
+    //trailing bytes fail the field, and the value is only written on success
+    if (csv_parse_double(field.ptr, end, &result) != end) return false;
+
+    *value = result;
+    return true;
+}
+
+/******************************************************************************/
+
+bool csv_field_char(struct csv_field field, char *value)
+{
+    if (field.len == 0) return false;
+
+    *value = *field.ptr;
+    return true;
+}
+
+/*******************************************************************************
+* private functions
+*******************************************************************************/
+
+static void init_rows(struct csv_mmap *reader, char sep)
+{
+    reader->sep = sep;
+    reader->count = 0;
+    reader->capacity = FIELDS_INIT;
+
+    reader->fields = malloc(FIELDS_INIT * sizeof(struct csv_field));
+    VERIFY_POINTER(malloc, reader->fields);
+
+    //nothing is indexed until the first row is requested
+    reader->window = WINDOW_INIT;
+    reader->indexed = NULL;
+    reader->limit = NULL;
+    reader->total = 0;
+    reader->cursor = 0;
+
+    reader->offsets = malloc(WINDOW_INIT * sizeof(uint32_t));
+    VERIFY_POINTER(malloc, reader->offsets);
+}
+
+/******************************************************************************/
+
+static void push_field(struct csv_mmap *reader, const char *ptr, size_t len)
+{
+    if (reader->count == reader->capacity)
+    {
+        //the widest row sets the capacity once and for all
+        reader->capacity *= 2;
+
+        struct csv_field *tmp = realloc(reader->fields, reader->capacity * sizeof(struct csv_field));
+        VERIFY_POINTER(realloc, tmp);
+
+        reader->fields = tmp;
+    }
+
+    reader->fields[reader->count++] = (struct csv_field) {ptr, len};
+}
+
+/******************************************************************************/
+
+static void push_view(struct csv_mmap *reader, const char *start, const char *stop)
+{
+    if (start < stop && *start == '"')
+    {
+        //the field runs to its last quote, trailing bytes are dropped
+        const char *close = stop - 1;
+        while (close > start && *close != '"') --close;
+
+        if (close == start) close = stop;
+
+        push_field(reader, start + 1, (size_t) (close - start - 1));
+    }
+    else
+    {
+        if (stop > start && stop[-1] == '\r' && (stop == reader->end || *stop == '\n')) --stop;
+
+        push_field(reader, start, (size_t) (stop - start));
+    }
+}
+
+/******************************************************************************/
+
+static void index_window(struct csv_mmap *reader)
+{
+    size_t rest = (size_t) (reader->end - reader->pos);
+    size_t len = rest < reader->window ? rest : reader->window;
+
+    //rows never start inside a quoted field
+    bool quoted = false;
+
+    reader->indexed = reader->pos;
+    reader->limit = reader->pos + len;
+    reader->total = csv_index_scan(reader->pos, len, reader->sep, &quoted, reader->offsets);
+    reader->cursor = 0;
+}
+
+/******************************************************************************/
+
+static const char *split_row(struct csv_mmap *reader)
+{
+    const char *start = reader->pos;
+
+    for (size_t i = reader->cursor; i < reader->total; ++i)
+    {
+        const char *stop = reader->indexed + reader->offsets[i];
+
+        push_view(reader, start, stop);
+        start = stop + 1;
+
+        if (*stop == '\n')
+        {
+            reader->cursor = i + 1;
+            reader->pos = start;
+            return NULL;
+        }
+    }
+
+    return start;
+}
+
+/******************************************************************************/
+
+#ifdef _WIN32
+
+static const char *map_file(const char *filename, size_t *length)
+{
+    *length = 1;
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) return NULL;
+
+    char *base = NULL;
+    long size = -1;
+
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+
+    if (size == 0)
+    {
+        *length = 0;
+    }
+    else if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        base = malloc((size_t) size);
+
+        if (base != NULL && fread(base, 1, (size_t) size, file) != (size_t) size)
+        {
+            free(base);
+            base = NULL;
+        }
+
+        if (base != NULL) *length = (size_t) size;
+    }
+
+    fclose(file);
+    return base;
+}
+
+static void unmap_file(const char *base, size_t length)
+{
+    (void) length;
+    free((void*) base);
+}
+
+#else
+
+static const char *map_file(const char *filename, size_t *length)
+{
+    *length = 1;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) return NULL;
+
+    struct stat st;
+    void *base = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0)
+    {
+        *length = (size_t) st.st_size;
+
+        if (*length != 0)
+        {
+            base = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base != MAP_FAILED) madvise(base, *length, MADV_SEQUENTIAL);
+        }
+    }
+
+    //the mapping keeps the file open on its own
+    close(fd);
+
+    //an empty file keeps its length of 0, a failure keeps a nonzero length
+    return base == MAP_FAILED ? NULL : base;
+}
+
+static void unmap_file(const char *base, size_t length)
+{
+    munmap((void*) base, length);
+}
+
+#endif
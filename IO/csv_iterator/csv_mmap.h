@@ -0,0 +1,114 @@
+/*
+* author: Biren Patel
+* description: Zero-copy CSV reader. The whole file is memory-mapped and each
+* row is split into field views, pointer and length pairs that point straight
+* into the mapping. Nothing is copied or converted unless a field is requested
+* as a number, and the only allocation after construction is the field array,
+* which grows to fit the widest row and is then reused for every other row.
+*
+* note: a quoted field is viewed without its quotes, and since a view cannot be
+* rewritten any doubled quotes inside it are left as they appear in the file
+* note: rows end at \n or \r\n, a quoted field may span several lines
+* note: views stay valid until csv_mmap_close, not just for the current row
+* note: compile with csv_index.c and csv_parse.c
+*/
+
+#ifndef CSV_MMAP_H
+#define CSV_MMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*******************************************************************************
+* structure: struct csv_field
+* purpose: view of one field in the mapped file, not nul-terminated
+* @ ptr : first byte of the field, NULL if the row has no such field
+* @ len : total bytes in the field, 0 for a missing value
+*******************************************************************************/
+struct csv_field
+{
+    const char *ptr;
+    size_t len;
+};
+
+/*******************************************************************************
+* structure: struct csv_mmap
+* purpose: client must declare pointer to struct csv_mmap
+*******************************************************************************/
+struct csv_mmap;
+
+/*******************************************************************************
+* public function: csv_mmap_open
+* purpose: constructor, maps the file and hints the kernel to read ahead
+* @ filename : path for CSV file
+* @ sep : separator between data items in CSV
+* returns: pointer to struct csv_mmap, NULL if the file cannot be mapped
+* note: Windows has no mmap here, the file is read into one heap buffer instead
+*******************************************************************************/
+struct csv_mmap *csv_mmap_open(const char *filename, char sep);
+
+/*******************************************************************************
+* public function: csv_mmap_close
+* purpose: destructor, unmaps the file and invalidates every view
+* @ reader : pointer to struct csv_mmap
+*******************************************************************************/
+void csv_mmap_close(struct csv_mmap *reader);
+
+/*******************************************************************************
+* public function: csv_mmap_slice
+* purpose: a second reader over a byte range of the mapping of reader, so that
+*          separate threads can read separate parts of one file
+* @ reader : pointer to struct csv_mmap, must outlive the slice
+* @ begin : offset of the first byte of the range, must start a row
+* @ end : offset one past the last byte of the range
+* note: offsets are relative to the pointer csv_mmap_data returns
+* returns: pointer to struct csv_mmap, release it with csv_mmap_close
+*******************************************************************************/
+struct csv_mmap *csv_mmap_slice(struct csv_mmap *reader, size_t begin, size_t end);
+
+/*******************************************************************************
+* public function: csv_mmap_data
+* purpose: raw bytes not yet read, the whole file before the first row
+* @ reader : pointer to struct csv_mmap
+* @ length : receives the total bytes
+* returns: pointer to the first byte, NULL for an empty file
+*******************************************************************************/
+const char *csv_mmap_data(struct csv_mmap *reader, size_t *length);
+
+/*******************************************************************************
+* public function: csv_mmap_next
+* purpose: split the next row of the file into field views
+* @ reader : pointer to struct csv_mmap
+* returns: true if a row was read, false at the end of the file
+*******************************************************************************/
+bool csv_mmap_next(struct csv_mmap *reader);
+
+/*******************************************************************************
+* public function: csv_mmap_count
+* purpose: total fields in the current row, 0 before the first csv_mmap_next
+* @ reader : pointer to struct csv_mmap
+*******************************************************************************/
+int csv_mmap_count(struct csv_mmap *reader);
+
+/*******************************************************************************
+* public function: csv_mmap_field
+* purpose: view of a field in the current row
+* @ reader : pointer to struct csv_mmap
+* @ index : column index of the field
+* returns: the view, with a NULL ptr if the row has no field at index
+*******************************************************************************/
+struct csv_field csv_mmap_field(struct csv_mmap *reader, int index);
+
+/*******************************************************************************
+* public functions: csv_field_int, csv_field_double, csv_field_char
+* purpose: convert a field view on request, the same as %d, %f and %c do in
+*          csv_iterator
+* @ field : view returned by csv_mmap_field
+* @ value : receives the converted value, untouched on failure
+* returns: false if the field is missing or is not entirely a number
+*******************************************************************************/
+bool csv_field_int(struct csv_field field, int *value);
+bool csv_field_double(struct csv_field field, double *value);
+bool csv_field_char(struct csv_field field, char *value);
+
+#endif
@@ -0,0 +1,470 @@
+/*
+* author: Biren Patel
+* description: implementation for the parallel CSV reader. Both passes share one
+* worker loop that claims chunk indices from a counter under a mutex, and ordered
+* delivery waits on a condition variable for the turn of each chunk.
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "csv_parallel.h"
+
+/*******************************************************************************
+* macro: verify_pointer
+* purpose: exit if a pointer is null
+* @ test : one word name of the test being performed
+* @ pointer : pointer returned by some function
+*******************************************************************************/
+
+#define VERIFY_POINTER(test, pointer)                                          \
+        if (pointer == NULL)                                                   \
+        {                                                                      \
+            fprintf(stderr, #test " fail: %s in %s\n", __func__, __FILE__);    \
+            exit(EXIT_FAILURE);                                                \
+        }                                                                      \
+
+/*******************************************************************************
+* parameters
+* @ NONE : no row starts in the chunk under the given quote state
+* @ MAX_THREADS : upper limit on the worker pool
+*******************************************************************************/
+
+#define NONE SIZE_MAX
+#define MAX_THREADS 256
+
+/*******************************************************************************
+* structure: struct split
+* @ start : offset of the first byte of the byte range
+* @ end : offset one past the last byte of the byte range
+* @ parity : true if the range holds an odd number of quotes
+* @ first : offset of the first row start in the range if the range starts
+*           outside a quote, then inside a quote, NONE if there is no such row
+* @ begin : offset of the first row of the chunk, NONE if the chunk has no rows
+* @ stop : offset one past the last row of the chunk
+* purpose: one chunk of the file, filled in by the first pass
+*******************************************************************************/
+
+struct split
+{
+    size_t start;
+    size_t end;
+    bool parity;
+    size_t first[2];
+    size_t begin;
+    size_t stop;
+};
+
+/*******************************************************************************
+* structure: struct job
+* @ reader : reader that owns the mapping, sliced once per chunk
+* @ data : first byte of the file
+* @ splits : every chunk of the file
+* @ total : total chunks
+* @ ordered : deliver chunks in file order
+* @ consume : client callback
+* @ context : client callback argument
+* @ lock : guards next and delivered
+* @ turn : signalled whenever delivered moves
+* @ next : next chunk to claim
+* @ delivered : next chunk to deliver in ordered mode
+* purpose: state shared by every worker
+*******************************************************************************/
+
+struct job
+{
+    struct csv_mmap *reader;
+    const char *data;
+    struct split *splits;
+    size_t total;
+    bool ordered;
+    void (*consume)(const struct csv_chunk *chunk, void *context);
+    void *context;
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    size_t next;
+    size_t delivered;
+};
+
+/*******************************************************************************
+* structure: struct worker
+* @ job : shared state
+* @ thread : thread running the worker
+* @ fields : field views of the chunk being parsed
+* @ field_capacity : total views the field array can hold
+* @ starts : row starts of the chunk being parsed
+* @ start_capacity : total entries the row start array can hold
+* purpose: one thread of the pool, its arrays are reused for every chunk
+*******************************************************************************/
+
+struct worker
+{
+    struct job *job;
+    pthread_t thread;
+    struct csv_field *fields;
+    size_t field_capacity;
+    size_t *starts;
+    size_t start_capacity;
+};
+
+/*******************************************************************************
+* private function: claim
+* purpose: take the next chunk index of the current pass
+* returns: the index, or the total chunks once every chunk is taken
+*******************************************************************************/
+static size_t claim(struct job *job);
+
+/*******************************************************************************
+* private function: first_row
+* purpose: find the first line feed outside quotes in [p, end), quotes toggle
+* @ quoted : quote state at p
+* returns: offset from p just past the line feed, NONE if there is none
+*******************************************************************************/
+static size_t first_row(const char *p, const char *end, bool quoted);
+
+/*******************************************************************************
+* private function: scan_run, parse_run
+* purpose: thread entry points of the first and second pass
+* @ arg : pointer to struct worker
+*******************************************************************************/
+static void *scan_run(void *arg);
+static void *parse_run(void *arg);
+
+/*******************************************************************************
+* private function: run_pool
+* purpose: run one pass on every worker and wait for all of them
+* @ entry : scan_run or parse_run
+*******************************************************************************/
+static void run_pool(struct worker *workers, int threads, void *(*entry)(void*));
+
+/*******************************************************************************
+* private function: resolve
+* purpose: walk the quote parities in file order to pick the row start of each
+* chunk, then close each chunk at the row start of the next chunk with rows
+*******************************************************************************/
+static void resolve(struct job *job, size_t length);
+
+/*******************************************************************************
+* public functions
+*******************************************************************************/
+
+bool csv_parallel_read
+(
+    const char *filename,
+    char sep,
+    int threads,
+    bool ordered,
+    void (*consume)(const struct csv_chunk *chunk, void *context),
+    void *context
+)
+{
+    assert(filename != NULL);
+    assert(consume != NULL);
+    assert(threads >= 0);
+
+    struct csv_mmap *reader = csv_mmap_open(filename, sep);
+    if (reader == NULL) return false;
+
+    size_t length;
+    struct job job;
+
+    job.reader = reader;
+    job.data = csv_mmap_data(reader, &length);
+    job.total = (length + CSV_PARALLEL_CHUNK - 1) / CSV_PARALLEL_CHUNK;
+    job.ordered = ordered;
+    job.consume = consume;
+    job.context = context;
+
+    if (job.total == 0)
+    {
+        csv_mmap_close(reader);
+        return true;
+    }
+
+    job.splits = malloc(job.total * sizeof(struct split));
+    VERIFY_POINTER(malloc, job.splits);
+
+    for (size_t i = 0; i < job.total; ++i)
+    {
+        job.splits[i].start = i * CSV_PARALLEL_CHUNK;
+        job.splits[i].end = i + 1 == job.total ? length : (i + 1) * CSV_PARALLEL_CHUNK;
+    }
+
+    //more threads than chunks would only sit idle
+    if (threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int) online : 1;
+    }
+
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if ((size_t) threads > job.total) threads = (int) job.total;
+
+    struct worker *workers = calloc(threads, sizeof(struct worker));
+    VERIFY_POINTER(calloc, workers);
+
+    for (int t = 0; t < threads; ++t) workers[t].job = &job;
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+
+    //first pass, speculative row starts
+    job.next = 0;
+    run_pool(workers, threads, scan_run);
+
+    resolve(&job, length);
+
+    //second pass, rows and fields
+    job.next = 0;
+    job.delivered = 0;
+    run_pool(workers, threads, parse_run);
+
+    pthread_cond_destroy(&job.turn);
+    pthread_mutex_destroy(&job.lock);
+
+    for (int t = 0; t < threads; ++t)
+    {
+        free(workers[t].fields);
+        free(workers[t].starts);
+    }
+
+    free(workers);
+    free(job.splits);
+    csv_mmap_close(reader);
+
+    return true;
+}
+
+/*******************************************************************************
+* private functions
+*******************************************************************************/
+
+static size_t claim(struct job *job)
+{
+    pthread_mutex_lock(&job->lock);
+
+    size_t index = job->next;
+    if (index < job->total) ++job->next;
+
+    pthread_mutex_unlock(&job->lock);
+
+    return index;
+}
+
+/******************************************************************************/
+
+static size_t first_row(const char *p, const char *end, bool quoted)
+{
+    const char *curr = p;
+
+    //each step jumps with memchr to the next byte that can change the answer
+    while (curr < end)
+    {
+        if (quoted)
+        {
+            const char *quote = memchr(curr, '"', (size_t) (end - curr));
+            if (quote == NULL) return NONE;
+
+            quoted = false;
+            curr = quote + 1;
+        }
+        else
+        {
+            const char *line = memchr(curr, '\n', (size_t) (end - curr));
+            const char *stop = line == NULL ? end : line;
+
+            const char *quote = memchr(curr, '"', (size_t) (stop - curr));
+
+            if (quote == NULL)
+            {
+                return line == NULL ? NONE : (size_t) (line + 1 - p);
+            }
+
+            quoted = true;
+            curr = quote + 1;
+        }
+    }
+
+    return NONE;
+}
+
+/******************************************************************************/
+
+static void *scan_run(void *arg)
+{
+    struct worker *worker = arg;
+    struct job *job = worker->job;
+
+    for (size_t i = claim(job); i < job->total; i = claim(job))
+    {
+        struct split *split = job->splits + i;
+
+        const char *p = job->data + split->start;
+        const char *end = job->data + split->end;
+
+        //a doubled quote counts twice and leaves the parity alone
+        bool parity = false;
+
+        while ((p = memchr(p, '"', (size_t) (end - p))) != NULL)
+        {
+            parity = !parity;
+            if (++p == end) break;
+        }
+
+        split->parity = parity;
+        split->first[0] = first_row(job->data + split->start, end, false);
+        split->first[1] = first_row(job->data + split->start, end, true);
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+
+static void resolve(struct job *job, size_t length)
+{
+    bool quoted = false;
+
+    for (size_t i = 0; i < job->total; ++i)
+    {
+        struct split *split = job->splits + i;
+
+        if (i == 0)
+        {
+            split->begin = 0;
+        }
+        else
+        {
+            size_t first = split->first[quoted];
+            split->begin = first == NONE ? NONE : split->start + first;
+        }
+
+        quoted ^= split->parity;
+    }
+
+    //a chunk without a row start of its own is absorbed by the one before it
+    size_t stop = length;
+
+    for (size_t i = job->total; i-- > 0;)
+    {
+        struct split *split = job->splits + i;
+
+        split->stop = stop;
+        if (split->begin != NONE) stop = split->begin;
+    }
+}
+
+/******************************************************************************/
+
+static void *parse_run(void *arg)
+{
+    struct worker *worker = arg;
+    struct job *job = worker->job;
+
+    //an empty chunk still needs its one row start
+    if (worker->starts == NULL)
+    {
+        worker->start_capacity = 1024;
+        worker->starts = malloc(worker->start_capacity * sizeof(size_t));
+        VERIFY_POINTER(malloc, worker->starts);
+    }
+
+    for (size_t i = claim(job); i < job->total; i = claim(job))
+    {
+        struct split *split = job->splits + i;
+
+        size_t rows = 0;
+        size_t count = 0;
+
+        if (split->begin != NONE && split->begin < split->stop)
+        {
+            struct csv_mmap *slice = csv_mmap_slice(job->reader, split->begin, split->stop);
+
+            while (csv_mmap_next(slice))
+            {
+                size_t width = (size_t) csv_mmap_count(slice);
+
+                if (rows + 2 > worker->start_capacity)
+                {
+                    worker->start_capacity *= 2;
+
+                    size_t *tmp = realloc(worker->starts, worker->start_capacity * sizeof(size_t));
+                    VERIFY_POINTER(realloc, tmp);
+
+                    worker->starts = tmp;
+                }
+
+                if (count + width > worker->field_capacity)
+                {
+                    size_t capacity = worker->field_capacity ? worker->field_capacity : 4096;
+                    while (count + width > capacity) capacity *= 2;
+
+                    struct csv_field *tmp = realloc(worker->fields, capacity * sizeof(struct csv_field));
+                    VERIFY_POINTER(realloc, tmp);
+
+                    worker->fields = tmp;
+                    worker->field_capacity = capacity;
+                }
+
+                worker->starts[rows++] = count;
+
+                for (size_t f = 0; f < width; ++f)
+                {
+                    worker->fields[count++] = csv_mmap_field(slice, (int) f);
+                }
+            }
+
+            csv_mmap_close(slice);
+        }
+
+        worker->starts[rows] = count;
+
+        struct csv_chunk chunk = {i, rows, worker->starts, worker->fields};
+
+        if (job->ordered)
+        {
+            //only the worker holding the next chunk in file order may proceed
+            pthread_mutex_lock(&job->lock);
+            while (job->delivered != i) pthread_cond_wait(&job->turn, &job->lock);
+            pthread_mutex_unlock(&job->lock);
+
+            job->consume(&chunk, job->context);
+
+            pthread_mutex_lock(&job->lock);
+            ++job->delivered;
+            pthread_cond_broadcast(&job->turn);
+            pthread_mutex_unlock(&job->lock);
+        }
+        else
+        {
+            job->consume(&chunk, job->context);
+        }
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+
+static void run_pool(struct worker *workers, int threads, void *(*entry)(void*))
+{
+    int started = 0;
+
+    while (started < threads)
+    {
+        if (pthread_create(&workers[started].thread, NULL, entry, workers + started) != 0) break;
+        ++started;
+    }
+
+    //the chunk counter lets any number of workers finish the pass, even none
+    if (started == 0) entry(workers);
+
+    for (int t = 0; t < started; ++t) pthread_join(workers[t].thread, NULL);
+}
@@ -0,0 +1,71 @@
+/*
+* author: Biren Patel
+* description: Parallel CSV reader. The file is memory-mapped and cut into fixed
+* byte ranges, which cannot be split at the first line feed of each range since
+* that line feed may sit inside a quoted field. A first parallel pass therefore
+* records, for every range, its quote parity and where its first row would start
+* under either quote state. The true state at each range is then a running XOR
+* of the parities, which picks one of the two speculative starts. A second
+* parallel pass splits the rows of each range into field views on a pool of
+* worker threads, and the views are handed to the client one chunk at a time.
+*
+* note: requires POSIX threads, compile with csv_mmap.c, csv_index.c,
+*       csv_parse.c and -pthread
+*/
+
+#ifndef CSV_PARALLEL_H
+#define CSV_PARALLEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "csv_mmap.h"
+
+/*******************************************************************************
+* client-modifiable parameters
+* @ CSV_PARALLEL_CHUNK : 4 MiB byte range handed to one worker at a time
+*******************************************************************************/
+#define CSV_PARALLEL_CHUNK (4 * 1024 * 1024)
+
+/*******************************************************************************
+* structure: struct csv_chunk
+* purpose: the rows of one byte range, split into field views
+* @ index : position of the chunk in the file, chunk 0 holds the first row
+* @ rows : total rows in the chunk, possibly 0
+* @ starts : rows + 1 entries, the fields of row r are fields[starts[r]] up to
+*            but not including fields[starts[r + 1]]
+* @ fields : views into the mapped file, the same as csv_mmap_field returns
+* note: the arrays are reused once the consumer returns, the views themselves
+*       stay valid until csv_parallel_read returns
+*******************************************************************************/
+struct csv_chunk
+{
+    size_t index;
+    size_t rows;
+    const size_t *starts;
+    const struct csv_field *fields;
+};
+
+/*******************************************************************************
+* public function: csv_parallel_read
+* purpose: read a whole CSV file on several threads
+* @ filename : path for CSV file
+* @ sep : separator between data items in CSV
+* @ threads : total worker threads, 0 for one per online core
+* @ ordered : if true, chunks are consumed one at a time in file order. if
+*             false, chunks are consumed as soon as they are ready, from
+*             several threads at once, so consume must be thread-safe.
+* @ consume : called once per chunk from a worker thread
+* @ context : passed through to consume
+* returns: false if the file cannot be mapped, true once every chunk is consumed
+*******************************************************************************/
+bool csv_parallel_read
+(
+    const char *filename,
+    char sep,
+    int threads,
+    bool ordered,
+    void (*consume)(const struct csv_chunk *chunk, void *context),
+    void *context
+);
+
+#endif
@@ -0,0 +1,41 @@
+/*
+* author: Biren Patel
+* description: Number parsers for CSV field views. Neither parser needs its input
+* to be nul-terminated or consults the locale. Integers are read eight digits at
+* a time with SWAR arithmetic on one 64-bit word. Doubles are read into a 64-bit
+* decimal mantissa and exponent, then converted with the Eisel-Lemire algorithm,
+* which rounds correctly whenever the mantissa has at most 19 digits.
+*
+* note: leading blanks are skipped and parsing stops at the first byte that is
+* not part of the number, the same as strtol and strtod
+* note: doubles with more than 19 significant digits, infinities, and NaN are
+* handed to strtod, so only those follow the locale
+*/
+
+#ifndef CSV_PARSE_H
+#define CSV_PARSE_H
+
+/*******************************************************************************
+* public function: csv_parse_int
+* purpose: parse a decimal int, with an optional sign
+* @ begin : first byte of the text
+* @ end : one past the last byte of the text
+* @ value : receives the parsed value, untouched on failure
+* returns: one past the last byte of the number, NULL if the text does not
+*          start with a number or the number does not fit an int
+*******************************************************************************/
+const char *csv_parse_int(const char *begin, const char *end, int *value);
+
+/*******************************************************************************
+* public function: csv_parse_double
+* purpose: parse a decimal double, with an optional sign, fraction, and exponent
+* @ begin : first byte of the text
+* @ end : one past the last byte of the text
+* @ value : receives the parsed value, correctly rounded, untouched on failure
+* returns: one past the last byte of the number, NULL if the text does not
+*          start with a number
+* note: a number past the range of double gives zero or infinity
+*******************************************************************************/
+const char *csv_parse_double(const char *begin, const char *end, double *value);
+
+#endif
@@ -24,9 +24,9 @@ int main(void)
 
     //if you call csv_next(), then it will load the next available row of data
     //into memory. it returns a boolean value to indicate a load was successful.
-    //if false, there was nothing left to read. By default, a 1 KiB buffer is
-    //used to read each row. Change this macro in the header file if necessary.
-    //the buffer is only temporary for the duration of the csv_next() call.
+    //if false, there was nothing left to read. rows can be any length, the
+    //file is read in large blocks and the row buffer grows to fit the longest
+    //row, which csv_get_stats() reports once you are done.
     while(csv_next(file))
     {
         //struct csv stores all data via void pointers.
@@ -66,5 +66,57 @@ int main(void)
     //in memory.
     csv_destroy(file, false);
 
+    //for analytics, csv_next_batch loads many rows at once into one typed
+    //array per column. there is no pointer per item, a %d column is an int
+    //array, a %f column a double array, and so on. missing data is marked in
+    //a bitmap instead of with NULL, test it with csv_is_null.
+
+    //only column 1 is summed, so %x skips the other three. a skipped column is
+    //never converted and gets no index, the double column is now index 0. if
+    //the file starts with a header row, csv_create_header can also pick the
+    //columns by name.
+    file = csv_create("demo.csv", "%1x %1f %2x", ',');
+
+    int rows;
+    double total = 0.0;
+
+    while ((rows = csv_next_batch(file, 1024)) > 0)
+    {
+        const struct csv_column *column = csv_get_column(file, 0);
+
+        for (int i = 0; i < rows; ++i)
+        {
+            if (!csv_is_null(column, i)) total += column->doubles[i];
+        }
+    }
+
+    printf("sum of column 1: %g\n", total);
+
+    struct csv_stats stats = csv_get_stats(file);
+    printf("rows: %zu, longest row: %zu bytes\n", stats.rows_scanned, stats.max_row_len);
+
+    csv_destroy(file, false);
+
+    //a filter hands out only the rows that pass it. predicates compare number
+    //columns, test ranges, or match strings, and csv_filter_and/csv_filter_or
+    //combine them. the other columns of a rejected row are never converted.
+    //here: column 0 is at least 50, or column 2 reads "hello".
+    file = csv_create("demo.csv", "%1d %1f %1s %1c", ',');
+
+    csv_set_filter(file, csv_filter_or(csv_filter_compare(0, CSV_GE, 50), csv_filter_equal(2, "hello")));
+
+    while (csv_next(file))
+    {
+        int *item_1 = (int*) csv_get_ptr(file, 0);
+        if (!item_1) printf("kept row with column 0: \n");
+        else printf("kept row with column 0: %d\n", *item_1);
+    }
+
+    stats = csv_get_stats(file);
+    printf("rows: %zu, kept: %zu\n", stats.rows_scanned, stats.rows_emitted);
+
+    //the filter is released along with the rest of the type
+    csv_destroy(file, false);
+
     return EXIT_SUCCESS;
 }
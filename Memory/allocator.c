@@ -0,0 +1,116 @@
+/*
+* Author: Biren Patel
+* Description: Allocator adapters. Each adapter is a set of static functions
+* that forward the vtable calls to one allocator, whose handle is the context.
+*/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "mempool.h"
+#include "arena.h"
+#include "slab.h"
+
+/*******************************************************************************
+* memory pool adapter, the pool already takes an alignment and tracks sizes
+*******************************************************************************/
+
+static void *mempool_adapter_alloc(void *context, size_t size, size_t alignment)
+{
+    if (alignment == 0) return pmalloc_from(context, size);
+    return pmemalign_from(context, alignment, size);
+}
+
+static void *mempool_adapter_resize(void *context, void *ptr, size_t old_size, size_t size)
+{
+    (void) old_size;
+    return prealloc_from(context, ptr, size);
+}
+
+static void mempool_adapter_release(void *context, void *ptr, size_t size)
+{
+    (void) size;
+    pfree_from(context, ptr);
+}
+
+struct allocator allocator_mempool(struct mempool *pool)
+{
+    return (struct allocator) {mempool_adapter_alloc, mempool_adapter_resize, mempool_adapter_release, pool};
+}
+
+/*******************************************************************************
+* arena adapter, blocks are only reclaimed when the arena itself is rewound
+*******************************************************************************/
+
+static void *arena_adapter_alloc(void *context, size_t size, size_t alignment)
+{
+    if (alignment == 0) return arena_alloc(context, size);
+    return arena_alloc_aligned(context, size, alignment);
+}
+
+static void *arena_adapter_resize(void *context, void *ptr, size_t old_size, size_t size)
+{
+    if (size <= old_size) return ptr;
+
+    void *new = arena_alloc(context, size);
+    if (new == NULL) return NULL;
+
+    if (ptr != NULL) memcpy(new, ptr, old_size);
+
+    return new;
+}
+
+static void arena_adapter_release(void *context, void *ptr, size_t size)
+{
+    (void) context;
+    (void) ptr;
+    (void) size;
+}
+
+struct allocator allocator_arena(struct arena *arena)
+{
+    return (struct allocator) {arena_adapter_alloc, arena_adapter_resize, arena_adapter_release, arena};
+}
+
+/*******************************************************************************
+* slab adapter, a block is a slab object exactly when its size fits one object,
+* so release and resize can tell the two kinds of block apart by size alone
+*******************************************************************************/
+
+static void *slab_adapter_alloc(void *context, size_t size, size_t alignment)
+{
+    if (alignment > 8) return NULL;
+    if (size > slab_size(context)) return malloc(size);
+
+    return slab_alloc(context);
+}
+
+static void slab_adapter_release(void *context, void *ptr, size_t size)
+{
+    if (size > slab_size(context)) free(ptr);
+    else slab_free(context, ptr);
+}
+
+static void *slab_adapter_resize(void *context, void *ptr, size_t old_size, size_t size)
+{
+    size_t object = slab_size(context);
+
+    if (ptr == NULL) return slab_adapter_alloc(context, size, 0);
+    if (old_size <= object && size <= object) return ptr;
+    if (old_size > object && size > object) return realloc(ptr, size);
+
+    //the block changes kind, so it moves between the cache and the heap
+    void *new = slab_adapter_alloc(context, size, 0);
+    if (new == NULL) return NULL;
+
+    memcpy(new, ptr, old_size < size ? old_size : size);
+    slab_adapter_release(context, ptr, old_size);
+
+    return new;
+}
+
+struct allocator allocator_slab(struct slab *cache)
+{
+    return (struct allocator) {slab_adapter_alloc, slab_adapter_resize, slab_adapter_release, cache};
+}
@@ -0,0 +1,94 @@
+/*
+* Author: Biren Patel
+* Description: Allocator interface for the containers. A struct allocator is a
+* small vtable over any of the allocators in this folder, and every container
+* constructor has a _with variant that takes one, so a whole container can be
+* placed on a pool, an arena or a slab cache without touching its code. The
+* containers only use the macros below, so they need nothing but this header.
+*/
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/*******************************************************************************
+* struct: allocator
+* purpose: allocation vtable, a null allocator pointer stands for the C library
+* @ alloc : return size bytes aligned to alignment, 0 for the default alignment
+*          of the allocator. Null on failure.
+* @ resize : grow or shrink a block from alloc, which may move. Null on failure,
+*           in which case ptr is untouched.
+* @ release : return a block from alloc
+* @ context : allocator handle passed as the first argument of every function
+* note: resize and release receive the byte size the block was last given, so
+* allocators without a block header need not store it
+*******************************************************************************/
+
+struct allocator
+{
+    void *(*alloc)(void *context, size_t size, size_t alignment);
+    void *(*resize)(void *context, void *ptr, size_t old_size, size_t size);
+    void (*release)(void *context, void *ptr, size_t size);
+    void *context;
+};
+
+/*******************************************************************************
+* dispatch macros
+* @ ALLOCATOR_ALLOC : allocate size bytes at the default alignment
+* @ ALLOCATOR_ALIGNED : allocate size bytes at a power of two alignment
+* @ ALLOCATOR_RESIZE : resize a block of old_size bytes to size bytes
+* @ ALLOCATOR_RELEASE : release a block of size bytes
+* note: a null allocator calls malloc, realloc and free directly. Aligned
+* requests need a real allocator, C99 has no aligned malloc to fall back on.
+*******************************************************************************/
+
+#define ALLOCATOR_ALLOC(a, size) \
+    ((a) == NULL ? malloc(size) : (a)->alloc((a)->context, (size), 0))
+
+#define ALLOCATOR_ALIGNED(a, size, alignment) \
+    ((a)->alloc((a)->context, (size), (alignment)))
+
+#define ALLOCATOR_RESIZE(a, ptr, old_size, size) \
+    ((a) == NULL ? realloc((ptr), (size)) : (a)->resize((a)->context, (ptr), (old_size), (size)))
+
+#define ALLOCATOR_RELEASE(a, ptr, size) \
+    ((a) == NULL ? free(ptr) : (a)->release((a)->context, (ptr), (size)))
+
+/******************************************************************************/
+//adapters, defined in allocator.c. Each returns a vtable over an existing
+//handle, which must outlive every container built on it. Containers keep a
+//pointer to the vtable, so it must not be a temporary either.
+
+struct mempool;
+struct arena;
+struct slab;
+
+/*******************************************************************************
+* function: allocator_mempool
+* purpose: vtable over an independent memory pool
+*******************************************************************************/
+
+struct allocator allocator_mempool(struct mempool *pool);
+
+/*******************************************************************************
+* function: allocator_arena
+* purpose: vtable over an arena, release does nothing until the arena rewinds
+* note: resize shrinks in place and grows by copying into a new allocation
+*******************************************************************************/
+
+struct allocator allocator_arena(struct arena *arena);
+
+/*******************************************************************************
+* function: allocator_slab
+* purpose: vtable over a slab cache for node containers, the template lists for
+* example. Blocks that fit one object of the cache come from it, larger blocks
+* such as the container handle come from malloc, and alignments over 8 fail.
+* A slab cache built on it, such as the node cache of a list, then takes its
+* slabs from the platform.
+*******************************************************************************/
+
+struct allocator allocator_slab(struct slab *cache);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+* Author: Biren Patel
+* Description: Arena allocator implementation. Chunks form a singly linked list
+* in the order they were first used. Allocation bumps a pointer in the current
+* chunk and moves on to the next chunk when full, so rewinding to a mark only
+* has to restore the current chunk and its bump pointer. Chunks past the current
+* one stay on the list and are reused by the next batch of allocations.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "arena.h"
+
+/*******************************************************************************
+* general macros
+* @ IS_POW2 : true if x is a nonzero power of two
+* @ ALIGN_UP : round the address p up to the power of two boundary a
+*******************************************************************************/
+
+#define IS_POW2(x) ((x) != 0 && ((x) & ((x) - 1)) == 0)
+#define ALIGN_UP(p, a) ((char*) (((uintptr_t) (p) + ((a) - 1)) & ~((uintptr_t) (a) - 1)))
+
+/*******************************************************************************
+* struct: chunk
+* purpose: header at the start of every chunk, data follows immediately after
+* @ next : next chunk in order of first use, not yet in use if past current
+* @ end : one past the last usable byte of the chunk
+*******************************************************************************/
+
+struct chunk
+{
+    struct chunk *next;
+    char *end;
+};
+
+#define CHUNK_DATA(c) ((char*) ((c) + 1))
+
+/*******************************************************************************
+* struct: arena
+* purpose: arena metadata
+* @ head : first chunk, never released before arena_destroy()
+* @ current : chunk that allocations are bumped out of
+* @ top : bump pointer into the current chunk
+* @ chunk : byte-size of a regular chunk
+* @ alignment : default alignment for arena_alloc()
+*******************************************************************************/
+
+struct arena
+{
+    struct chunk *head;
+    struct chunk *current;
+    char *top;
+    size_t chunk;
+    size_t alignment;
+};
+
+static struct chunk *chunk_create(size_t size);
+static void *arena_advance(struct arena *arena, size_t size, size_t alignment);
+
+/******************************************************************************/
+
+struct arena *arena_create(size_t chunk, size_t alignment)
+{
+    assert(IS_POW2(alignment) && "alignment must be a power of two");
+    assert(chunk > 0 && "chunk size must be positive");
+
+    struct arena *arena = malloc(sizeof(struct arena));
+    if (arena == NULL) return NULL;
+
+    arena->head = chunk_create(chunk);
+
+    if (arena->head == NULL)
+    {
+        free(arena);
+        return NULL;
+    }
+
+    arena->current = arena->head;
+    arena->top = CHUNK_DATA(arena->head);
+    arena->chunk = chunk;
+    arena->alignment = alignment;
+
+    return arena;
+}
+
+/******************************************************************************/
+
+void arena_destroy(struct arena *arena)
+{
+    struct chunk *curr = arena->head;
+
+    while (curr != NULL)
+    {
+        struct chunk *next = curr->next;
+        free(curr);
+        curr = next;
+    }
+
+    free(arena);
+}
+
+/******************************************************************************/
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+    return arena_alloc_aligned(arena, size, arena->alignment);
+}
+
+/******************************************************************************/
+
+void *arena_alloc_aligned(struct arena *arena, size_t size, size_t alignment)
+{
+    assert(IS_POW2(alignment) && "alignment must be a power of two");
+
+    char *ptr = ALIGN_UP(arena->top, alignment);
+
+    //compare remaining bytes rather than pointers so size cannot overflow
+    if (ptr <= arena->current->end && size <= (size_t) (arena->current->end - ptr))
+    {
+        arena->top = ptr + size;
+        return ptr;
+    }
+
+    return arena_advance(arena, size, alignment);
+}
+
+/******************************************************************************/
+
+void *arena_calloc(struct arena *arena, size_t n, size_t size)
+{
+    if (size != 0 && n > SIZE_MAX / size) return NULL;
+
+    void *ptr = arena_alloc(arena, n * size);
+    if (ptr != NULL) memset(ptr, 0, n * size);
+
+    return ptr;
+}
+
+/******************************************************************************/
+
+struct arena_mark arena_mark(struct arena *arena)
+{
+    return (struct arena_mark) {.chunk = arena->current, .top = arena->top};
+}
+
+/******************************************************************************/
+
+void arena_rewind(struct arena *arena, struct arena_mark mark)
+{
+    assert(mark.chunk != NULL && "mark was not taken by arena_mark()");
+
+    arena->current = mark.chunk;
+    arena->top = mark.top;
+}
+
+/******************************************************************************/
+
+void arena_reset(struct arena *arena)
+{
+    arena->current = arena->head;
+    arena->top = CHUNK_DATA(arena->head);
+}
+
+/******************************************************************************/
+
+void arena_trim(struct arena *arena)
+{
+    struct chunk *curr = arena->current->next;
+
+    while (curr != NULL)
+    {
+        struct chunk *next = curr->next;
+        free(curr);
+        curr = next;
+    }
+
+    arena->current->next = NULL;
+}
+
+/*******************************************************************************
+* function: chunk_create
+* purpose: malloc a chunk with size usable bytes after the header
+* returns: new chunk with no successor, null if malloc fails or size overflows
+*******************************************************************************/
+
+static struct chunk *chunk_create(size_t size)
+{
+    if (size > SIZE_MAX - sizeof(struct chunk)) return NULL;
+
+    struct chunk *chunk = malloc(sizeof(struct chunk) + size);
+    if (chunk == NULL) return NULL;
+
+    chunk->next = NULL;
+    chunk->end = CHUNK_DATA(chunk) + size;
+
+    return chunk;
+}
+
+/*******************************************************************************
+* function: arena_advance
+* purpose: slow path of arena_alloc_aligned() when the current chunk is full
+* details: the request lands in the next chunk on the list if it fits there.
+* Otherwise a new chunk is spliced in right after the current chunk, which keeps
+* every chunk past the current one unused and therefore keeps marks valid. Large
+* requests get a chunk of exactly their own size, so regular chunks stay small.
+*******************************************************************************/
+
+static void *arena_advance(struct arena *arena, size_t size, size_t alignment)
+{
+    struct chunk *next = arena->current->next;
+
+    if (next != NULL)
+    {
+        char *ptr = ALIGN_UP(CHUNK_DATA(next), alignment);
+
+        if (ptr <= next->end && size <= (size_t) (next->end - ptr))
+        {
+            arena->current = next;
+            arena->top = ptr + size;
+            return ptr;
+        }
+    }
+
+    //worst case padding to reach the alignment from the start of the data
+    if (size > SIZE_MAX - alignment) return NULL;
+    size_t need = size + alignment - 1;
+
+    struct chunk *chunk = chunk_create(need > arena->chunk ? need : arena->chunk);
+    if (chunk == NULL) return NULL;
+
+    chunk->next = next;
+    arena->current->next = chunk;
+    arena->current = chunk;
+
+    char *ptr = ALIGN_UP(CHUNK_DATA(chunk), alignment);
+    arena->top = ptr + size;
+
+    return ptr;
+}
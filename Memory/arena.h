@@ -0,0 +1,101 @@
+/*
+* Author: Biren Patel
+* Description: Arena allocator API for request-scoped memory. Allocations are
+* bumped out of large chunks with no per-allocation header, and are never freed
+* individually. Instead, the whole arena or everything allocated after a save
+* point is released at once in O(1).
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/******************************************************************************/
+//opaque arena handle
+
+struct arena;
+
+/*******************************************************************************
+* struct: arena_mark
+* purpose: save point returned by arena_mark(), members are private to arena.c
+* @ chunk : chunk that was current when the mark was taken
+* @ top : bump pointer within that chunk when the mark was taken
+*******************************************************************************/
+
+struct arena_mark
+{
+    void *chunk;
+    char *top;
+};
+
+/*******************************************************************************
+* function: arena_create
+* purpose: heap-allocated initialization of an arena and its first chunk
+* @ chunk : byte-size of each chunk, larger requests get a chunk of their own
+* @ alignment : default alignment of arena_alloc(), must be a power of two
+* returns: arena handle, null if malloc fails
+*******************************************************************************/
+
+struct arena *arena_create(size_t chunk, size_t alignment);
+
+/*******************************************************************************
+* function: arena_destroy
+* purpose: release every chunk and the handle, all allocations become dangling
+*******************************************************************************/
+
+void arena_destroy(struct arena *arena);
+
+/*******************************************************************************
+* function: arena_alloc
+* purpose: bump allocate size bytes at the default alignment of the arena
+* returns: pointer to uninitialized memory, null if a new chunk cannot be made
+*******************************************************************************/
+
+void *arena_alloc(struct arena *arena, size_t size);
+
+/*******************************************************************************
+* function: arena_alloc_aligned
+* purpose: bump allocate size bytes at an alignment other than the default
+* @ alignment : must be a power of two
+*******************************************************************************/
+
+void *arena_alloc_aligned(struct arena *arena, size_t size, size_t alignment);
+
+/*******************************************************************************
+* function: arena_calloc
+* purpose: bump allocate n * size zeroed bytes, null on overflow
+*******************************************************************************/
+
+void *arena_calloc(struct arena *arena, size_t n, size_t size);
+
+/*******************************************************************************
+* function: arena_mark
+* purpose: take a save point at the current bump position
+*******************************************************************************/
+
+struct arena_mark arena_mark(struct arena *arena);
+
+/*******************************************************************************
+* function: arena_rewind
+* purpose: release everything allocated after the mark, keeping chunks for reuse
+* @ mark : save point from this arena, marks taken after it become invalid
+*******************************************************************************/
+
+void arena_rewind(struct arena *arena, struct arena_mark mark);
+
+/*******************************************************************************
+* function: arena_reset
+* purpose: release every allocation, chunks are kept for reuse
+*******************************************************************************/
+
+void arena_reset(struct arena *arena);
+
+/*******************************************************************************
+* function: arena_trim
+* purpose: return to the system every chunk that is not in use right now
+*******************************************************************************/
+
+void arena_trim(struct arena *arena);
+
+#endif
@@ -0,0 +1,49 @@
+/*
+* Author: Biren Patel
+* Description: just some basic testing and debugging of the memory pool.
+* todo: write unit tests in Unity
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mempool.h"
+
+int main(void)
+{
+    mempool_init(112);
+    
+    char *x = pcalloc(48, 1);
+    
+    char *y = prealloc(x, 8);
+    
+    y[0] = 'Z';
+    
+    char *z = pmalloc(3);
+    
+    z[2] = 'Y';
+    
+    pfree(z);
+    pfree(y);
+    
+    char *w = pcalloc(16, 1);
+    
+    w[15] = '9';
+    
+    memmap(14);
+    
+    //independent pools live alongside the default pool
+    struct mempool *request = mempool_create(256);
+    
+    char *v = pmalloc_from(request, 64);
+    
+    v[0] = 'R';
+    
+    memmap_from(request, 12);
+    
+    mempool_reset(request);
+    mempool_destroy(request);
+    mempool_free();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+* Author: Biren Patel
+* Description: Fragmentation benchmark for the memory pool. A long synthetic
+* alloc/free trace with mixed lifetimes is replayed against one pool, and at
+* regular checkpoints the largest allocatable block is compared to the total
+* bytes not handed out to the user. A pool that coalesces well keeps the ratio
+* close to zero and never fails a request while free bytes are ample.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mempool.h"
+
+/*******************************************************************************
+* benchmark parameters
+* @ POOL_SIZE : bytes given to mempool_create()
+* @ TRACE_LENGTH : total alloc and free operations replayed
+* @ LIVE_SLOTS : maximum simultaneously live allocations
+* @ CHECKPOINTS : total fragmentation measurements across the trace
+*******************************************************************************/
+
+#define POOL_SIZE (64 * 1024 * 1024)
+#define TRACE_LENGTH 20000000
+#define LIVE_SLOTS 65536
+#define CHECKPOINTS 10
+
+/*******************************************************************************
+xorshift64 keeps the trace identical across runs and allocators.
+*/
+
+static uint64_t trace_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t trace_next(void)
+{
+    trace_state ^= trace_state << 13;
+    trace_state ^= trace_state >> 7;
+    trace_state ^= trace_state << 17;
+    return trace_state;
+}
+
+/*******************************************************************************
+Mostly small container nodes, some medium buffers, and rare large arrays. The
+large requests are the ones that fail first when free space is shredded.
+*/
+
+static size_t trace_size(void)
+{
+    uint64_t dice = trace_next() % 100;
+
+    if (dice < 80) return 8 + trace_next() % 248;
+    else if (dice < 98) return 256 + trace_next() % 3840;
+    else return 4096 + trace_next() % 61440;
+}
+
+/*******************************************************************************
+Binary search on pmalloc for the largest block the pool can hand out right now.
+*/
+
+static size_t largest_block(struct mempool *pool, size_t ceiling)
+{
+    size_t lo = 0;
+    size_t hi = ceiling;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        void *probe = pmalloc_from(pool, mid);
+
+        if (probe != NULL)
+        {
+            pfree_from(pool, probe);
+            lo = mid;
+        }
+        else hi = mid - 1;
+    }
+
+    return lo;
+}
+
+/******************************************************************************/
+
+int main(void)
+{
+    struct mempool *pool = mempool_create(POOL_SIZE);
+
+    if (pool == NULL)
+    {
+        fprintf(stderr, "mempool_create failed\n");
+        return EXIT_FAILURE;
+    }
+
+    static void *ptr[LIVE_SLOTS];
+    static size_t len[LIVE_SLOTS];
+
+    size_t live_bytes = 0;
+    size_t failures = 0;
+    size_t allocations = 0;
+    clock_t probing = 0;
+
+    printf("%10s %12s %12s %12s %8s\n", "op", "live", "unused", "largest", "frag");
+
+    clock_t start = clock();
+
+    for (size_t op = 1; op <= TRACE_LENGTH; op++)
+    {
+        size_t i = trace_next() % LIVE_SLOTS;
+
+        if (ptr[i] != NULL)
+        {
+            pfree_from(pool, ptr[i]);
+            live_bytes -= len[i];
+            ptr[i] = NULL;
+        }
+        else
+        {
+            len[i] = trace_size();
+            ptr[i] = pmalloc_from(pool, len[i]);
+            allocations++;
+
+            if (ptr[i] == NULL) failures++;
+            else live_bytes += len[i];
+        }
+
+        if (op % (TRACE_LENGTH / CHECKPOINTS) == 0)
+        {
+            //probes are excluded from the replay time below
+            clock_t probe_start = clock();
+            size_t unused = POOL_SIZE - live_bytes;
+            size_t largest = largest_block(pool, unused);
+            probing += clock() - probe_start;
+
+            printf("%10zu %12zu %12zu %12zu %8.4f\n", op, live_bytes, unused,
+                   largest, 1.0 - (double) largest / (double) unused);
+        }
+    }
+
+    clock_t elapsed = clock() - start - probing;
+
+    printf("\nallocations: %zu\n", allocations);
+    printf("failures: %zu\n", failures);
+    printf("ns per op: %.1f\n", 1e9 * (double) elapsed / CLOCKS_PER_SEC / TRACE_LENGTH);
+
+    //pool counters include the pmalloc calls made by the probes
+    struct mempool_stats stats;
+    mempool_stats(pool, &stats);
+
+    printf("peak bytes in use: %zu\n", stats.peak);
+    printf("mean search length: %.3f\n", stats.search_length);
+
+    mempool_destroy(pool);
+
+    return EXIT_SUCCESS;
+}
@@ -1,347 +1,2359 @@
 /*
 * Author: Biren Patel
-* Description: Memory pool implementation with 8 byte alignment. Managed by a
-* circular doubly linked list of nodes embedded at the head of each user block.
-* Nodes may merge or split during pfree and prealloc to reduce fragmentation. 
+* Description: Memory pool implementation with at least 8 byte alignment. Blocks
+* are laid out back to back with a header before each user block and a boundary
+* tag at the end of each free block, so both physical neighbors are found in
+* constant time. Blocks may merge or split during pfree and prealloc to reduce
+* fragmentation. Free blocks are also indexed by size class in a two-level
+* segregated fit (TLSF) table, so pmalloc and pfree run in constant time at any
+* occupancy. Every pool is independent, and the global API wraps a single
+* default pool. Growable pools add mapped chunks once the initial region is
+* full. Each chunk starts as one free block and ends with a zero-size sentinel
+* block, so blocks never coalesce across chunks. Buddy pools replace all of the
+* above with a binary buddy system over a single power-of-two region. Every pool
+* keeps a few running counters, and an optional sampled profile attributes
+* allocations to their call stacks. File pools map the manager and region from a
+* file, and since free lists link by offset the pool is usable again as soon as
+* the file is mapped back in.
 */
 
+#define _DEFAULT_SOURCE
+
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <stdio.h>
+#include <math.h>
+
+#include "mempool.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __GLIBC__
+    #include <execinfo.h>
+#endif
+
+/*******************************************************************************
+* struct: block
+* purpose: header hidden before requested memory, the next physical block starts
+* immediately after the user memory and the previous one is found via its tag
+* @ head : byte-size of the user memory, the low 3 bits are always zero in the
+*          size so they hold the BLOCK_* flags instead
+* note: in total, if a user requests an x-byte block, x + 8 bytes are reserved
+*******************************************************************************/
+
+struct block
+{
+    size_t head;
+};
+
+/*******************************************************************************
+* header flags and accessors
+* @ BLOCK_FREE : the block is available
+* @ BLOCK_PREV_FREE : the previous physical block is available
+* @ BLOCK_PREV_SMALL : the previous physical block is available and holds only
+*                     MIN_USER bytes, too few for a boundary tag after its links
+* @ SIZE_OF : byte-size of the user memory of a block
+* @ SET_SIZE : overwrite the size of a block and keep its flags
+*******************************************************************************/
+
+#define BLOCK_FREE ((size_t) 0x1)
+#define BLOCK_PREV_FREE ((size_t) 0x2)
+#define BLOCK_PREV_SMALL ((size_t) 0x4)
+#define FLAG_MASK ((size_t) 0x7)
+#define SIZE_OF(block) ((block)->head & ~FLAG_MASK)
+#define SET_SIZE(block, size) ((block)->head = (size) | ((block)->head & FLAG_MASK))
+
+/*******************************************************************************
+* struct: links
+* purpose: size class list node, stored in the user memory of free blocks only
+* @ prev : previous free block in the same size class, 0 at the list head
+* @ next : next free block in the same size class, 0 at the list tail
+* note: links are byte offsets from the manager rather than pointers, so that a
+* file-backed pool stays valid wherever it is mapped next time
+*******************************************************************************/
+
+struct links
+{
+    size_t prev;
+    size_t next;
+};
+
+/*******************************************************************************
+* size class macros
+* @ SL_LOG2 : each power of two range is split into 2^SL_LOG2 linear classes
+* @ FL_SHIFT : blocks under 2^FL_SHIFT bytes share first level zero
+* @ FL_MAX_LOG2 : pools and blocks must be smaller than 2^FL_MAX_LOG2 bytes
+* @ FL_COUNT : total first level classes
+* @ SL_COUNT : total second level classes per first level class
+*******************************************************************************/
+
+#define SL_LOG2 4
+#define FL_SHIFT (SL_LOG2 + 3)
+#define FL_MAX_LOG2 40
+#define FL_COUNT (FL_MAX_LOG2 - FL_SHIFT + 1)
+#define SL_COUNT (1 << SL_LOG2)
+
+/*******************************************************************************
+* struct: chunk
+* purpose: trailer at the very end of a mapped chunk, just after its sentinel
+* @ base : start of the mapping
+* @ first : first block of the chunk, placed just after base to suit alignment
+* @ length : byte size of the mapping
+* @ since : pool tick at which the chunk became entirely free
+* @ idle : chunk is entirely free and waiting in the idle list to be purged
+* @ next : next chunk of the pool, every mapped chunk is on this list
+* @ idle_prev : previous chunk in the idle list, ordered by since
+* @ idle_next : next chunk in the idle list
+*******************************************************************************/
+
+struct chunk
+{
+    char *base;
+    struct block *first;
+    size_t length;
+    size_t since;
+    bool idle;
+    struct chunk *next;
+    struct chunk *idle_prev;
+    struct chunk *idle_next;
+};
+
+/*******************************************************************************
+* struct: buddy_node
+* purpose: free list node at the start of a free block of a buddy pool
+*******************************************************************************/
+
+struct buddy_node
+{
+    struct buddy_node *prev;
+    struct buddy_node *next;
+};
+
+/*******************************************************************************
+* struct: buddy
+* purpose: state of a buddy pool, allocated in the same block as its manager
+* @ min_order : log2 of the smallest block
+* @ max_order : log2 of the region, which is the one block of that order
+* @ orders : bit k set when order k has a free block
+* @ heads : free list of each order
+* @ free_map : bit i of order k set when the block at offset i << k is free,
+*             which is the only lookup needed to decide a merge
+* @ order_of : order of each block in use, indexed by offset >> min_order
+*******************************************************************************/
+
+struct buddy
+{
+    unsigned min_order;
+    unsigned max_order;
+    uint64_t orders;
+    struct buddy_node *heads[FL_MAX_LOG2];
+    uint64_t *free_map[FL_MAX_LOG2];
+    uint8_t *order_of;
+};
+
+/*******************************************************************************
+* struct: mempool
+* purpose: manager for the physical block sequence and memory pool
+* @ size : total byte size of the pool region
+* @ top : points to first open and aligned byte after the last occupied block
+* @ available : total bytes available outside of blocks (from *top onward)
+* @ fl_bitmap : bit i set when any class in first level i holds a free block
+* @ sl_bitmap : bit j of word i set when class (i, j) holds a free block
+* @ classes : heads of the free lists for each size class, as link offsets
+* @ align : every user pointer is a multiple of align, a power of two
+* @ chunk : minimum byte size of a grown chunk, 0 if the pool cannot grow
+* @ idle : pool ticks a chunk must stay entirely free before it is purged
+* @ ticks : total pmalloc and pfree calls, the clock for the idle threshold
+* @ flags : MEMPOOL_* options given to mempool_create_growable()
+* @ chunks : every chunk mapped after the initial region
+* @ idle_head : chunk that has been entirely free for the longest time
+* @ idle_tail : chunk that most recently became entirely free
+* @ stats : running counters, the derived fields are only filled on a snapshot
+* @ searches : free list searches made on behalf of pmalloc
+* @ probes : bitmap words examined by those searches
+* @ free_bytes : user bytes held by the blocks filed in the size classes
+* @ profile : sampled allocation-site profile, null unless profiling
+* @ buddy : buddy system state, null unless the pool is a buddy pool
+* @ magic : FILE_MAGIC if the manager and region are mapped from a file, else 0
+* @ root : link offset of the root object of a file pool, 0 if none
+* note: the pool region is allocated in the same block, just after the manager,
+* unless the pool is growable in which case the region is mapped separately
+*******************************************************************************/
+
+struct mempool
+{
+    size_t size;
+    size_t available;
+    void *pool;
+    void *top;
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[FL_COUNT];
+    size_t classes[FL_COUNT][SL_COUNT];
+    size_t align;
+    size_t chunk;
+    size_t idle;
+    size_t ticks;
+    unsigned flags;
+    struct chunk *chunks;
+    struct chunk *idle_head;
+    struct chunk *idle_tail;
+    struct mempool_stats stats;
+    size_t searches;
+    size_t probes;
+    size_t free_bytes;
+    struct profile *profile;
+    struct buddy *buddy;
+    uint64_t magic;
+    size_t root;
+};
+
+/*******************************************************************************
+* variable: manager
+* purpose: the default pool behind the global API, null until mempool_init()
+*******************************************************************************/
+
+static struct mempool *manager = NULL;
+
+/*******************************************************************************
+* prototypes and general macros
+* @ ALIGNMENT : minimum alignment of every pool, this macro cannot be modified
+* @ ALIGN_MASK : used for alignment modulus masking
+* @ ROUND_TO_ALIGN : round a value upward to the next multiple of the alignment
+* @ MAX_ALIGN : largest pool-wide alignment accepted by mempool_set_alignment()
+* @ IS_POW2 : true if x is a nonzero power of two
+* @ SIZEOF_BLOCK : sizeof(struct block) assuming 64-bit
+* @ SIZEOF_TAG : byte-size of the boundary tag copy of size in free blocks
+* @ MIN_USER : smallest user block, free blocks must hold links
+* @ MIN_SPLIT: minimum byte threshold required to call split_this_block()
+* @ CONTAINER_OF : access block node via pointer to first byte of user memory
+* @ LINKS_OF : access size class list node of a free block
+* @ LINK_TO : link offset of a block, the manager is never a block so 0 is free
+* @ LINK_AT : block at a nonzero link offset
+* @ TAG_OF : access boundary tag in the final word of a free block over MIN_USER
+* @ NEXT_BLOCK : access the physically next block, which may be the pool top
+* @ PREV_SIZE : size of the previous block via its tag or the small flag
+* @ PREV_BLOCK : access the physically previous block, only if it is available
+*******************************************************************************/
+
+#define ALIGNMENT 0x8
+#define ALIGN_MASK (ALIGNMENT - 0x1)
+#define ROUND_TO_ALIGN(value) (value += ((ALIGNMENT - (value & ALIGN_MASK)) & ALIGN_MASK))
+#define MAX_ALIGN 4096
+#define IS_POW2(x) ((x) != 0 && ((x) & ((x) - 1)) == 0)
+#define SIZEOF_BLOCK 8
+#define SIZEOF_TAG 8
+#define MIN_USER (sizeof(struct links))
+#define MIN_SPLIT (SIZEOF_BLOCK + MIN_USER)
+#define CONTAINER_OF(ptr) ((struct block*) ((char*) ptr - SIZEOF_BLOCK))
+#define LINKS_OF(block) ((struct links*) ((block) + 1))
+#define LINK_TO(pool, block) ((size_t) ((uintptr_t) (block) - (uintptr_t) (pool)))
+#define LINK_AT(pool, link) ((struct block*) ((uintptr_t) (pool) + (link)))
+#define TAG_OF(block) ((size_t*) ((char*) ((block) + 1) + SIZE_OF(block)) - 1)
+#define NEXT_BLOCK(block) ((struct block*) ((char*) ((block) + 1) + SIZE_OF(block)))
+#define PREV_SIZE(block) (((block)->head & BLOCK_PREV_SMALL) ? MIN_USER : ((size_t*) (block))[-1])
+#define PREV_BLOCK(block) ((struct block*) ((char*) (block) - PREV_SIZE(block) - SIZEOF_BLOCK))
+
+/*******************************************************************************
+* chunk macros
+* @ PAGE_SIZE : granularity of mappings and of pages handed back to the OS
+* @ HUGE_PAGE_SIZE : granularity of mappings when huge pages are requested
+* @ SIZEOF_CHUNK : byte-size of the chunk trailer rounded up to the alignment
+* @ CHUNK_OF : access chunk trailer via pointer to the sentinel block
+* @ IS_SENTINEL : true if a block is the zero-size sentinel that ends a chunk
+*******************************************************************************/
+
+#define PAGE_SIZE ((size_t) 4096)
+#define HUGE_PAGE_SIZE ((size_t) 2 * 1024 * 1024)
+#define SIZEOF_CHUNK ((sizeof(struct chunk) + ALIGN_MASK) & ~(size_t) ALIGN_MASK)
+#define CHUNK_OF(sentinel) ((struct chunk*) ((sentinel) + 1))
+#define IS_SENTINEL(block) (SIZE_OF(block) == 0)
+
+/*******************************************************************************
+* file pool macros
+* @ FILE_MAGIC : "MEMPOOL1" in the magic field of a file pool
+* @ FILE_LENGTH : byte size of the file and mapping behind a file pool
+*******************************************************************************/
+
+#define FILE_MAGIC UINT64_C(0x314C4F4F504D454D)
+#define FILE_LENGTH(pool) (sizeof(struct mempool) + (pool)->size)
+
+/*******************************************************************************
+* profile macros
+* @ PROFILE_DEPTH : deepest call stack recorded for an allocation site
+* @ PROFILE_SITES : capacity of the site table, a power of two
+* @ PROFILE_LIVE : capacity of the table of sampled blocks, a power of two
+* @ PROFILE_FULL : either table refuses new entries past 3/4 occupancy
+*******************************************************************************/
+
+#define PROFILE_DEPTH 16
+#define PROFILE_SITES 4096
+#define PROFILE_LIVE 16384
+#define PROFILE_FULL(used, capacity) ((used) >= (capacity) / 4 * 3)
+
+/*******************************************************************************
+* struct: site
+* purpose: one distinct allocation call stack and the traffic estimated for it
+* @ hash : hash of the frames, 0 marks an unused slot
+* @ depth : number of frames recorded, innermost first
+* @ frames : return addresses, the first is the caller of the pool function
+* @ alloc_objects : estimated allocations made from this stack
+* @ alloc_bytes : estimated user bytes allocated from this stack
+* @ live_objects : estimated allocations from this stack not yet freed
+* @ live_bytes : estimated user bytes from this stack not yet freed
+*******************************************************************************/
+
+struct site
+{
+    size_t hash;
+    size_t depth;
+    void *frames[PROFILE_DEPTH];
+    double alloc_objects;
+    double alloc_bytes;
+    double live_objects;
+    double live_bytes;
+};
+
+/*******************************************************************************
+* struct: sample
+* purpose: a sampled block still in use, so that pfree can retire its estimate
+* @ ptr : user memory of the block, null marks an unused slot
+* @ site : index of the site that allocated the block
+* @ objects : allocations this one sample stands for
+* @ bytes : user bytes this one sample stands for
+*******************************************************************************/
+
+struct sample
+{
+    void *ptr;
+    size_t site;
+    double objects;
+    double bytes;
+};
+
+/*******************************************************************************
+* struct: profile
+* purpose: open addressing tables of sites and of sampled blocks still in use
+* @ rate : mean bytes allocated between two samples
+* @ countdown : bytes left to allocate before the next sample is taken
+* @ seed : xorshift64 state that randomizes the distance between samples
+* @ sites_used : occupied slots of the site table
+* @ samples : occupied slots of the sample table
+* @ dropped : samples not recorded because a table was full
+*******************************************************************************/
+
+struct profile
+{
+    size_t rate;
+    size_t countdown;
+    uint64_t seed;
+    size_t sites_used;
+    size_t samples;
+    size_t dropped;
+    struct site sites[PROFILE_SITES];
+    struct sample live[PROFILE_LIVE];
+};
+
+static inline struct block *split_this_block(struct block *block, size_t size);
+static inline void merge_next_block(struct block *block);
+static inline void insert_free_block(struct mempool *pool, struct block *block);
+static inline void remove_free_block(struct mempool *pool, struct block *block);
+static inline struct block *search_free_block(struct mempool *pool, size_t size);
+static void release_block(struct mempool *pool, struct block *block);
+static void *take_free_block(struct mempool *pool, struct block *block, size_t size);
+static bool grow_in_place(struct mempool *pool, struct block *block, size_t size);
+static inline size_t round_size(struct mempool *pool, size_t size);
+static inline size_t region_lead(void *start, size_t align);
+static struct block *grow_pool(struct mempool *pool, size_t size);
+static void chunk_idle(struct mempool *pool, struct chunk *chunk);
+static void chunk_busy(struct mempool *pool, struct chunk *chunk);
+static void purge_idle_chunks(struct mempool *pool);
+static void *map_region(size_t length, bool huge);
+static void unmap_region(void *ptr, size_t length);
+static void purge_region(void *ptr, size_t length);
+static void *map_file(const char *path, size_t *length, bool *fresh);
+static bool sync_file(void *ptr, size_t length);
+static void *pool_malloc(struct mempool *pool, size_t size, void *caller);
+static void *pool_calloc(struct mempool *pool, size_t n, size_t size, void *caller);
+static void *pool_realloc(struct mempool *pool, void *ptr, size_t size, void *caller);
+static void *pool_memalign(struct mempool *pool, size_t alignment, size_t size, void *caller);
+static void *allocate(struct mempool *pool, size_t size);
+static inline void count_alloc(struct mempool *pool, void *ptr, void *caller);
+static inline void count_free(struct mempool *pool, void *ptr);
+static size_t profile_gap(struct profile *profile);
+static void profile_alloc(struct profile *profile, void *ptr, size_t size, void *caller);
+static void profile_free(struct profile *profile, void *ptr);
+static void profile_clear(struct profile *profile);
+static inline size_t usable_size(struct mempool *pool, void *ptr);
+static void *buddy_alloc(struct mempool *pool, size_t size);
+static void *buddy_realloc(struct mempool *pool, void *ptr, size_t size, void *caller);
+static void buddy_free(struct mempool *pool, void *ptr);
+static void buddy_reset(struct mempool *pool);
+
+/*******************************************************************************
+* function: mempool_create
+* purpose: heap-allocated initialization of an independent memory pool
+* @ size : total byte size of pool
+* returns: pool handle, null if size is too small or malloc fails
+*******************************************************************************/
+
+struct mempool *mempool_create(size_t size)
+{
+    //one header and the smallest user block are required at a minimum
+    ROUND_TO_ALIGN(size);
+    if (size < MIN_SPLIT) return NULL;
+
+    //size classes only span blocks under 2^FL_MAX_LOG2 bytes
+    if (size >> FL_MAX_LOG2) return NULL;
+
+    struct mempool *pool = malloc(sizeof(struct mempool) + size);
+    if (pool == NULL) return NULL;
+
+    pool->pool = pool + 1;
+    pool->size = size;
+    assert((uintptr_t) pool->pool % ALIGNMENT == 0 && "pool unaligned");
+
+    pool->align = ALIGNMENT;
+    pool->chunk = 0;
+    pool->idle = 0;
+    pool->ticks = 0;
+    pool->flags = 0;
+    pool->chunks = NULL;
+    pool->stats = (struct mempool_stats) {0};
+    pool->searches = 0;
+    pool->probes = 0;
+    pool->profile = NULL;
+    pool->buddy = NULL;
+    pool->magic = 0;
+
+    mempool_reset(pool);
+
+    return pool;
+}
+
+/*******************************************************************************
+* function: mempool_create_growable
+* purpose: memory pool whose region is mapped and which maps chunks when full
+* @ size : total byte size of the initial region
+* @ chunk : minimum byte size of each chunk mapped when the pool is full
+* @ idle : pool operations a chunk must stay entirely free before its pages
+*          are returned to the OS, SIZE_MAX to never return them
+* @ flags : MEMPOOL_HUGEPAGE to back the region and chunks with huge pages
+* returns: pool handle, null if a size is out of range or the mapping fails
+*******************************************************************************/
+
+struct mempool *mempool_create_growable(size_t size, size_t chunk, size_t idle, unsigned flags)
+{
+    size_t granule = (flags & MEMPOOL_HUGEPAGE) ? HUGE_PAGE_SIZE : PAGE_SIZE;
+
+    //every mapping is a whole number of pages, so round both sizes up front
+    if (size >> FL_MAX_LOG2 || chunk >> FL_MAX_LOG2) return NULL;
+    size = (size + granule - 1) & ~(granule - 1);
+    chunk = (chunk + granule - 1) & ~(granule - 1);
+
+    if (size < MIN_SPLIT || chunk == 0) return NULL;
+
+    struct mempool *pool = malloc(sizeof(struct mempool));
+    if (pool == NULL) return NULL;
+
+    pool->pool = map_region(size, flags & MEMPOOL_HUGEPAGE);
+
+    if (pool->pool == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pool->size = size;
+    pool->align = ALIGNMENT;
+    pool->chunk = chunk;
+    pool->idle = idle;
+    pool->ticks = 0;
+    pool->flags = flags;
+    pool->chunks = NULL;
+    pool->stats = (struct mempool_stats) {0};
+    pool->searches = 0;
+    pool->probes = 0;
+    pool->profile = NULL;
+    pool->buddy = NULL;
+    pool->magic = 0;
+
+    mempool_reset(pool);
+
+    return pool;
+}
+
+/*******************************************************************************
+* function: mempool_create_buddy
+* purpose: memory pool run as a binary buddy system
+* @ size : byte size of the region, rounded up to a power of two
+* @ min_block : byte size of the smallest block, rounded up to a power of two
+*               of at least 16. Requests under it still take a whole block.
+* @ flags : MEMPOOL_HUGEPAGE to back the region with huge pages
+* returns: pool handle, null if a size is out of range or the mapping fails
+* note: the manager also holds one free bitmap per order and one byte per
+* smallest block, about size / min_block * 1.25 bytes in all
+*******************************************************************************/
+
+struct mempool *mempool_create_buddy(size_t size, size_t min_block, unsigned flags)
+{
+    if (size == 0 || size > (size_t) 1 << (FL_MAX_LOG2 - 1)) return NULL;
+    if (min_block < sizeof(struct buddy_node)) min_block = sizeof(struct buddy_node);
+
+    unsigned max_order = size == 1 ? 0 : 64 - (unsigned) __builtin_clzll(size - 1);
+    unsigned min_order = 64 - (unsigned) __builtin_clzll(min_block - 1);
+    if (min_order > max_order) return NULL;
+
+    //every order gets at least one bitmap word, and every smallest block a byte
+    size_t words = 0;
+    size_t blocks = (size_t) 1 << (max_order - min_order);
+
+    for (unsigned k = min_order; k <= max_order; k++)
+    {
+        words += (((size_t) 1 << (max_order - k)) + 63) / 64;
+    }
+
+    size_t bytes = sizeof(struct mempool) + sizeof(struct buddy) + words * sizeof(uint64_t) + blocks;
+
+    struct mempool *pool = malloc(bytes);
+    if (pool == NULL) return NULL;
+
+    pool->size = (size_t) 1 << max_order;
+    pool->pool = map_region(pool->size, flags & MEMPOOL_HUGEPAGE);
+
+    if (pool->pool == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    struct buddy *buddy = (struct buddy*) (pool + 1);
+    uint64_t *map = (uint64_t*) (buddy + 1);
+
+    buddy->min_order = min_order;
+    buddy->max_order = max_order;
+
+    for (unsigned k = min_order; k <= max_order; k++)
+    {
+        buddy->free_map[k] = map;
+        map += (((size_t) 1 << (max_order - k)) + 63) / 64;
+    }
+
+    buddy->order_of = (uint8_t*) map;
+
+    //blocks sit at multiples of their size from a page-aligned base
+    pool->align = min_order < 12 ? (size_t) 1 << min_order : PAGE_SIZE;
+    pool->chunk = 0;
+    pool->idle = 0;
+    pool->ticks = 0;
+    pool->flags = flags;
+    pool->chunks = NULL;
+    pool->stats = (struct mempool_stats) {0};
+    pool->searches = 0;
+    pool->probes = 0;
+    pool->profile = NULL;
+    pool->buddy = buddy;
+    pool->magic = 0;
+
+    mempool_reset(pool);
+
+    return pool;
+}
+
+/*******************************************************************************
+* function: mempool_open
+* purpose: memory pool whose manager and region are mapped from a file, shared
+* so that every block written is written to the file as well
+* @ path : pool file, created if it does not exist or is empty
+* @ size : total byte size of the pool, ignored if the file already holds one
+* returns: pool handle, null if the file holds something other than a pool,
+* the size is out of range, or the file cannot be mapped
+* note: a reopened pool keeps every block and the free lists as they were, only
+* the region address and the top of the pool are moved to the new mapping. The
+* run-time state does not survive, so the profile is off again.
+*******************************************************************************/
+
+struct mempool *mempool_open(const char *path, size_t size)
+{
+    //a size out of range is only an error if the file has to be created
+    ROUND_TO_ALIGN(size);
+    bool fresh = false;
+    size_t length = size < MIN_SPLIT || size >> FL_MAX_LOG2 ? 0 : sizeof(struct mempool) + size;
+
+    struct mempool *pool = map_file(path, &length, &fresh);
+    if (pool == NULL) return NULL;
+
+    if (fresh)
+    {
+        pool->pool = pool + 1;
+        pool->size = size;
+
+        pool->align = ALIGNMENT;
+        pool->chunk = 0;
+        pool->idle = 0;
+        pool->ticks = 0;
+        pool->flags = 0;
+        pool->chunks = NULL;
+        pool->stats = (struct mempool_stats) {0};
+        pool->searches = 0;
+        pool->probes = 0;
+        pool->profile = NULL;
+        pool->buddy = NULL;
+        pool->magic = FILE_MAGIC;
+
+        mempool_reset(pool);
+
+        return pool;
+    }
+
+    //the mapping may be anywhere, so only pointers into the region need fixing
+    if (length < sizeof(struct mempool) || pool->magic != FILE_MAGIC || length != FILE_LENGTH(pool))
+    {
+        unmap_region(pool, length);
+        return NULL;
+    }
+
+    size_t top = (size_t) ((char*) pool->top - (char*) pool->pool);
+
+    pool->pool = pool + 1;
+    pool->top = (char*) pool->pool + top;
+    pool->chunks = NULL;
+    pool->idle_head = NULL;
+    pool->idle_tail = NULL;
+    pool->profile = NULL;
+
+    return pool;
+}
+
+/*******************************************************************************
+* function: mempool_sync
+* purpose: flush every dirty page of a file pool to the file
+* returns: false if the pool is not a file pool or the flush fails
+* note: the file is only consistent between calls into the pool
+*******************************************************************************/
+
+bool mempool_sync(struct mempool *pool)
+{
+    assert(pool != NULL && "pool is null");
+
+    if (pool->magic != FILE_MAGIC) return false;
+
+    return sync_file(pool, FILE_LENGTH(pool));
+}
+
+/*******************************************************************************
+* function: mempool_set_root, mempool_root
+* purpose: name the block a reopened file pool is entered from, since no pointer
+* held by the program survives a restart. Any pool accepts a root.
+* @ ptr : user pointer from the pool, or null to clear the root
+* note: a reset clears the root along with every block
+*******************************************************************************/
+
+void mempool_set_root(struct mempool *pool, void *ptr)
+{
+    assert(pool != NULL && "pool is null");
+
+    pool->root = ptr == NULL ? 0 : LINK_TO(pool, ptr);
+}
+
+void *mempool_root(struct mempool *pool)
+{
+    assert(pool != NULL && "pool is null");
+
+    return pool->root == 0 ? NULL : (void*) LINK_AT(pool, pool->root);
+}
+
+/*******************************************************************************
+* function: mempool_destroy
+* purpose: release the memory pool and its manager, the handle is dangling after
+* note: a file pool is unmapped and its file is left in place for mempool_open()
+*******************************************************************************/
+
+void mempool_destroy(struct mempool *pool)
+{
+    if (pool->magic == FILE_MAGIC)
+    {
+        free(pool->profile);
+        pool->profile = NULL;
+        unmap_region(pool, FILE_LENGTH(pool));
+        return;
+    }
+
+    if (pool->chunk != 0)
+    {
+        mempool_reset(pool);
+        unmap_region(pool->pool, pool->size);
+    }
+    else if (pool->buddy != NULL) unmap_region(pool->pool, pool->size);
+
+    free(pool->profile);
+    free(pool);
+}
+
+/*******************************************************************************
+* function: mempool_reset
+* purpose: return every block in the pool at once without touching user memory
+* note: chunks of a growable pool are unmapped, leaving only the initial region
+*******************************************************************************/
+
+void mempool_reset(struct mempool *pool)
+{
+    assert(pool != NULL && "pool is null");
+
+    //cumulative counters survive a reset, but nothing is in use any longer
+    pool->stats.in_use = 0;
+    pool->free_bytes = 0;
+    pool->root = 0;
+    if (pool->profile != NULL) profile_clear(pool->profile);
+
+    if (pool->buddy != NULL)
+    {
+        buddy_reset(pool);
+        return;
+    }
+
+    while (pool->chunks != NULL)
+    {
+        struct chunk *next = pool->chunks->next;
+        unmap_region(pool->chunks->base, pool->chunks->length);
+        pool->chunks = next;
+    }
+
+    pool->idle_head = NULL;
+    pool->idle_tail = NULL;
+
+    //the first header sits just below an aligned address, blocks then keep
+    //the alignment because every block spans a multiple of it
+    size_t lead = region_lead(pool->pool, pool->align);
+    assert(lead + MIN_SPLIT <= pool->size && "region too small for alignment");
+
+    pool->top = (char*) pool->pool + lead;
+    pool->available = pool->size - lead;
+
+    //every size class starts empty, the heads are ignored while bits are clear
+    pool->fl_bitmap = 0;
+    memset(pool->sl_bitmap, 0, sizeof(pool->sl_bitmap));
+}
+
+/*******************************************************************************
+* function: mempool_set_alignment
+* purpose: change the alignment of every user pointer handed out by the pool
+* @ alignment : power of two between 8 and 4096, 64 gives each block its own
+*               cache line start
+* returns: false if the alignment is out of range or the region is too small,
+* and always for buddy pools whose alignment follows from the block sizes
+* note: the pool is reset, so this must be called before any allocation
+*******************************************************************************/
+
+bool mempool_set_alignment(struct mempool *pool, size_t alignment)
+{
+    assert(pool != NULL && "pool is null");
+
+    if (pool->buddy != NULL) return false;
+
+    if (!IS_POW2(alignment) || alignment < ALIGNMENT || alignment > MAX_ALIGN) return false;
+    if (region_lead(pool->pool, alignment) + MIN_SPLIT > pool->size) return false;
+
+    pool->align = alignment;
+    mempool_reset(pool);
+
+    return true;
+}
+
+/*******************************************************************************
+* function: mempool_init
+* purpose: heap-allocated initialization of the default memory pool
+* @ size : total byte size of pool
+* returns: true on successful initialization
+*******************************************************************************/
+
+bool mempool_init(size_t size)
+{
+    //disallow simultaneous default pools, use mempool_create() instead
+    if (manager != NULL) return false;
+
+    manager = mempool_create(size);
+
+    return manager != NULL;
+}
+
+/*******************************************************************************
+* function: mempool_free
+* purpose: release the default memory pool and reset the pool manager
+*******************************************************************************/
+
+void mempool_free(void)
+{
+    if (manager == NULL) return;
+
+    mempool_destroy(manager);
+    manager = NULL;
+}
+
+/*******************************************************************************
+* function: pmalloc_from
+* purpose: return an available memory block from the pool
+* @ pool : pool handle returned by mempool_create()
+* @ size : total bytes requested
+* returns: void pointer, null if pmalloc cannot find a suitable memory block
+*******************************************************************************/
+
+void *pmalloc_from(struct mempool *pool, size_t size)
+{
+    return pool_malloc(pool, size, __builtin_return_address(0));
+}
+
+/*******************************************************************************
+* function: pool_malloc, pool_calloc, pool_realloc, pool_memalign
+* purpose: bodies of the public allocation functions, which read their own
+* return address and pass it down so that every profiled block is charged to
+* the client's call site rather than to another pool function
+* @ caller : return address of the public pool function, see count_alloc
+*******************************************************************************/
+
+static void *pool_malloc(struct mempool *pool, size_t size, void *caller)
+{
+    assert(pool != NULL && "pool is null");
+
+    if (size == 0) return NULL;
+
+    void *ptr = NULL;
+
+    if (size >> FL_MAX_LOG2 == 0)
+    {
+        if (pool->buddy != NULL) ptr = buddy_alloc(pool, size);
+        else ptr = allocate(pool, round_size(pool, size));
+    }
+
+    if (ptr == NULL)
+    {
+        pool->stats.failures++;
+        return NULL;
+    }
+
+    count_alloc(pool, ptr, caller);
+
+    return ptr;
+}
+
+/*******************************************************************************
+* function: allocate
+* purpose: body of pool_malloc() without the counters, so that pmemalign can
+* account for the block it finally carves out rather than the padded one
+* @ size : total bytes requested, already passed through round_size()
+*******************************************************************************/
+
+static void *allocate(struct mempool *pool, size_t size)
+{
+    pool->ticks++;
+    if (pool->idle_head != NULL) purge_idle_chunks(pool);
+
+    //try to repurpose a free block from the size classes, else use pool top
+    struct block *block = search_free_block(pool, size);
+
+    if (block != NULL)
+    {
+        return take_free_block(pool, block, size);
+    }
+    else if (size + SIZEOF_BLOCK <= pool->available)
+    {
+        //place a new block node at top, the block below the top is never free
+        struct block *new = pool->top;
+
+        new->head = size;
+
+        //update manager, move top a la sbrk() and note total bytes used
+        pool->available -= SIZEOF_BLOCK + size;
+        pool->top = (char*) pool->top + (SIZEOF_BLOCK + size);
+
+        //hide the metadata and return 16 bytes above for user to use
+        assert((uintptr_t) new % ALIGNMENT == 0 && "block not aligned");
+        assert((uintptr_t) (new + 1) % pool->align == 0 && "user not aligned");
+
+        return new + 1;
+    }
+    else if (pool->chunk != 0)
+    {
+        //growable pools map a chunk whose single free block fits the request
+        block = grow_pool(pool, size);
+        if (block != NULL) return take_free_block(pool, block, size);
+    }
+
+    //not enough free memory in pool to fulfill the user request
+    return NULL;
+}
+
+/*******************************************************************************
+* function: pcalloc_from
+* purpose: return new memory block with contents initialized to zero
+* @ pool : pool handle returned by mempool_create()
+* @ n : number of array elements requested
+* @ size : byte-size of each element
+* returns: void pointer, null if pcalloc cannot find a suitable memory block
+*******************************************************************************/
+
+void *pcalloc_from(struct mempool *pool, size_t n, size_t size)
+{
+    return pool_calloc(pool, n, size, __builtin_return_address(0));
+}
+
+static void *pool_calloc(struct mempool *pool, size_t n, size_t size, void *caller)
+{
+    //todo: check for overflow before passing bytes var and return error
+    size_t bytes = size * n;
+
+    void *address = pool_malloc(pool, bytes, caller);
+
+    if (address == NULL) return NULL;
+    else
+    {
+        //ignore extra bytes that pmalloc may allocate to maintain alignment
+        memset(address, 0, bytes);
+        return address;
+    }
+}
+
+/*******************************************************************************
+* function: prealloc_from
+* purpose: change the size of the memory block pointed to by ptr to size bytes
+* @ pool : pool handle returned by mempool_create()
+* @ ptr : first byte of a memory block previously passed to user via pmalloc
+* details: a larger block is first grown in place, by absorbing a free right
+* neighbor or by raising the pool top when the block sits just below it. Only
+* when neither is possible are the bytes copied to a new block.
+*******************************************************************************/
+
+void *prealloc_from(struct mempool *pool, void *ptr, size_t size)
+{
+    return pool_realloc(pool, ptr, size, __builtin_return_address(0));
+}
+
+static void *pool_realloc(struct mempool *pool, void *ptr, size_t size, void *caller)
+{
+    //prealloc reduces to pmalloc or pfree on degenerate arguments
+    if (ptr == NULL) return pool_malloc(pool, size, caller);
+
+    if (ptr != NULL && size == 0)
+    {
+        pfree_from(pool, ptr);
+        return ptr;
+    }
+
+    if (size >> FL_MAX_LOG2)
+    {
+        pool->stats.failures++;
+        return NULL;
+    }
+
+    if (pool->buddy != NULL) return buddy_realloc(pool, ptr, size, caller);
+
+    size = round_size(pool, size);
+
+    struct block *block = CONTAINER_OF(ptr);
+
+    if (SIZE_OF(block) == size)
+    {
+        //new request still fits the alignment padding so do nothing
+        return ptr;
+    }
+    else if (SIZE_OF(block) > size)
+    {
+        //user requests less memory, split if possible else do nothing
+        if (SIZE_OF(block) - size >= MIN_SPLIT)
+        {
+            pool->stats.in_use -= SIZE_OF(block) - size;
+            release_block(pool, split_this_block(block, size));
+        }
+
+        return block + 1;
+    }
+    else
+    {
+        //request for more memory, copy as a last resort
+        pool->stats.grows++;
+
+        size_t old = SIZE_OF(block);
+
+        if (grow_in_place(pool, block, size))
+        {
+            pool->stats.grows_in_place++;
+            pool->stats.in_use += SIZE_OF(block) - old;
+            if (pool->stats.in_use > pool->stats.peak) pool->stats.peak = pool->stats.in_use;
+
+            return ptr;
+        }
+
+        void *new = pool_malloc(pool, size, caller);
+        if (new == NULL) return NULL;
+        memcpy(new, ptr, old);
+        pfree_from(pool, ptr);
+
+        return new;
+    }
+}
+
+/*******************************************************************************
+* function: pmemalign_from
+* purpose: return a memory block whose first byte is a multiple of alignment
+* @ pool : pool handle returned by mempool_create()
+* @ alignment : power of two, requests at or under the pool alignment are
+*               served by pmalloc_from() directly
+* @ size : total bytes requested
+* returns: void pointer, null if alignment is invalid or no block fits
+* details: an oversized block is allocated and the aligned block is carved out
+* of it. The leading gap is either empty or large enough to be released as a
+* free block of its own, and the tail is released as usual, so pfree_from()
+* needs no special handling.
+*******************************************************************************/
+
+void *pmemalign_from(struct mempool *pool, size_t alignment, size_t size)
+{
+    return pool_memalign(pool, alignment, size, __builtin_return_address(0));
+}
+
+static void *pool_memalign(struct mempool *pool, size_t alignment, size_t size, void *caller)
+{
+    if (!IS_POW2(alignment) || alignment >> FL_MAX_LOG2) return NULL;
+    if (alignment <= pool->align) return pool_malloc(pool, size, caller);
+
+    //a buddy block of at least alignment bytes is aligned up to the page size
+    if (pool->buddy != NULL)
+    {
+        if (alignment <= PAGE_SIZE) return pool_malloc(pool, size < alignment ? alignment : size, caller);
+
+        pool->stats.failures++;
+        return NULL;
+    }
+
+    if (size == 0 || size >> FL_MAX_LOG2) return NULL;
+    size = round_size(pool, size);
+
+    size_t padded = size + alignment + MIN_SPLIT;
+    char *user = padded >> FL_MAX_LOG2 ? NULL : allocate(pool, round_size(pool, padded));
+
+    if (user == NULL)
+    {
+        pool->stats.failures++;
+        return NULL;
+    }
+
+    struct block *block = CONTAINER_OF(user);
+
+    //gaps are multiples of the pool alignment since both ends are aligned
+    char *aligned = (char*) (((uintptr_t) user + alignment - 1) & ~((uintptr_t) alignment - 1));
+    while (aligned != user && (size_t) (aligned - user) < MIN_SPLIT) aligned += alignment;
+
+    if (aligned != user)
+    {
+        struct block *new = CONTAINER_OF(aligned);
+
+        new->head = SIZE_OF(block) - (size_t) (aligned - user);
+        SET_SIZE(block, (size_t) (aligned - user) - SIZEOF_BLOCK);
+        release_block(pool, block);
+
+        block = new;
+    }
+
+    if (SIZE_OF(block) - size >= MIN_SPLIT)
+    {
+        release_block(pool, split_this_block(block, size));
+    }
+
+    count_alloc(pool, block + 1, caller);
+
+    return block + 1;
+}
+
+/*******************************************************************************
+* function: pfree_from
+* purpose: return memory block to pool for reuse
+* @ pool : pool handle returned by mempool_create()
+* @ ptr : first byte of a memory block previously passed to user via pmalloc
+*******************************************************************************/
+
+void pfree_from(struct mempool *pool, void *ptr)
+{
+    if (ptr == NULL) return;
+
+    count_free(pool, ptr);
+
+    if (pool->buddy != NULL)
+    {
+        buddy_free(pool, ptr);
+        return;
+    }
+
+    release_block(pool, CONTAINER_OF(ptr));
+
+    pool->ticks++;
+    if (pool->idle_head != NULL) purge_idle_chunks(pool);
+}
+
+/*******************************************************************************
+* functions: pmalloc, pcalloc, prealloc, pfree, pmemalign
+* purpose: global API, thin wrappers which forward to the default pool
+*******************************************************************************/
+
+void *pmalloc(size_t size)
+{
+    if (manager == NULL) return NULL;
+
+    return pool_malloc(manager, size, __builtin_return_address(0));
+}
+
+void *pcalloc(size_t n, size_t size)
+{
+    if (manager == NULL) return NULL;
+
+    return pool_calloc(manager, n, size, __builtin_return_address(0));
+}
+
+void *prealloc(void *ptr, size_t size)
+{
+    if (manager == NULL) return NULL;
+
+    return pool_realloc(manager, ptr, size, __builtin_return_address(0));
+}
+
+void pfree(void *ptr)
+{
+    if (manager == NULL) return;
+
+    pfree_from(manager, ptr);
+}
+
+void *pmemalign(size_t alignment, size_t size)
+{
+    if (manager == NULL) return NULL;
+
+    return pool_memalign(manager, alignment, size, __builtin_return_address(0));
+}
+
+/*******************************************************************************
+* function: mempool_stats
+* purpose: snapshot the pool counters and derive the free space figures
+* @ pool : pool handle returned by mempool_create()
+* @ stats : filled with the snapshot
+* note: the counters are plain adds on every call, the derived figures walk a
+* single size class list and are only computed here
+*******************************************************************************/
+
+void mempool_stats(struct mempool *pool, struct mempool_stats *stats)
+{
+    assert(pool != NULL && "pool is null");
+    assert(stats != NULL && "stats is null");
+
+    *stats = pool->stats;
+
+    //the top is one more free block once a header is carved out of it
+    size_t top = pool->available > SIZEOF_BLOCK ? pool->available - SIZEOF_BLOCK : 0;
+
+    stats->available = pool->free_bytes + top;
+    stats->largest = top;
+
+    //the largest free block lives in the highest non-empty class
+    if (pool->fl_bitmap != 0)
+    {
+        unsigned fl = 63 - (unsigned) __builtin_clzll(pool->fl_bitmap);
+        unsigned sl = 31 - (unsigned) __builtin_clz(pool->sl_bitmap[fl]);
+
+        for (size_t link = pool->classes[fl][sl]; link != 0; link = LINKS_OF(LINK_AT(pool, link))->next)
+        {
+            struct block *b = LINK_AT(pool, link);
+            if (SIZE_OF(b) > stats->largest) stats->largest = SIZE_OF(b);
+        }
+    }
+
+    if (pool->buddy != NULL && pool->buddy->orders != 0)
+    {
+        stats->largest = (size_t) 1 << (63 - __builtin_clzll(pool->buddy->orders));
+    }
+
+    if (stats->available != 0)
+    {
+        stats->fragmentation = 1.0 - (double) stats->largest / (double) stats->available;
+    }
+
+    if (pool->searches != 0)
+    {
+        stats->search_length = (double) pool->probes / (double) pool->searches;
+    }
+}
+
+/*******************************************************************************
+* function: mempool_profile_start
+* purpose: begin sampling allocation sites, or change the rate of a running
+* profile without losing what it has recorded so far
+* @ pool : pool handle returned by mempool_create()
+* @ rate : mean bytes allocated between two samples, 1 records every allocation
+* returns: false if rate is zero or the tables cannot be allocated
+* note: the profile lives outside the pool in about 1 MiB of malloc memory
+*******************************************************************************/
+
+bool mempool_profile_start(struct mempool *pool, size_t rate)
+{
+    assert(pool != NULL && "pool is null");
+
+    if (rate == 0) return false;
+
+    if (pool->profile == NULL)
+    {
+        pool->profile = calloc(1, sizeof(struct profile));
+        if (pool->profile == NULL) return false;
+
+        pool->profile->seed = 0x9E3779B97F4A7C15ULL ^ (uintptr_t) pool;
+    }
+
+    pool->profile->rate = rate;
+    pool->profile->countdown = profile_gap(pool->profile);
+
+    return true;
+}
+
+/*******************************************************************************
+* function: mempool_profile_stop
+* purpose: stop sampling and discard the profile
+*******************************************************************************/
+
+void mempool_profile_stop(struct mempool *pool)
+{
+    assert(pool != NULL && "pool is null");
+
+    free(pool->profile);
+    pool->profile = NULL;
+}
+
+/*******************************************************************************
+* function: by_live_bytes
+* purpose: qsort comparator, heaviest sites first by live then allocated bytes
+*******************************************************************************/
+
+static int by_live_bytes(const void *a, const void *b)
+{
+    const struct site *x = *(const struct site * const *) a;
+    const struct site *y = *(const struct site * const *) b;
+
+    if (x->live_bytes != y->live_bytes) return x->live_bytes < y->live_bytes ? 1 : -1;
+    if (x->alloc_bytes != y->alloc_bytes) return x->alloc_bytes < y->alloc_bytes ? 1 : -1;
+
+    return 0;
+}
+
+/*******************************************************************************
+* function: sorted_sites
+* purpose: gather the occupied site slots in by_live_bytes order
+* returns: malloc array of site pointers which the caller frees, null on failure
+*******************************************************************************/
+
+static struct site **sorted_sites(struct profile *profile)
+{
+    struct site **sites = malloc((profile->sites_used + 1) * sizeof(struct site*));
+    if (sites == NULL) return NULL;
+
+    size_t n = 0;
+
+    for (size_t i = 0; i < PROFILE_SITES; i++)
+    {
+        if (profile->sites[i].hash != 0) sites[n++] = &profile->sites[i];
+    }
+
+    assert(n == profile->sites_used && "site count mismatch");
+    qsort(sites, n, sizeof(struct site*), by_live_bytes);
+
+    return sites;
+}
+
+/*******************************************************************************
+* function: mempool_profile_print
+* purpose: write a histogram of allocation sites, heaviest first by live bytes
+* @ pool : pool handle with a running profile, nothing is printed otherwise
+* @ stream : destination, such as stdout
+* note: a site is shown by its innermost frame, which is the caller of the pool
+* function. Run the address through addr2line, or use the pprof file for stacks.
+*******************************************************************************/
+
+#define HISTOGRAM_BAR 40
+
+void mempool_profile_print(struct mempool *pool, FILE *stream)
+{
+    assert(pool != NULL && "pool is null");
+
+    struct profile *profile = pool->profile;
+    if (profile == NULL) return;
+
+    struct site **sites = sorted_sites(profile);
+    if (sites == NULL) return;
+
+    double total = 0.0;
+    for (size_t i = 0; i < profile->sites_used; i++) total += sites[i]->live_bytes;
+
+    fprintf(stream, "%14s %10s %14s %10s  %-18s\n", "live bytes", "live objs",
+            "alloc bytes", "alloc objs", "site");
+
+    for (size_t i = 0; i < profile->sites_used; i++)
+    {
+        struct site *site = sites[i];
+        int bar = total > 0.0 ? (int) (HISTOGRAM_BAR * site->live_bytes / total + 0.5) : 0;
+
+        fprintf(stream, "%14.0f %10.0f %14.0f %10.0f  0x%016" PRIxPTR " %.*s\n",
+                site->live_bytes, site->live_objects, site->alloc_bytes,
+                site->alloc_objects, (uintptr_t) site->frames[0], bar,
+                "########################################");
+    }
+
+    fprintf(stream, "\nrate: %zu bytes, sites: %zu, dropped samples: %zu\n",
+            profile->rate, profile->sites_used, profile->dropped);
+
+    free(sites);
+}
+
+/*******************************************************************************
+* function: mempool_profile_write
+* purpose: save the profile in the legacy gperftools heap profile text format
+* @ pool : pool handle with a running profile
+* @ path : output file, which is truncated
+* returns: false if there is no profile or the file cannot be written
+* details: estimates are already scaled up, so the header declares an unsampled
+* heapprofile. Each line reads live objects: live bytes [alloc objects: alloc
+* bytes] @ stack. The process memory map follows so pprof can symbolize, and
+* the file is read with: pprof <binary> <path>
+*******************************************************************************/
+
+bool mempool_profile_write(struct mempool *pool, const char *path)
+{
+    assert(pool != NULL && "pool is null");
+
+    struct profile *profile = pool->profile;
+    if (profile == NULL) return false;
+
+    struct site **sites = sorted_sites(profile);
+    if (sites == NULL) return false;
+
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        free(sites);
+        return false;
+    }
+
+    double total[4] = {0.0};
+
+    for (size_t i = 0; i < profile->sites_used; i++)
+    {
+        total[0] += sites[i]->live_objects;
+        total[1] += sites[i]->live_bytes;
+        total[2] += sites[i]->alloc_objects;
+        total[3] += sites[i]->alloc_bytes;
+    }
+
+    fprintf(file, "heap profile: %.0f: %.0f [%.0f: %.0f] @ heapprofile\n",
+            total[0], total[1], total[2], total[3]);
+
+    for (size_t i = 0; i < profile->sites_used; i++)
+    {
+        struct site *site = sites[i];
+
+        fprintf(file, "%.0f: %.0f [%.0f: %.0f] @", site->live_objects,
+                site->live_bytes, site->alloc_objects, site->alloc_bytes);
+
+        for (size_t j = 0; j < site->depth; j++)
+        {
+            fprintf(file, " 0x%" PRIxPTR, (uintptr_t) site->frames[j]);
+        }
+
+        fprintf(file, "\n");
+    }
+
+    free(sites);
+
+    //without the map pprof can only show raw addresses
+    FILE *maps = fopen("/proc/self/maps", "r");
+
+    if (maps != NULL)
+    {
+        char line[512];
+
+        fprintf(file, "\nMAPPED_LIBRARIES:\n");
+        while (fgets(line, sizeof(line), maps) != NULL) fputs(line, file);
+
+        fclose(maps);
+    }
+
+    return fclose(file) == 0;
+}
+
+/*******************************************************************************
+* function: split_this_block
+* purpose: split an existing block into two new neighbor blocks
+* returns: the new available block, which the caller must release to the pool
+*******************************************************************************/
+
+static inline struct block *split_this_block(struct block *block, size_t size)
+{
+    uintptr_t delta = (uintptr_t) block + SIZEOF_BLOCK + size;
+    struct block  *new = (struct block *) delta;
+
+    //only blocks in use are split, so the new block never has a free neighbor
+    assert(!(block->head & BLOCK_FREE) && "split of a free block");
+    new->head = SIZE_OF(block) - size - SIZEOF_BLOCK;
+
+    assert(size == SIZE_OF(block) - SIZEOF_BLOCK - SIZE_OF(new) && "block mismatch");
+    SET_SIZE(block, size);
+
+    return new;
+}
+
+
+/*******************************************************************************
+* function: merge_next_block
+* purpose: merge the supplied block with its next neighbor
+*******************************************************************************/
+
+static inline void merge_next_block(struct block *block)
+{
+    struct block *next_block = NEXT_BLOCK(block);
+
+    //swallow bytes occupied by next block and its user data
+    SET_SIZE(block, SIZE_OF(block) + SIZE_OF(next_block) + SIZEOF_BLOCK);
+}
+
+/*******************************************************************************
+* function: release_block
+* purpose: coalesce a block with free neighbors, then file it in its size class
+* note: a block ending at the pool top is handed back to the top instead.
+*******************************************************************************/
+
+static void release_block(struct mempool *pool, struct block *block)
+{
+    //forward merge
+    struct block *next_block = NEXT_BLOCK(block);
+
+    if ((void*) next_block != pool->top && (next_block->head & BLOCK_FREE))
+    {
+        remove_free_block(pool, next_block);
+        merge_next_block(block);
+    }
+
+    //backward merge (equivalent to forward merge on prev block via its tag)
+    if (block->head & BLOCK_PREV_FREE)
+    {
+        block = PREV_BLOCK(block);
+        remove_free_block(pool, block);
+        merge_next_block(block);
+    }
+
+    next_block = NEXT_BLOCK(block);
+
+    if ((void*) next_block == pool->top)
+    {
+        //lower the top back over the block a la negative sbrk()
+        pool->available += SIZEOF_BLOCK + SIZE_OF(block);
+        pool->top = block;
+    }
+    else
+    {
+        //write the boundary tag and tell the next block where to find it, the
+        //smallest free blocks are all links so the next header flags the size
+        size_t size = SIZE_OF(block);
+        block->head |= BLOCK_FREE;
+
+        if (size > MIN_USER)
+        {
+            *TAG_OF(block) = size;
+            next_block->head = (next_block->head & ~BLOCK_PREV_SMALL) | BLOCK_PREV_FREE;
+        }
+        else next_block->head |= BLOCK_PREV_FREE | BLOCK_PREV_SMALL;
+
+        insert_free_block(pool, block);
+
+        //a free block running from chunk base to sentinel empties the chunk
+        if (IS_SENTINEL(next_block) && CHUNK_OF(next_block)->first == block)
+        {
+            chunk_idle(pool, CHUNK_OF(next_block));
+        }
+    }
+}
+
+/*******************************************************************************
+* function: take_free_block
+* purpose: hand a free block to the user, splitting off and recycling any excess
+* returns: pointer to the user memory of the block
+*******************************************************************************/
+
+static void *take_free_block(struct mempool *pool, struct block *block, size_t size)
+{
+    //free blocks never touch the top, they would have been absorbed by it
+    remove_free_block(pool, block);
+    struct block *next_block = NEXT_BLOCK(block);
+    assert((void*) next_block != pool->top && "free block below top");
+    next_block->head &= ~(BLOCK_PREV_FREE | BLOCK_PREV_SMALL);
+
+    //an idle chunk holds exactly one free block, so this one is being reused
+    if (IS_SENTINEL(next_block) && CHUNK_OF(next_block)->idle)
+    {
+        chunk_busy(pool, CHUNK_OF(next_block));
+    }
+
+    //split block into two if it is large enough and recycle the remainder
+    if (SIZE_OF(block) - size >= MIN_SPLIT)
+    {
+        release_block(pool, split_this_block(block, size));
+    }
+
+    return block + 1;
+}
+
+/*******************************************************************************
+* function: grow_in_place
+* purpose: extend a block in use to at least size bytes without moving it
+* returns: false if neither the next block nor the pool top has enough room
+* note: a free block never sits just below the top since the top absorbs it,
+* so the two cases never combine
+*******************************************************************************/
+
+static bool grow_in_place(struct mempool *pool, struct block *block, size_t size)
+{
+    struct block *next_block = NEXT_BLOCK(block);
+    size_t need = size - SIZE_OF(block);
+
+    if ((void*) next_block == pool->top)
+    {
+        //need is a multiple of the alignment, so the top stays aligned
+        if (need > pool->available) return false;
+
+        SET_SIZE(block, size);
+        pool->available -= need;
+        pool->top = (char*) pool->top + need;
+
+        return true;
+    }
+
+    if (!(next_block->head & BLOCK_FREE) || SIZEOF_BLOCK + SIZE_OF(next_block) < need) return false;
+
+    //the block after the free neighbor loses its free predecessor, and the
+    //neighbor's chunk cannot be idle because this block lives there too
+    remove_free_block(pool, next_block);
+    merge_next_block(block);
+    NEXT_BLOCK(block)->head &= ~(BLOCK_PREV_FREE | BLOCK_PREV_SMALL);
+
+    if (SIZE_OF(block) - size >= MIN_SPLIT)
+    {
+        release_block(pool, split_this_block(block, size));
+    }
+
+    return true;
+}
+
+/*******************************************************************************
+* function: round_size
+* purpose: round a request up so that header plus user memory spans a multiple
+* of the pool alignment, which keeps the next block aligned as well
+*******************************************************************************/
+
+static inline size_t round_size(struct mempool *pool, size_t size)
+{
+    if (size < MIN_USER) size = MIN_USER;
+
+    size_t mask = pool->align - 1;
+
+    return ((size + SIZEOF_BLOCK + mask) & ~mask) - SIZEOF_BLOCK;
+}
+
+/*******************************************************************************
+* function: region_lead
+* purpose: bytes to skip at the start of a region so that the user memory of a
+* block whose header is placed there lands on the alignment
+*******************************************************************************/
+
+static inline size_t region_lead(void *start, size_t align)
+{
+    uintptr_t user = (uintptr_t) start + SIZEOF_BLOCK;
+    uintptr_t aligned = (user + align - 1) & ~((uintptr_t) align - 1);
+
+    return (size_t) (aligned - user);
+}
+
+/*******************************************************************************
+* function: grow_pool
+* purpose: map a new chunk large enough for a size-byte block
+* returns: the single free block spanning the chunk, null if mapping fails
+* details: a chunk is laid out as [lead | block ... | sentinel | struct chunk].
+* The sentinel is a zero-size block that is never available, so the forward
+* merge of release_block() stops there without any bounds check. The lead and
+* the slack before the sentinel keep the user memory on the pool alignment.
+*******************************************************************************/
+
+static struct block *grow_pool(struct mempool *pool, size_t size)
+{
+    size_t granule = (pool->flags & MEMPOOL_HUGEPAGE) ? HUGE_PAGE_SIZE : PAGE_SIZE;
+    size_t length = 2 * SIZEOF_BLOCK + size + SIZEOF_CHUNK + 2 * pool->align;
+
+    if (length < pool->chunk) length = pool->chunk;
+    length = (length + granule - 1) & ~(granule - 1);
+    if (length >> FL_MAX_LOG2) return NULL;
+
+    char *base = map_region(length, pool->flags & MEMPOOL_HUGEPAGE);
+    if (base == NULL) return NULL;
+
+    //the sentinel header sits just below an aligned address like every header
+    uintptr_t end = ((uintptr_t) base + length - SIZEOF_CHUNK) & ~((uintptr_t) pool->align - 1);
+    struct block *sentinel = (struct block*) end - 1;
+    struct chunk *chunk = CHUNK_OF(sentinel);
+    struct block *block = (struct block*) (base + region_lead(base, pool->align));
+
+    chunk->base = base;
+    chunk->first = block;
+    chunk->length = length;
+    chunk->idle = false;
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+
+    sentinel->head = BLOCK_PREV_FREE;
+
+    block->head = (size_t) ((char*) sentinel - (char*) (block + 1)) | BLOCK_FREE;
+    *TAG_OF(block) = SIZE_OF(block);
+    insert_free_block(pool, block);
+
+    return block;
+}
+
+/*******************************************************************************
+* function: chunk_idle, chunk_busy
+* purpose: append an entirely free chunk to the idle list, or unlink it once a
+* block is carved from it again before the idle threshold has passed
+*******************************************************************************/
+
+static void chunk_idle(struct mempool *pool, struct chunk *chunk)
+{
+    chunk->since = pool->ticks;
+    chunk->idle = true;
+    chunk->idle_next = NULL;
+    chunk->idle_prev = pool->idle_tail;
+
+    if (pool->idle_tail != NULL) pool->idle_tail->idle_next = chunk;
+    else pool->idle_head = chunk;
+
+    pool->idle_tail = chunk;
+}
+
+static void chunk_busy(struct mempool *pool, struct chunk *chunk)
+{
+    if (chunk->idle_prev != NULL) chunk->idle_prev->idle_next = chunk->idle_next;
+    else pool->idle_head = chunk->idle_next;
+
+    if (chunk->idle_next != NULL) chunk->idle_next->idle_prev = chunk->idle_prev;
+    else pool->idle_tail = chunk->idle_prev;
+
+    chunk->idle = false;
+}
+
+/*******************************************************************************
+* function: purge_idle_chunks
+* purpose: hand the pages of chunks idle past the threshold back to the OS
+* details: the idle list is ordered by since, so only its head is ever checked.
+* The pages holding the block header, links, boundary tag, and sentinel are
+* kept, which lets the chunk stay indexed as a free block.
+* The purged pages fault back in as zero pages if the chunk is reused.
+*******************************************************************************/
+
+static void purge_idle_chunks(struct mempool *pool)
+{
+    while (pool->idle_head != NULL && pool->ticks - pool->idle_head->since >= pool->idle)
+    {
+        struct chunk *chunk = pool->idle_head;
+        chunk_busy(pool, chunk);
+
+        uintptr_t granule = (pool->flags & MEMPOOL_HUGEPAGE) ? HUGE_PAGE_SIZE : PAGE_SIZE;
+        uintptr_t start = (uintptr_t) (LINKS_OF(chunk->first) + 1);
+        uintptr_t end = (uintptr_t) TAG_OF(chunk->first);
+
+        start = (start + granule - 1) & ~(granule - 1);
+        end &= ~(granule - 1);
+
+        if (start < end) purge_region((void*) start, (size_t) (end - start));
+    }
+}
+
+/*******************************************************************************
+* function: map_region, unmap_region, purge_region, map_file, sync_file
+* purpose: platform page mapping. Huge pages are first requested explicitly and
+* otherwise hinted for transparent huge pages, and purged pages stay mapped.
+* Files are mapped shared and read-write, which is not supported on Windows.
+*******************************************************************************/
+
+#ifdef _WIN32
+
+static void *map_region(size_t length, bool huge)
+{
+    (void) huge;
+    return VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+static void unmap_region(void *ptr, size_t length)
+{
+    (void) length;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+static void purge_region(void *ptr, size_t length)
+{
+    VirtualAlloc(ptr, length, MEM_RESET, PAGE_READWRITE);
+}
+
+static void *map_file(const char *path, size_t *length, bool *fresh)
+{
+    (void) path;
+    (void) length;
+    (void) fresh;
+    return NULL;
+}
+
+static bool sync_file(void *ptr, size_t length)
+{
+    (void) ptr;
+    (void) length;
+    return false;
+}
+
+#else
+
+static void *map_region(size_t length, bool huge)
+{
+    void *ptr = MAP_FAILED;
+    int prot = PROT_READ | PROT_WRITE;
+    (void) huge;
+
+    #ifdef MAP_HUGETLB
+    if (huge) ptr = mmap(NULL, length, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    #endif
+
+    if (ptr == MAP_FAILED)
+    {
+        ptr = mmap(NULL, length, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) return NULL;
+
+        #ifdef MADV_HUGEPAGE
+        if (huge) madvise(ptr, length, MADV_HUGEPAGE);
+        #endif
+    }
+
+    return ptr;
+}
+
+static void unmap_region(void *ptr, size_t length)
+{
+    munmap(ptr, length);
+}
+
+static void purge_region(void *ptr, size_t length)
+{
+    madvise(ptr, length, MADV_DONTNEED);
+}
+
+static void *map_file(const char *path, size_t *length, bool *fresh)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd == -1) return NULL;
+
+    //an empty file is sized to length unless it is 0, otherwise length becomes
+    //the file size
+    struct stat st;
+    void *ptr = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0)
+    {
+        *fresh = st.st_size == 0;
+
+        if (*fresh && ftruncate(fd, (off_t) *length) != 0) *length = 0;
+        else if (!*fresh) *length = (size_t) st.st_size;
+
+        if (*length != 0) ptr = mmap(NULL, *length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    //the mapping keeps the file open on its own
+    close(fd);
+
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static bool sync_file(void *ptr, size_t length)
+{
+    return msync(ptr, length, MS_SYNC) == 0;
+}
 
-#include "mempool.h"
+#endif
 
 /*******************************************************************************
-* struct: block
-* purpose: circular doubly linked list node hidden before requested memory
-* @ size : the byte-size of the memory block handed back to the user
-* @ available : flag where 1 indiciates that the block is free
-* note: in total, if a user requests an x-byte block, x + 32 bytes are reserved
+* buddy macros
+* @ BUDDY_OFFSET : byte offset of a block from the start of the region
+* @ BUDDY_WORD : free_map word holding the bit of the block at offset off
+* @ BUDDY_MASK : mask of that bit within its word
+* @ ORDER_FOR : smallest order of a buddy pool whose blocks hold size bytes
 *******************************************************************************/
 
-struct block
-{
-    struct block *prev;
-    struct block *next;
-    size_t size;
-    char available;
-    char reserved[7];
-};
+#define BUDDY_OFFSET(pool, ptr) ((size_t) ((char*) (ptr) - (char*) (pool)->pool))
+#define BUDDY_WORD(b, k, off) ((b)->free_map[k][((off) >> (k)) / 64])
+#define BUDDY_MASK(k, off) (UINT64_C(1) << (((off) >> (k)) % 64))
+#define ORDER_FOR(b, size) ((size) <= ((size_t) 1 << (b)->min_order) ? (b)->min_order : \
+                           64 - (unsigned) __builtin_clzll((size) - 1))
 
 /*******************************************************************************
-* struct: manager
-* purpose: manager for the circular doubly linked list and memory pool
-* @ top : points to first open and aligned byte after the last occupied block
-* @ available : total bytes available outside of blocks (from *top onward)
+* function: buddy_push, buddy_pull
+* purpose: file a free block of order k in its list and bitmap, or take it out
 *******************************************************************************/
 
-static struct
+static inline void buddy_push(struct mempool *pool, unsigned k, size_t off)
 {
-    struct block *head;
-    struct block *tail;
-    size_t available;
-    void *pool;
-    void *top;
+    struct buddy *b = pool->buddy;
+    struct buddy_node *node = (struct buddy_node*) ((char*) pool->pool + off);
+
+    node->prev = NULL;
+    node->next = b->heads[k];
+    if (node->next != NULL) node->next->prev = node;
+
+    b->heads[k] = node;
+    b->orders |= UINT64_C(1) << k;
+    BUDDY_WORD(b, k, off) |= BUDDY_MASK(k, off);
+    pool->free_bytes += (size_t) 1 << k;
 }
-manager =
-{
-    .head = NULL,
-    .tail = NULL,
-    .available = 0,
-    .pool = NULL,
-    .top = NULL
-};
 
-/*******************************************************************************
-* prototypes and general macros
-* @ ALIGNMENT : this macro cannot be modified
-* @ ALIGN_MASK : used for alignment modulus masking
-* @ ROUND_TO_ALIGN : round a value upward to the next multiple of the alignment
-* @ SIZEOF_BLOCK : sizeof(struct block) assuming 64-bit
-* @ MIN_SPLIT: minimum byte threshold required to call split_this_block()
-* @ CONTAINER_OF : access block node via pointer to first byte of user memory
-*******************************************************************************/
+static inline void buddy_pull(struct mempool *pool, unsigned k, size_t off)
+{
+    struct buddy *b = pool->buddy;
+    struct buddy_node *node = (struct buddy_node*) ((char*) pool->pool + off);
 
-#define ALIGNMENT 0x8
-#define ALIGN_MASK (ALIGNMENT - 0x1)
-#define ROUND_TO_ALIGN(value) (value += ((ALIGNMENT - (value & ALIGN_MASK)) & ALIGN_MASK))      
-#define SIZEOF_BLOCK 32
-#define MIN_SPLIT 40
-#define CONTAINER_OF(ptr) ((struct block*) ((char*) ptr - SIZEOF_BLOCK))
+    if (node->next != NULL) node->next->prev = node->prev;
+    if (node->prev != NULL) node->prev->next = node->next;
+    else b->heads[k] = node->next;
 
-static inline void insert_node_at_tail(struct block *new);
-static inline void split_this_block(struct block *block, size_t size);
-static inline void merge_next_block(struct block *block);
+    if (b->heads[k] == NULL) b->orders &= ~(UINT64_C(1) << k);
+    BUDDY_WORD(b, k, off) &= ~BUDDY_MASK(k, off);
+    pool->free_bytes -= (size_t) 1 << k;
+}
 
 /*******************************************************************************
-* function: mempool_init
-* purpose: heap-allocated initialization of memory pool
-* @ size : total byte size of pool
-* returns: true on successful initialization
+* function: buddy_alloc
+* purpose: take the smallest free block that fits and split it down to size
+* details: the orders mask finds that block in one scan. Each split files the
+* upper half as a free block one order lower, at most max - min splits.
 *******************************************************************************/
 
-bool mempool_init(size_t size)
+static void *buddy_alloc(struct mempool *pool, size_t size)
 {
-    //64 bytes of metadata + 8 bytes of user data required at a minimum
-    ROUND_TO_ALIGN(size);
-    if (size < 72) return false;
-    
-    //disallow simultaneous pools
-    if (manager.pool != NULL) return false;
-    
-    manager.pool = malloc(size);
-    if (manager.pool == NULL) return false;
-    assert((uintptr_t) manager.top % ALIGNMENT == 0 && "top unaligned");
-
-    manager.top = manager.pool;
-    manager.available = size;
-    
-    //create a permanent dummy block to reduce code needed for list operations
-    struct block *dummy = manager.top;
-    
-    manager.head = dummy;
-    manager.tail = dummy;
-    manager.available -= SIZEOF_BLOCK;
-    manager.top = dummy + 1;
-    
-    //dummy acts as both the head and tail of the circular list
-    dummy->prev = dummy;
-    dummy->next = dummy;
-    dummy->size = 0;
-    dummy->available = false;
-    
-    return true;
-}
+    struct buddy *b = pool->buddy;
 
+    if (size > pool->size) return NULL;
+    unsigned k = ORDER_FOR(b, size);
 
-/*******************************************************************************
-* function: mempool_free
-* purpose: release the memory pool and reset the pool manager
-*******************************************************************************/
+    pool->ticks++;
+    pool->searches++;
+    pool->probes++;
 
-void mempool_free(void)
-{
-    if (manager.pool == NULL) return;
+    uint64_t fit = b->orders & (~UINT64_C(0) << k);
+    if (fit == 0) return NULL;
+
+    unsigned j = (unsigned) __builtin_ctzll(fit);
+    size_t off = BUDDY_OFFSET(pool, b->heads[j]);
+    buddy_pull(pool, j, off);
 
-    free(manager.pool);
+    while (j > k)
+    {
+        j--;
+        buddy_push(pool, j, off + ((size_t) 1 << j));
+    }
 
-    manager.head = NULL;
-    manager.tail = NULL;
-    manager.available = 0;
-    manager.pool = NULL;
-    manager.top = NULL;
+    b->order_of[off >> b->min_order] = (uint8_t) k;
+
+    return (char*) pool->pool + off;
 }
 
 /*******************************************************************************
-* function: pmalloc
-* purpose: return an available memory block from the pool
-* @ size : total bytes requested
-* returns: void pointer, null if pmalloc cannot find a suitable memory block
+* function: buddy_realloc
+* purpose: resize a block of a buddy pool
+* details: shrinking stays in place and frees the upper halves it gives up, none
+* of which can merge since the lower half is still in use. Growing absorbs the
+* upper buddies in place while the block is the lower half of each pair and
+* every one is free, and otherwise moves the block through pool_malloc().
 *******************************************************************************/
 
-void *pmalloc(size_t size)
+static void *buddy_realloc(struct mempool *pool, void *ptr, size_t size, void *caller)
 {
-    if (size == 0) return NULL;
-    
-    ROUND_TO_ALIGN(size);
+    struct buddy *b = pool->buddy;
+    size_t off = BUDDY_OFFSET(pool, ptr);
+    unsigned old = b->order_of[off >> b->min_order];
 
-    //try to obtain memory from pool top, else repurpose an available block
-    if (size + SIZEOF_BLOCK <= manager.available)
+    if (size > pool->size)
     {
-        //place a new block node at top and add to tail of linked list
-        struct block *new = manager.top;
-
-        new->size = size;
-        new->available = false;
-        insert_node_at_tail(new);
+        pool->stats.failures++;
+        return NULL;
+    }
 
-        //update manager, move top a la sbrk() and note total bytes used
-        manager.available -= SIZEOF_BLOCK + size;
-        manager.top = (char*) manager.top + (SIZEOF_BLOCK + size);
+    unsigned k = ORDER_FOR(b, size);
 
-        //hide the metadata and return 32 bytes above for user to use
-        assert((uintptr_t) new % ALIGNMENT == 0 && "block not aligned");
-        assert((uintptr_t) (new + 1) % ALIGNMENT == 0 && "user not aligned");
+    if (k < old)
+    {
+        for (unsigned j = old; j > k; j--) buddy_push(pool, j - 1, off + ((size_t) 1 << (j - 1)));
 
-        return new + 1;
+        b->order_of[off >> b->min_order] = (uint8_t) k;
+        pool->stats.in_use -= ((size_t) 1 << old) - ((size_t) 1 << k);
     }
-    else
+    else if (k > old)
     {
-        struct block *block = manager.head->next;
+        pool->stats.grows++;
 
-        while (block != manager.tail)
+        unsigned j = old;
+
+        while (j < k && !(off >> j & 1))
         {
-            if (block->available && block->size >= size)
-            {
-                //split block into two if it is large enough
-                if (block->size - size >= MIN_SPLIT) split_this_block(block, size);
+            size_t upper = off + ((size_t) 1 << j);
+            if (!(BUDDY_WORD(b, j, upper) & BUDDY_MASK(j, upper))) break;
+            j++;
+        }
+
+        if (j == k)
+        {
+            for (j = old; j < k; j++) buddy_pull(pool, j, off + ((size_t) 1 << j));
 
-                block->available = false;
+            b->order_of[off >> b->min_order] = (uint8_t) k;
+            pool->stats.grows_in_place++;
+            pool->stats.in_use += ((size_t) 1 << k) - ((size_t) 1 << old);
+            if (pool->stats.in_use > pool->stats.peak) pool->stats.peak = pool->stats.in_use;
 
-                return block + 1;
-            }
-            else block = block->next;
+            return ptr;
         }
 
-        assert(block == manager.tail && "incomplete circular list walk");
+        void *new = pool_malloc(pool, size, caller);
+        if (new == NULL) return NULL;
+        memcpy(new, ptr, (size_t) 1 << old);
+        pfree_from(pool, ptr);
+
+        return new;
     }
 
-    //not enough free memory in pool to fulfill the user request
-    return NULL;
+    return ptr;
 }
 
 /*******************************************************************************
-* function: pcalloc
-* purpose: return new memory block with contents initialized to zero
-* @ n : number of array elements requested
-* @ size : byte-size of each element
-* returns: void pointer, null if pcalloc cannot find a suitable memory block
+* function: buddy_free
+* purpose: return a block and merge it with its buddy for as long as it is free
+* details: the buddy of the block at offset off of order k is at off ^ 2^k, and
+* the merged block starts at the lower of the two.
 *******************************************************************************/
 
-void *pcalloc(size_t n, size_t size)
+static void buddy_free(struct mempool *pool, void *ptr)
 {
-    //todo: check for overflow before passing bytes var and return error
-    size_t bytes = size * n;
+    struct buddy *b = pool->buddy;
+    size_t off = BUDDY_OFFSET(pool, ptr);
+    unsigned k = b->order_of[off >> b->min_order];
 
-    void *address = pmalloc(bytes);
+    assert(off < pool->size && "pointer outside of the buddy region");
+    assert(!(BUDDY_WORD(b, k, off) & BUDDY_MASK(k, off)) && "double free");
 
-    if (address == NULL) return NULL;
-    else
+    pool->ticks++;
+
+    while (k < b->max_order)
     {
-        //ignore extra bytes that pmalloc may allocate to maintain alignment
-        memset(address, 0, bytes);
-        return address;
+        size_t buddy = off ^ ((size_t) 1 << k);
+        if (!(BUDDY_WORD(b, k, buddy) & BUDDY_MASK(k, buddy))) break;
+
+        buddy_pull(pool, k, buddy);
+        off &= ~((size_t) 1 << k);
+        k++;
     }
+
+    buddy_push(pool, k, off);
 }
 
 /*******************************************************************************
-* function: prealloc
-* purpose: change the size of the memory block pointed to by ptr to size bytes
-* @ ptr : first byte of a memory block previously passed to user via pmalloc
+* function: buddy_reset
+* purpose: leave the whole region as the single free block of the top order
 *******************************************************************************/
 
-void *prealloc(void *ptr, size_t size)
+static void buddy_reset(struct mempool *pool)
 {
-    //prealloc reduces to pmalloc or pfree on degenerate arguments
-    if (ptr == NULL) return pmalloc(size);
-    
-    if (ptr != NULL && size == 0) 
+    struct buddy *b = pool->buddy;
+
+    for (unsigned k = b->min_order; k <= b->max_order; k++)
     {
-        pfree(ptr);
-        return ptr;
+        b->heads[k] = NULL;
+        memset(b->free_map[k], 0, ((((size_t) 1 << (b->max_order - k)) + 63) / 64) * sizeof(uint64_t));
     }
-    
-    ROUND_TO_ALIGN(size);
-    
-    struct block *block = CONTAINER_OF(ptr);
-    
-    if (block->size == size) 
+
+    //the size classes and top stay empty, so mempool_stats sees only buddies
+    pool->top = pool->pool;
+    pool->available = 0;
+    pool->fl_bitmap = 0;
+    b->orders = 0;
+
+    buddy_push(pool, b->max_order, 0);
+}
+
+/*******************************************************************************
+* function: usable_size
+* purpose: user bytes of the block at ptr, which is the whole block in a buddy
+* pool and everything after the header otherwise
+*******************************************************************************/
+
+static inline size_t usable_size(struct mempool *pool, void *ptr)
+{
+    if (pool->buddy != NULL)
     {
-        //new request still fits the alignment padding so do nothing
-        return ptr;
+        size_t off = BUDDY_OFFSET(pool, ptr);
+        return (size_t) 1 << pool->buddy->order_of[off >> pool->buddy->min_order];
     }
-    else if (block->size > size)
+
+    return SIZE_OF(CONTAINER_OF(ptr));
+}
+
+/*******************************************************************************
+* function: size_class
+* purpose: map a block size to its first and second level class indices
+* @ fl : first level index, which power of two range contains the size
+* @ sl : second level index, which linear subdivision of that range
+*******************************************************************************/
+
+static inline void size_class(size_t size, unsigned *fl, unsigned *sl)
+{
+    if (size < ((size_t) 1 << FL_SHIFT))
     {
-        //user requests less memory, split if possible else do nothing
-        if (block->size - size >= MIN_SPLIT) split_this_block(block, size);
-        
-        return block + 1;
+        *fl = 0;
+        *sl = (unsigned) (size >> (FL_SHIFT - SL_LOG2));
     }
     else
     {
-        //request for more memory
-        void *new = pmalloc(size);
-        if (new == NULL) return NULL;
-        memcpy(new, ptr, block->size);
-        pfree(ptr);
-        
-        return new;
+        unsigned msb = 63 - (unsigned) __builtin_clzll(size);
+        *sl = (unsigned) (size >> (msb - SL_LOG2)) ^ SL_COUNT;
+        *fl = msb - FL_SHIFT + 1;
     }
+
+    assert(*fl < FL_COUNT && *sl < SL_COUNT && "size class out of range");
 }
 
 /*******************************************************************************
-* function: pfree
-* purpose: return memory block to pool for reuse
-* @ ptr : first byte of a memory block previously passed to user via pmalloc
+* function: insert_free_block
+* purpose: push a free block onto the head of its size class list
 *******************************************************************************/
 
-void pfree(void *ptr)
+static inline void insert_free_block(struct mempool *pool, struct block *block)
 {
-    if (ptr == NULL) return;
+    unsigned fl, sl;
+    size_class(SIZE_OF(block), &fl, &sl);
 
-    struct block *block = CONTAINER_OF(ptr);
-    block->available = true;
+    size_t head = 0;
+    if (pool->sl_bitmap[fl] & (UINT32_C(1) << sl)) head = pool->classes[fl][sl];
 
-    //forward merge
-    if (block->next->available == true) 
+    LINKS_OF(block)->prev = 0;
+    LINKS_OF(block)->next = head;
+    if (head != 0) LINKS_OF(LINK_AT(pool, head))->prev = LINK_TO(pool, block);
+
+    pool->classes[fl][sl] = LINK_TO(pool, block);
+    pool->sl_bitmap[fl] |= UINT32_C(1) << sl;
+    pool->fl_bitmap |= UINT64_C(1) << fl;
+    pool->free_bytes += SIZE_OF(block);
+}
+
+/*******************************************************************************
+* function: remove_free_block
+* purpose: unlink a free block from its size class list and mark it in use
+*******************************************************************************/
+
+static inline void remove_free_block(struct mempool *pool, struct block *block)
+{
+    unsigned fl, sl;
+    size_class(SIZE_OF(block), &fl, &sl);
+
+    struct links *links = LINKS_OF(block);
+
+    if (links->next != 0) LINKS_OF(LINK_AT(pool, links->next))->prev = links->prev;
+
+    if (links->prev != 0) LINKS_OF(LINK_AT(pool, links->prev))->next = links->next;
+    else
     {
-        merge_next_block(block);
+        //block was the list head, clear the class bits when the list empties
+        pool->classes[fl][sl] = links->next;
+
+        if (links->next == 0)
+        {
+            pool->sl_bitmap[fl] &= ~(UINT32_C(1) << sl);
+            if (pool->sl_bitmap[fl] == 0) pool->fl_bitmap &= ~(UINT64_C(1) << fl);
+        }
+    }
+
+    block->head &= ~BLOCK_FREE;
+    pool->free_bytes -= SIZE_OF(block);
+}
+
+/*******************************************************************************
+* function: search_free_block
+* purpose: find a free block of at least size bytes with two bitmap scans
+* returns: head of the smallest non-empty class that fits any size request,
+* NULL if no class fits.
+* note: the size is rounded up to the next class boundary so that every block
+* in the returned class is large enough, this is a good fit rather than a best
+* fit but it never walks a list.
+*******************************************************************************/
+
+static inline struct block *search_free_block(struct mempool *pool, size_t size)
+{
+    if (size >= ((size_t) 1 << FL_SHIFT))
+    {
+        unsigned msb = 63 - (unsigned) __builtin_clzll(size);
+        size += ((size_t) 1 << (msb - SL_LOG2)) - 1;
+        if (size >> FL_MAX_LOG2) return NULL;
     }
-    
-    //backward merge (equivalent to forward merge on prev block)
-    if (block->prev->available == true)
+
+    unsigned fl, sl;
+    size_class(size, &fl, &sl);
+
+    pool->searches++;
+    pool->probes++;
+
+    //first look for a class at or above sl in the same first level
+    uint32_t sl_map = pool->sl_bitmap[fl] & (~UINT32_C(0) << sl);
+
+    if (sl_map == 0)
     {
-        block = block->prev;
-        merge_next_block(block);
+        pool->probes++;
+
+        //otherwise take the smallest non-empty class of a larger first level
+        uint64_t fl_map = fl + 1 < 64 ? pool->fl_bitmap & (~UINT64_C(0) << (fl + 1)) : 0;
+        if (fl_map == 0) return NULL;
+
+        fl = (unsigned) __builtin_ctzll(fl_map);
+        sl_map = pool->sl_bitmap[fl];
+        assert(sl_map != 0 && "first level bit set on empty second level");
     }
+
+    sl = (unsigned) __builtin_ctz(sl_map);
+
+    return LINK_AT(pool, pool->classes[fl][sl]);
 }
 
 /*******************************************************************************
-* function: insert_node_at_tail
-* purpose: place a new block node just before the list tail dummy block.
+* function: count_alloc, count_free
+* purpose: update the running counters as a block is handed out or returned
+* @ caller : return address read by the public pool function, where the profile
+*           starts the call stack of a sampled allocation
 *******************************************************************************/
 
-static inline void insert_node_at_tail(struct block *new)
+static inline void count_alloc(struct mempool *pool, void *ptr, void *caller)
+{
+    size_t size = usable_size(pool, ptr);
+
+    pool->stats.in_use += size;
+    if (pool->stats.in_use > pool->stats.peak) pool->stats.peak = pool->stats.in_use;
+
+    pool->stats.allocs++;
+    pool->stats.classes[63 - __builtin_clzll(size)]++;
+
+    if (pool->profile != NULL) profile_alloc(pool->profile, ptr, size, caller);
+}
+
+static inline void count_free(struct mempool *pool, void *ptr)
 {
-    new->prev = manager.tail->prev;
-    new->next = manager.tail;
-    manager.tail->prev->next = new;
-    manager.tail->prev = new;
-    
+    pool->stats.in_use -= usable_size(pool, ptr);
+    pool->stats.frees++;
+
+    if (pool->profile != NULL && pool->profile->samples != 0)
+    {
+        profile_free(pool->profile, ptr);
+    }
 }
 
 /*******************************************************************************
-* function: split_this_block
-* purpose: split an existing block into two new neighbor blocks
+* function: hash_word
+* purpose: fold one word into a running multiplicative hash
 *******************************************************************************/
 
-static inline void split_this_block(struct block *block, size_t size)
+static inline size_t hash_word(size_t hash, uintptr_t word)
 {
-    uintptr_t delta = (uintptr_t) block + SIZEOF_BLOCK + size;
-    struct block  *new = (struct block *) delta;
-    
-    new->prev = block;
-    new->next = block->next;
-    new->size = block->size - size - SIZEOF_BLOCK;
-    new->available = true;
-    
-    block->next->prev = new;    
-    block->next = new;
-    assert(size == block->size - SIZEOF_BLOCK - new->size && "block mismatch");
-    block->size = size;
-    
-    return;
+    hash = (hash ^ word) * (size_t) 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 29);
 }
 
+/*******************************************************************************
+* function: profile_gap
+* purpose: draw the bytes left until the next sample
+* details: the distance is exponential with mean rate, as in gperftools. It has
+* no memory, so however much of the distance is already used up, an allocation
+* of size bytes is sampled with probability 1 - exp(-size / rate).
+*******************************************************************************/
+
+static size_t profile_gap(struct profile *profile)
+{
+    profile->seed ^= profile->seed << 13;
+    profile->seed ^= profile->seed >> 7;
+    profile->seed ^= profile->seed << 17;
+
+    //53 random bits give a uniform draw in (0, 1], which keeps the log finite
+    double uniform = (double) ((profile->seed >> 11) + 1) * 0x1p-53;
+    double gap = -log(uniform) * (double) profile->rate;
+
+    if (gap >= (double) (SIZE_MAX / 2)) return SIZE_MAX / 2;
+
+    return 1 + (size_t) gap;
+}
 
 /*******************************************************************************
-* function: merge_next_block
-* purpose: merge the supplied block with its next neighbor
+* function: profile_alloc
+* purpose: count down the sampling distance and record a sample when it runs out
+* details: an allocation of size bytes is sampled with probability
+* 1 - exp(-size / rate), see profile_gap, so a sample stands for the inverse of
+* that many allocations of its size. Small blocks weigh about rate / size, and
+* the weight falls toward one as size grows past rate.
+* note: the stack is captured with backtrace() on glibc. Elsewhere only the
+* caller of the pool function is known, so every site is one frame deep.
 *******************************************************************************/
 
-static inline void merge_next_block(struct block *block)
+static void profile_alloc(struct profile *profile, void *ptr, size_t size, void *caller)
 {
-    struct block *next_block = block->next;
+    if (size < profile->countdown)
+    {
+        profile->countdown -= size;
+        return;
+    }
 
-    //swallow bytes occupied by next block and its user data
-    block->size += next_block->size + SIZEOF_BLOCK;
+    profile->countdown = profile_gap(profile);
+
+    //find the caller in the stack and drop the pool frames above it
+    void *frames[PROFILE_DEPTH + 4];
+    int first = 0;
+    int depth = 0;
+
+    #ifdef __GLIBC__
+    depth = backtrace(frames, PROFILE_DEPTH + 4);
+    while (first < depth && frames[first] != caller) first++;
+    #endif
+
+    if (first >= depth)
+    {
+        frames[0] = caller;
+        first = 0;
+        depth = 1;
+    }
+
+    if (depth - first > PROFILE_DEPTH) depth = first + PROFILE_DEPTH;
+
+    size_t hash = 0;
+    for (int i = first; i < depth; i++) hash = hash_word(hash, (uintptr_t) frames[i]);
+    if (hash == 0) hash = 1;
+
+    //sites are never removed, so a probe stops at the first free slot
+    size_t slot = hash & (PROFILE_SITES - 1);
+    struct site *site = &profile->sites[slot];
+
+    while (site->hash != 0)
+    {
+        bool same = site->hash == hash && site->depth == (size_t) (depth - first);
+        if (same) same = memcmp(site->frames, frames + first, site->depth * sizeof(void*)) == 0;
+        if (same) break;
+
+        slot = (slot + 1) & (PROFILE_SITES - 1);
+        site = &profile->sites[slot];
+    }
+
+    if (site->hash == 0)
+    {
+        if (PROFILE_FULL(profile->sites_used, PROFILE_SITES))
+        {
+            profile->dropped++;
+            return;
+        }
+
+        site->hash = hash;
+        site->depth = (size_t) (depth - first);
+        memcpy(site->frames, frames + first, site->depth * sizeof(void*));
+        profile->sites_used++;
+    }
+
+    //expm1 keeps the probability accurate for blocks far smaller than rate
+    double objects = -1.0 / expm1(-(double) size / (double) profile->rate);
+    double bytes = objects * (double) size;
+
+    site->alloc_objects += objects;
+    site->alloc_bytes += bytes;
+
+    //the live figures only count once pfree can find the block again
+    if (PROFILE_FULL(profile->samples, PROFILE_LIVE))
+    {
+        profile->dropped++;
+        return;
+    }
+
+    site->live_objects += objects;
+    site->live_bytes += bytes;
+
+    size_t i = hash_word(0, (uintptr_t) ptr) & (PROFILE_LIVE - 1);
+    while (profile->live[i].ptr != NULL) i = (i + 1) & (PROFILE_LIVE - 1);
+
+    profile->live[i] = (struct sample) {ptr, slot, objects, bytes};
+    profile->samples++;
+}
+
+/*******************************************************************************
+* function: profile_free
+* purpose: retire the estimate of a sampled block as it is freed
+* details: linear probing with backward shift deletion, so the table never
+* fills up with tombstones. Unsampled blocks miss at the first empty slot.
+*******************************************************************************/
+
+static void profile_free(struct profile *profile, void *ptr)
+{
+    size_t mask = PROFILE_LIVE - 1;
+    size_t i = hash_word(0, (uintptr_t) ptr) & mask;
+
+    while (profile->live[i].ptr != ptr)
+    {
+        if (profile->live[i].ptr == NULL) return;
+        i = (i + 1) & mask;
+    }
+
+    struct sample *sample = &profile->live[i];
+    profile->sites[sample->site].live_objects -= sample->objects;
+    profile->sites[sample->site].live_bytes -= sample->bytes;
+    profile->samples--;
+
+    //pull back any later entry of the run whose home slot is at or before i
+    for (size_t j = (i + 1) & mask; profile->live[j].ptr != NULL; j = (j + 1) & mask)
+    {
+        size_t home = hash_word(0, (uintptr_t) profile->live[j].ptr) & mask;
+
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            profile->live[i] = profile->live[j];
+            i = j;
+        }
+    }
+
+    profile->live[i].ptr = NULL;
+}
+
+/*******************************************************************************
+* function: profile_clear
+* purpose: forget every sampled block at once, as after a pool reset
+*******************************************************************************/
+
+static void profile_clear(struct profile *profile)
+{
+    for (size_t i = 0; i < PROFILE_SITES; i++)
+    {
+        profile->sites[i].live_objects = 0.0;
+        profile->sites[i].live_bytes = 0.0;
+    }
 
-    //connect our block and one over, or make it as the new tail
-    block->next = next_block->next;
-    next_block->next->prev = block;
+    memset(profile->live, 0, sizeof(profile->live));
+    profile->samples = 0;
 }
 
 /*******************************************************************************
@@ -350,14 +2362,12 @@ static inline void merge_next_block(struct block *block)
 * @ words : number of words (x64) to display from pool head onwards
 *******************************************************************************/
 
-#define memmap_manager()                                                       \
+#define memmap_manager(pool)                                                   \
         do                                                                     \
         {                                                                      \
-            printf("\nHead: 0x%p\n", (void*) manager.head);                    \
-            printf("Tail: 0x%p\n", (void*) manager.tail);                      \
-            printf("Pool: 0x%p\n", (void*) manager.pool);                      \
-            printf("Top:  0x%p\n", (void*) manager.top);                       \
-            printf("Available: %llu\n", manager.available);                    \
+            printf("\nPool: 0x%p\n", (void*) pool->pool);                        \
+            printf("Top:  0x%p\n", (void*) pool->top);                         \
+            printf("Available: %zu\n", pool->available);                       \
         }                                                                      \
         while (0)                                                              \
 
@@ -371,48 +2381,63 @@ static inline void merge_next_block(struct block *block)
         } while(0)                                                             \
 
 
-//an address in the memory pool can have 6 different interpretations,
-//4 of which relate to the struct block members
-#define BLOCK_PREV_FMT "0x%p      [B] prev        0x%p       \n"
-#define BLOCK_NEXT_FMT "0x%p      [B] next        0x%p       \n"
-#define BLOCK_SIZE_FMT "0x%p      [B] size        %llu       \n"
-#define BLOCK_FLAG_FMT "0x%p      [B] flag        %d         \n"
+//an address in the memory pool can have 4 different interpretations,
+//1 of which relates to the struct block header and 1 to the boundary tag
+#define BLOCK_HEAD_FMT "0x%p      [B] size|flag   %zu | %d %d %d \n"
+#define BLOCK_TAGS_FMT "0x%p      [T] size        %zu       \n"
 #define BLOCK_USER_FMT "0x%p      [U]             "
 #define BLOCK_NONE_FMT "0x%p      [N]                        \n"
 
-void memmap(size_t words)
+void memmap_from(struct mempool *pool, size_t words)
 {
     //display memory map header
-    memmap_manager();
+    memmap_manager(pool);
+
+    //buddy blocks have no headers to walk, so list the free blocks per order
+    if (pool->buddy != NULL)
+    {
+        printf("\n%8s %12s %12s\n", "order", "block size", "free blocks");
+
+        for (unsigned k = pool->buddy->min_order; k <= pool->buddy->max_order; k++)
+        {
+            size_t count = 0;
+            for (struct buddy_node *n = pool->buddy->heads[k]; n != NULL; n = n->next) count++;
+            printf("%8u %12zu %12zu\n", k, (size_t) 1 << k, count);
+        }
+
+        return;
+    }
+
     memmap_header();
 
-    uintptr_t curr = (uintptr_t) manager.pool;
-    uintptr_t end = (uintptr_t) manager.pool + (words - 1) * 8;
+    uintptr_t curr = (uintptr_t) pool->pool;
+    uintptr_t end = (uintptr_t) pool->pool + (words - 1) * 8;
 
-    struct block *block = manager.head;
+    struct block *block = (struct block*) ((char*) pool->pool + region_lead(pool->pool, pool->align));
 
     while (curr <= end)
     {
-        if (curr == (uintptr_t) block)
+        if (curr == (uintptr_t) block && (void*) block != pool->top)
         {
-            //curr is at block node so an unrolled loop prints next 4 words
-            printf(BLOCK_PREV_FMT, (void*) curr, (void*) block->prev);
-            curr += 8;
-
-            printf(BLOCK_NEXT_FMT, (void*) curr, (void*) block->next);
-            curr += 8;
-
-            printf(BLOCK_SIZE_FMT, (void*) curr, block->size);
-            curr += 8;
-
-            printf(BLOCK_FLAG_FMT, (void*) curr, block->available);
+            //curr is at block node so print the size and the 3 flags
+            printf(BLOCK_HEAD_FMT, (void*) curr, SIZE_OF(block),
+                   (block->head & BLOCK_FREE) != 0,
+                   (block->head & BLOCK_PREV_FREE) != 0,
+                   (block->head & BLOCK_PREV_SMALL) != 0);
             curr += 8;
 
             //and then print the remaining user blocks using char values
-            size_t user_words = block->size/8;
+            size_t user_words = SIZE_OF(block)/8;
 
             for (size_t i = 0; i < user_words; ++i)
             {
+                if ((block->head & BLOCK_FREE) && SIZE_OF(block) > MIN_USER && i == user_words - 1)
+                {
+                    printf(BLOCK_TAGS_FMT, (void*) curr, *TAG_OF(block));
+                    curr += 8;
+                    continue;
+                }
+
                 printf(BLOCK_USER_FMT, (void*) curr);
 
                 char *byte = (char*) curr;
@@ -434,7 +2459,7 @@ void memmap(size_t words)
 
             printf("\n");
 
-            block = block->next;
+            block = NEXT_BLOCK(block);
         }
         else
         {
@@ -447,31 +2472,9 @@ void memmap(size_t words)
     return;
 }
 
-/******************************************************************************/
-//just some basic testing and debugging. todo: write unit tests in Unity
-
-int main(void)
-{
-    mempool_init(112);
-    
-    char *x = pcalloc(48, 1);
-    
-    char *y = prealloc(x, 8);
-    
-    y[0] = 'Z';
-    
-    char *z = pmalloc(3);
-    
-    z[2] = 'Y';
-    
-    pfree(z);
-    pfree(y);
-    
-    char *w = pcalloc(16, 1);
-    
-    w[15] = '9';
-    
-    memmap(14);
+void memmap(size_t words)
+{
+    if (manager == NULL) return;
 
-    return 0;
-}
\ No newline at end of file
+    memmap_from(manager, words);
+}
@@ -1,7 +1,9 @@
 /*
 * Author: Biren Patel
-* Description: Memory Pool API. The user must call mempool_init() before using
-* the dynamic allocation functions.
+* Description: Memory Pool API. Each pool is an independent struct mempool that
+* is created with mempool_create() and accessed via the *_from functions. The
+* original global API remains as a thin wrapper over one default pool, so the
+* user must still call mempool_init() before using those functions.
 */
 
 #ifndef MEMPOOL_H
@@ -9,24 +11,130 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
 /******************************************************************************/
-//constructors
+//opaque handle, pools share no state so one pool per thread needs no locking
+
+struct mempool;
+
+/******************************************************************************/
+//handle constructors, mempool_reset releases every block in O(1)
+
+struct mempool *mempool_create(size_t size);
+void mempool_destroy(struct mempool *pool);
+void mempool_reset(struct mempool *pool);
+
+/******************************************************************************/
+//growable pools map their region and, once full, map chunks of at least chunk
+//bytes on demand. A chunk that stays entirely free for idle pool operations has
+//its pages handed back to the OS, and mempool_reset unmaps every chunk.
+
+#define MEMPOOL_HUGEPAGE 0x1
+
+struct mempool *mempool_create_growable(size_t size, size_t chunk, size_t idle, unsigned flags);
+
+/******************************************************************************/
+//buddy pools serve every request from a power-of-two block, size rounds up to
+//one, carved from a region of 2^k bytes. Blocks carry no header and are aligned
+//to their own size up to the page size, so 4096 bytes take exactly one page.
+//Split and merge are O(log n) and a freed block always recombines with its
+//free buddy, so power-of-two traffic never fragments the region.
+
+struct mempool *mempool_create_buddy(size_t size, size_t min_block, unsigned flags);
+
+/******************************************************************************/
+//file pools map the manager and region from a file, so blocks written in one
+//run are there in the next with no load step. The free lists link by offset and
+//survive any new mapping address, but user pointers do not: store offsets from
+//the handle inside the pool, and keep the entry point as the root. POSIX only.
+
+#define MEMPOOL_OFFSET(pool, ptr) \
+    ((ptr) == NULL ? (size_t) 0 : (size_t) ((char*) (ptr) - (char*) (pool)))
+
+#define MEMPOOL_POINTER(pool, offset) \
+    ((offset) == 0 ? NULL : (void*) ((char*) (pool) + (offset)))
+
+struct mempool *mempool_open(const char *path, size_t size);
+bool mempool_sync(struct mempool *pool);
+void mempool_set_root(struct mempool *pool, void *ptr);
+void *mempool_root(struct mempool *pool);
+
+/******************************************************************************/
+//handle dynamic allocation functions
+
+void *pmalloc_from(struct mempool *pool, size_t size);
+void *pcalloc_from(struct mempool *pool, size_t n, size_t size);
+void *prealloc_from(struct mempool *pool, void *ptr, size_t size);
+void pfree_from(struct mempool *pool, void *ptr);
+
+/******************************************************************************/
+//aligned allocation, alignment is any power of two. A pool-wide alignment of at
+//least 8 applies to every block, set it right after creation or a reset. A
+//block from pmemalign loses its extra alignment if prealloc has to move it.
+
+void *pmemalign_from(struct mempool *pool, size_t alignment, size_t size);
+bool mempool_set_alignment(struct mempool *pool, size_t alignment);
+
+/******************************************************************************/
+//always-on pool counters. Byte figures count user memory only, headers aside.
+//available is every byte a pmalloc could still be served from without growing,
+//largest is the biggest single block among them, and fragmentation is 1 minus
+//their ratio. search_length is the mean number of bitmap probes per free list
+//search. classes[i] counts allocations of 2^i to 2^(i+1) - 1 user bytes.
+//grows counts prealloc calls that needed a larger block, and grows_in_place
+//those among them that were served without moving the block.
+
+#define MEMPOOL_STAT_CLASSES 40
+
+struct mempool_stats
+{
+    size_t in_use;
+    size_t peak;
+    size_t available;
+    size_t largest;
+    double fragmentation;
+    size_t allocs;
+    size_t frees;
+    size_t failures;
+    double search_length;
+    size_t grows;
+    size_t grows_in_place;
+    size_t classes[MEMPOOL_STAT_CLASSES];
+};
+
+void mempool_stats(struct mempool *pool, struct mempool_stats *stats);
+
+/******************************************************************************/
+//sampled allocation-site profile, off until started. About one allocation per
+//rate bytes records its call stack, and both dumps scale the samples back up to
+//estimates of all traffic. print writes a histogram of sites ordered by bytes
+//in use, write saves a legacy heap profile that pprof can symbolize.
+
+bool mempool_profile_start(struct mempool *pool, size_t rate);
+void mempool_profile_stop(struct mempool *pool);
+void mempool_profile_print(struct mempool *pool, FILE *stream);
+bool mempool_profile_write(struct mempool *pool, const char *path);
+
+/******************************************************************************/
+//global constructors over the default pool
 
 bool mempool_init(size_t size);
 void mempool_free(void);
 
 /******************************************************************************/
-//dynamic allocation functions 
+//global dynamic allocation functions over the default pool
 
 void *pmalloc(size_t size);
 void *pcalloc(size_t n, size_t size);
 void *prealloc(void *ptr, size_t size);
 void pfree(void *ptr);
+void *pmemalign(size_t alignment, size_t size);
 
 /******************************************************************************/
-//stdout debugger, show pool memory map of first n words
+//stdout debugger, show pool memory map of first n words of the initial region
 
+void memmap_from(struct mempool *pool, size_t words);
 void memmap(size_t words);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,527 @@
+/*
+* Author: Biren Patel
+* Description: Replay driver for allocation traces recorded by trace.c. A trace
+* is loaded into memory and replayed twice against one allocator, first as fast
+* as possible for throughput and then with a timer around every operation for
+* the latency distribution. Each new block has one byte written per page so that
+* the peak resident set reflects the footprint of the allocator. Run one
+* allocator per process, since the peak resident set is process wide.
+*
+* usage: replay.exe <trace file> malloc | pool | buddy | slab | tpool
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "mempool.h"
+#include "slab.h"
+#include "tpool.h"
+#include "trace.h"
+
+/*******************************************************************************
+* replay parameters
+* @ POOL_SIZE : initial region and chunk size of the growable pool
+* @ POOL_IDLE : pool operations before an idle chunk is purged
+* @ BUDDY_SIZE : region of the buddy pool, mapped but only touched as used
+* @ BUDDY_MIN : smallest block of the buddy pool
+* @ TPOOL_SIZE : central pool of the thread-caching pool
+* @ TOUCH_STRIDE : one byte is written every TOUCH_STRIDE bytes of a new block
+*******************************************************************************/
+
+#define POOL_SIZE (64 * 1024 * 1024)
+#define POOL_IDLE 65536
+#define BUDDY_SIZE ((size_t) 1024 * 1024 * 1024)
+#define BUDDY_MIN 64
+#define TPOOL_SIZE (256 * 1024 * 1024)
+#define TOUCH_STRIDE 4096
+
+/*******************************************************************************
+* struct: backend
+* purpose: one allocator under test, size and alignment of the block are passed
+* back on realloc and free for the allocators that do not store them
+*******************************************************************************/
+
+struct backend
+{
+    const char *name;
+    bool (*setup)(void);
+    void (*teardown)(void);
+    void *(*alloc)(size_t size);
+    void *(*zalloc)(size_t size);
+    void *(*align)(size_t alignment, size_t size);
+    void *(*resize)(void *ptr, size_t old, size_t alignment, size_t size);
+    void (*release)(void *ptr, size_t size, size_t alignment);
+};
+
+/*******************************************************************************
+glibc malloc
+*/
+
+static bool libc_setup(void) { return true; }
+static void libc_teardown(void) {}
+static void *libc_alloc(size_t size) { return malloc(size); }
+static void *libc_zalloc(size_t size) { return calloc(1, size); }
+static void *libc_resize(void *ptr, size_t old, size_t alignment, size_t size)
+{
+    (void) old;
+    (void) alignment;
+    return realloc(ptr, size);
+}
+
+static void *libc_align(size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+
+    //aligned_alloc wants a multiple of the alignment in C11, so round up
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
+static void libc_release(void *ptr, size_t size, size_t alignment)
+{
+    (void) size;
+    (void) alignment;
+    free(ptr);
+}
+
+/*******************************************************************************
+mempool in its default segregated fit mode, growable so traces of any size fit,
+and in buddy mode over a fixed region
+*/
+
+static struct mempool *pool;
+
+static bool pool_setup(void)
+{
+    pool = mempool_create_growable(POOL_SIZE, POOL_SIZE, POOL_IDLE, 0);
+    return pool != NULL;
+}
+
+static bool buddy_setup(void)
+{
+    pool = mempool_create_buddy(BUDDY_SIZE, BUDDY_MIN, 0);
+    return pool != NULL;
+}
+
+static void pool_teardown(void) { mempool_destroy(pool); }
+static void *pool_alloc(size_t size) { return pmalloc_from(pool, size); }
+static void *pool_zalloc(size_t size) { return pcalloc_from(pool, 1, size); }
+static void *pool_align(size_t alignment, size_t size) { return pmemalign_from(pool, alignment, size); }
+static void *pool_resize(void *ptr, size_t old, size_t alignment, size_t size)
+{
+    (void) old;
+    (void) alignment;
+    return prealloc_from(pool, ptr, size);
+}
+
+static void pool_release(void *ptr, size_t size, size_t alignment)
+{
+    (void) size;
+    (void) alignment;
+    pfree_from(pool, ptr);
+}
+
+/*******************************************************************************
+slab caches in the style of jemalloc small size classes, four classes for every
+doubling, with malloc behind them for large and over-aligned requests
+*/
+
+static const size_t slab_sizes[] = {16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448};
+
+#define SLAB_CLASSES (sizeof(slab_sizes) / sizeof(slab_sizes[0]))
+#define SLAB_MAX 448
+#define SLAB_ALIGN 16
+
+static struct slab *slabs[SLAB_CLASSES];
+static unsigned char slab_class[SLAB_MAX / 16 + 1];
+
+static bool slab_setup(void)
+{
+    unsigned c = 0;
+
+    for (size_t i = 0; i <= SLAB_MAX / 16; i++)
+    {
+        while (slab_sizes[c] < i * 16) c++;
+        slab_class[i] = (unsigned char) c;
+    }
+
+    for (size_t i = 0; i < SLAB_CLASSES; i++)
+    {
+        slabs[i] = slab_create(slab_sizes[i]);
+        if (slabs[i] == NULL) return false;
+    }
+
+    return true;
+}
+
+static void slab_teardown(void)
+{
+    for (size_t i = 0; i < SLAB_CLASSES; i++) slab_destroy(slabs[i]);
+}
+
+static bool slab_fits(size_t size, size_t alignment)
+{
+    return size <= SLAB_MAX && alignment <= SLAB_ALIGN;
+}
+
+static void *slab_alloc_any(size_t size)
+{
+    if (!slab_fits(size, 0)) return malloc(size);
+    return slab_alloc(slabs[slab_class[(size + 15) / 16]]);
+}
+
+static void *slab_zalloc(size_t size)
+{
+    void *ptr = slab_alloc_any(size);
+    if (ptr != NULL) memset(ptr, 0, size);
+    return ptr;
+}
+
+static void *slab_align(size_t alignment, size_t size)
+{
+    if (slab_fits(size, alignment)) return slab_alloc_any(size);
+    return libc_align(alignment, size);
+}
+
+static void slab_release(void *ptr, size_t size, size_t alignment)
+{
+    if (!slab_fits(size, alignment)) free(ptr);
+    else slab_free(slabs[slab_class[(size + 15) / 16]], ptr);
+}
+
+static void *slab_resize(void *ptr, size_t old, size_t alignment, size_t size)
+{
+    bool in_slab = slab_fits(old, alignment);
+
+    if (!in_slab && !slab_fits(size, 0)) return realloc(ptr, size);
+
+    //a block that stays in its class needs no move
+    if (in_slab && slab_fits(size, 0))
+    {
+        if (slab_class[(old + 15) / 16] == slab_class[(size + 15) / 16]) return ptr;
+    }
+
+    void *new = slab_alloc_any(size);
+    if (new == NULL) return NULL;
+
+    memcpy(new, ptr, old < size ? old : size);
+    slab_release(ptr, old, alignment);
+
+    return new;
+}
+
+/*******************************************************************************
+thread-caching pool driven from a single thread, so every call hits its cache
+*/
+
+static struct tpool *tp;
+
+static bool tpool_setup(void)
+{
+    tp = tpool_create(TPOOL_SIZE);
+    return tp != NULL;
+}
+
+static void tpool_teardown(void) { tpool_destroy(tp); }
+static void *tpool_alloc(size_t size) { return tmalloc(tp, size); }
+static void *tpool_zalloc(size_t size) { return tcalloc(tp, 1, size); }
+static void *tpool_resize(void *ptr, size_t old, size_t alignment, size_t size)
+{
+    (void) old;
+    (void) alignment;
+    return trealloc(tp, ptr, size);
+}
+
+static void *tpool_align(size_t alignment, size_t size)
+{
+    //the 8-byte prefix of a tmalloc block leaves it only 8-byte aligned, so
+    //larger alignments count as failures
+    return alignment <= 8 ? tmalloc(tp, size) : NULL;
+}
+
+static void tpool_release(void *ptr, size_t size, size_t alignment)
+{
+    (void) size;
+    (void) alignment;
+    tfree(tp, ptr);
+}
+
+/******************************************************************************/
+
+static const struct backend backends[] =
+{
+    {"malloc", libc_setup, libc_teardown, libc_alloc, libc_zalloc, libc_align, libc_resize, libc_release},
+    {"pool", pool_setup, pool_teardown, pool_alloc, pool_zalloc, pool_align, pool_resize, pool_release},
+    {"buddy", buddy_setup, pool_teardown, pool_alloc, pool_zalloc, pool_align, pool_resize, pool_release},
+    {"slab", slab_setup, slab_teardown, slab_alloc_any, slab_zalloc, slab_align, slab_resize, slab_release},
+    {"tpool", tpool_setup, tpool_teardown, tpool_alloc, tpool_zalloc, tpool_align, tpool_resize, tpool_release},
+};
+
+/*******************************************************************************
+* struct: replay
+* purpose: a loaded trace and the per-object state of one replay pass
+* @ records : every record of the trace
+* @ count : total records
+* @ objects : one past the largest object id
+* @ ptr : current block of each object, null if not live
+* @ size : requested size of each live object
+* @ align : requested alignment of each live object, 0 unless memaligned
+* @ latency : nanoseconds of each operation in the timed pass
+* @ failures : allocations that returned null
+*******************************************************************************/
+
+struct replay
+{
+    struct trace_record *records;
+    size_t count;
+    size_t objects;
+    char **ptr;
+    uint32_t *size;
+    uint32_t *align;
+    uint32_t *latency;
+    size_t failures;
+};
+
+/*******************************************************************************
+* function: load
+* purpose: read a whole trace file and size the object tables
+* returns: false if the file is missing, truncated, or not a trace
+*******************************************************************************/
+
+static bool load(struct replay *r, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    char magic[8];
+    bool ok = fread(magic, 1, 8, file) == 8 && memcmp(magic, TRACE_MAGIC, 8) == 0;
+
+    fseek(file, 0, SEEK_END);
+    long bytes = ftell(file) - 8;
+    fseek(file, 8, SEEK_SET);
+
+    ok = ok && bytes >= 0 && bytes % (long) sizeof(struct trace_record) == 0;
+    r->count = ok ? (size_t) bytes / sizeof(struct trace_record) : 0;
+    r->records = malloc(r->count * sizeof(struct trace_record) + 1);
+
+    ok = ok && r->records != NULL;
+    ok = ok && fread(r->records, sizeof(struct trace_record), r->count, file) == r->count;
+    fclose(file);
+
+    if (!ok) return false;
+
+    r->objects = 1;
+
+    for (size_t i = 0; i < r->count; i++)
+    {
+        if (r->records[i].id >= r->objects) r->objects = (size_t) r->records[i].id + 1;
+    }
+
+    //touched up front so that the tables count toward the baseline resident set
+    r->ptr = calloc(r->objects, sizeof(char*));
+    r->size = calloc(r->objects, sizeof(uint32_t));
+    r->align = calloc(r->objects, sizeof(uint32_t));
+    r->latency = calloc(r->count + 1, sizeof(uint32_t));
+
+    if (!r->ptr || !r->size || !r->align || !r->latency) return false;
+
+    memset(r->ptr, 0, r->objects * sizeof(char*));
+    memset(r->size, 0, r->objects * sizeof(uint32_t));
+    memset(r->align, 0, r->objects * sizeof(uint32_t));
+    memset(r->latency, 0, r->count * sizeof(uint32_t));
+
+    return true;
+}
+
+/*******************************************************************************
+* function: step
+* purpose: perform one record against the backend
+*******************************************************************************/
+
+static inline void step(struct replay *r, const struct backend *b, const struct trace_record *rec)
+{
+    uint32_t id = rec->id;
+    size_t size = rec->size;
+    char *ptr = NULL;
+
+    switch (TRACE_OP(rec))
+    {
+        case TRACE_MALLOC:
+            ptr = b->alloc(size);
+            break;
+
+        case TRACE_CALLOC:
+            ptr = b->zalloc(size);
+            break;
+
+        case TRACE_MEMALIGN:
+            ptr = b->align((size_t) 1 << TRACE_ALIGN(rec), size);
+            if (ptr != NULL) r->align[id] = (uint32_t) 1 << TRACE_ALIGN(rec);
+            break;
+
+        case TRACE_REALLOC:
+            if (r->ptr[id] == NULL) ptr = b->alloc(size);
+            else ptr = b->resize(r->ptr[id], r->size[id], r->align[id], size);
+
+            //a failed resize leaves the old block as it was, a moved block
+            //only keeps the default alignment
+            if (ptr != NULL) r->align[id] = 0;
+            break;
+
+        case TRACE_FREE:
+            if (r->ptr[id] != NULL) b->release(r->ptr[id], r->size[id], r->align[id]);
+            r->ptr[id] = NULL;
+            r->align[id] = 0;
+            return;
+    }
+
+    if (ptr == NULL)
+    {
+        r->failures++;
+        return;
+    }
+
+    r->ptr[id] = ptr;
+    r->size[id] = (uint32_t) size;
+}
+
+/*******************************************************************************
+* function: touch
+* purpose: write one byte per page of a block the last record handed out
+*******************************************************************************/
+
+static inline void touch(struct replay *r, const struct trace_record *rec)
+{
+    if (TRACE_OP(rec) == TRACE_FREE || r->ptr[rec->id] == NULL) return;
+
+    char *ptr = r->ptr[rec->id];
+    for (size_t j = 0; j < r->size[rec->id]; j += TOUCH_STRIDE) ptr[j] = 1;
+}
+
+/*******************************************************************************
+* function: run
+* purpose: one full pass over the trace, latencies are only taken if timed
+* returns: wall clock seconds of the pass
+*******************************************************************************/
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+static double run(struct replay *r, const struct backend *b, bool timed)
+{
+    double start = now();
+
+    for (size_t i = 0; i < r->count; i++)
+    {
+        const struct trace_record *rec = &r->records[i];
+
+        if (timed)
+        {
+            struct timespec t0, t1;
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            step(r, b, rec);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+
+            int64_t ns = (int64_t) (t1.tv_sec - t0.tv_sec) * 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+            r->latency[i] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t) ns;
+        }
+        else step(r, b, rec);
+
+        touch(r, rec);
+    }
+
+    double elapsed = now() - start;
+
+    //objects the traced program never freed
+    for (size_t id = 0; id < r->objects; id++)
+    {
+        if (r->ptr[id] != NULL) b->release(r->ptr[id], r->size[id], r->align[id]);
+        r->ptr[id] = NULL;
+        r->align[id] = 0;
+    }
+
+    return elapsed;
+}
+
+/******************************************************************************/
+
+static int by_value(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t*) a;
+    uint32_t y = *(const uint32_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+static long peak_rss_kib(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    const struct backend *b = NULL;
+    size_t total = sizeof(backends) / sizeof(backends[0]);
+
+    for (size_t i = 0; argc == 3 && i < total; i++)
+    {
+        if (strcmp(argv[2], backends[i].name) == 0) b = &backends[i];
+    }
+
+    if (b == NULL)
+    {
+        fprintf(stderr, "usage: %s <trace file> malloc | pool | buddy | slab | tpool\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct replay r = {0};
+
+    if (!load(&r, argv[1]))
+    {
+        fprintf(stderr, "cannot load trace %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    long baseline = peak_rss_kib();
+
+    if (!b->setup())
+    {
+        fprintf(stderr, "%s setup failed\n", b->name);
+        return EXIT_FAILURE;
+    }
+
+    double elapsed = run(&r, b, false);
+    r.failures = 0;
+    run(&r, b, true);
+    b->teardown();
+
+    qsort(r.latency, r.count, sizeof(uint32_t), by_value);
+
+    size_t last = r.count ? r.count - 1 : 0;
+    double span = r.count ? 1e-6 * (double) TRACE_NANOS(&r.records[last]) : 0.0;
+
+    printf("trace: %s, %zu records, %zu objects, %.1f ms recorded\n", argv[1], r.count, r.objects - 1, span);
+    printf("allocator: %s\n", b->name);
+    printf("throughput: %.2f Mops/s\n", elapsed > 0.0 ? 1e-6 * (double) r.count / elapsed : 0.0);
+    printf("latency ns: p50 %u, p99 %u, p99.9 %u, max %u\n", r.latency[last / 2],
+           r.latency[last * 99 / 100], r.latency[last * 999 / 1000], r.latency[last]);
+    printf("peak rss: %ld KiB, %ld KiB over the loaded trace\n", peak_rss_kib(), peak_rss_kib() - baseline);
+    printf("failures: %zu\n", r.failures);
+
+    return EXIT_SUCCESS;
+}
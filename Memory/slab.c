@@ -0,0 +1,450 @@
+/*
+* Author: Biren Patel
+* Description: Slab allocator implementation. Each slab is one page aligned to
+* its own size, with a header at the start of the page and the objects packed
+* after it. Free objects are threaded into an intrusive list inside the slab,
+* so the owning slab of any object is found by masking its address. Slabs move
+* between partial and full lists, and empty slabs go back to the system, or to
+* the allocator the cache was created with.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "slab.h"
+#include "allocator.h"
+
+/*******************************************************************************
+* general macros
+* @ SLAB_SIZE : byte-size and alignment of each slab, must be a power of two
+* @ SLAB_MASK : used to recover the slab header from an object address
+* @ SLAB_SPARE : total empty slabs kept by a cache before releasing to system
+* @ OBJ_ALIGN : objects are rounded to and aligned on this boundary
+* @ SLAB_OF : access slab header via pointer to any object inside the slab
+*******************************************************************************/
+
+#define SLAB_SIZE 4096
+#define SLAB_MASK ((uintptr_t) SLAB_SIZE - 1)
+#define SLAB_SPARE 1
+#define OBJ_ALIGN 8
+#define SLAB_OF(obj) ((struct slab_page*) ((uintptr_t) (obj) & ~SLAB_MASK))
+
+/*******************************************************************************
+* platform page allocation, C99 has no aligned allocator. Caches created with an
+* allocator ask it for aligned pages first, see page_alloc() and page_free().
+*******************************************************************************/
+
+#ifdef _WIN32
+    #include <malloc.h>
+    #define PAGE_ALLOC(ptr) ((*(ptr) = _aligned_malloc(SLAB_SIZE, SLAB_SIZE)) != NULL)
+    #define PAGE_FREE(ptr) _aligned_free(ptr)
+#else
+    #define PAGE_ALLOC(ptr) (posix_memalign((ptr), SLAB_SIZE, SLAB_SIZE) == 0)
+    #define PAGE_FREE(ptr) free(ptr)
+#endif
+
+/*******************************************************************************
+* struct: slab_page
+* purpose: header at the start of every slab
+* @ cache : owning cache, rewritten when slab_absorb() moves the slab
+* @ prev : previous slab in the partial or full list of the cache
+* @ next : next slab in the partial or full list of the cache
+* @ free : head of the intrusive list of freed objects
+* @ unused : first object that has never been handed out, carved lazily
+* @ inuse : total objects currently handed out from this slab
+* @ platform : true if the slab came from the platform, not the allocator
+*******************************************************************************/
+
+struct slab_page
+{
+    struct slab *cache;
+    struct slab_page *prev;
+    struct slab_page *next;
+    void *free;
+    char *unused;
+    size_t inuse;
+    bool platform;
+};
+
+/*******************************************************************************
+* struct: slab
+* purpose: cache of slabs that all hold objects of the same size
+* @ size : byte-size of each object, rounded up to OBJ_ALIGN
+* @ capacity : total objects per slab
+* @ offset : byte offset of the first object from the start of the slab
+* @ partial : slabs with at least one object available
+* @ full : slabs with every object handed out
+* @ spare : empty slabs kept around to avoid thrashing at a slab boundary
+* @ spares : total slabs in the spare list
+* @ alloc : allocator of the cache and its slabs, null for the C library
+*******************************************************************************/
+
+struct slab
+{
+    size_t size;
+    size_t capacity;
+    size_t offset;
+    struct slab_page *partial;
+    struct slab_page *full;
+    struct slab_page *spare;
+    size_t spares;
+    const struct allocator *alloc;
+};
+
+static inline void list_push(struct slab_page **list, struct slab_page *page);
+static inline void list_unlink(struct slab_page **list, struct slab_page *page);
+static void list_release(struct slab *cache, struct slab_page *page);
+static struct slab_page *slab_grow(struct slab *cache);
+static inline struct slab_page *page_alloc(struct slab *cache);
+static inline void page_free(struct slab *cache, struct slab_page *page);
+
+/*******************************************************************************
+* function: slab_create
+* purpose: heap-allocated initialization of an empty slab cache
+* @ size : byte-size of each object
+* returns: cache handle, null if malloc fails or size cannot fit in a slab
+*******************************************************************************/
+
+struct slab *slab_create(size_t size)
+{
+    return slab_create_with(size, NULL);
+}
+
+/*******************************************************************************
+* function: slab_create_with
+* purpose: slab cache whose handle and slabs come from an allocator
+* @ alloc : allocator of the handle and slabs, or null for the C library. A
+*          slab the allocator cannot align to SLAB_SIZE, such as one from the
+*          slab adapter, comes from the platform instead.
+* returns: cache handle, null if allocation fails or size cannot fit in a slab
+*******************************************************************************/
+
+struct slab *slab_create_with(size_t size, const struct allocator *alloc)
+{
+    //free objects must be able to hold the intrusive list pointer
+    if (size < sizeof(void*)) size = sizeof(void*);
+    size = (size + OBJ_ALIGN - 1) & ~((size_t) OBJ_ALIGN - 1);
+
+    size_t offset = (sizeof(struct slab_page) + OBJ_ALIGN - 1) & ~((size_t) OBJ_ALIGN - 1);
+
+    //insist on at least 8 objects per slab, else a slab is the wrong tool
+    if (size > (SLAB_SIZE - offset) / 8) return NULL;
+
+    struct slab *cache = ALLOCATOR_ALLOC(alloc, sizeof(struct slab));
+    if (cache == NULL) return NULL;
+
+    cache->size = size;
+    cache->capacity = (SLAB_SIZE - offset) / size;
+    cache->offset = offset;
+    cache->partial = NULL;
+    cache->full = NULL;
+    cache->spare = NULL;
+    cache->spares = 0;
+    cache->alloc = alloc;
+
+    return cache;
+}
+
+/*******************************************************************************
+* function: slab_destroy
+* purpose: release every slab and the cache, all objects become dangling
+*******************************************************************************/
+
+void slab_destroy(struct slab *cache)
+{
+    if (cache == NULL) return;
+
+    list_release(cache, cache->partial);
+    list_release(cache, cache->full);
+    list_release(cache, cache->spare);
+
+    ALLOCATOR_RELEASE(cache->alloc, cache, sizeof(struct slab));
+}
+
+/*******************************************************************************
+* function: slab_size
+* purpose: byte-size of each object of the cache, after rounding
+*******************************************************************************/
+
+size_t slab_size(const struct slab *cache)
+{
+    assert(cache != NULL && "cache is null");
+
+    return cache->size;
+}
+
+/*******************************************************************************
+* function: slab_alloc
+* purpose: return one object from the first partial slab, growing if needed
+* returns: void pointer, null if a new slab could not be allocated
+*******************************************************************************/
+
+void *slab_alloc(struct slab *cache)
+{
+    assert(cache != NULL && "cache is null");
+
+    struct slab_page *page = cache->partial;
+
+    if (page == NULL)
+    {
+        page = slab_grow(cache);
+        if (page == NULL) return NULL;
+    }
+
+    //reuse the most recently freed object while it is still warm in cache
+    void *obj = page->free;
+
+    if (obj != NULL) page->free = *(void**) obj;
+    else
+    {
+        obj = page->unused;
+        page->unused += cache->size;
+    }
+
+    //move the slab to the full list once the last object is handed out
+    if (++page->inuse == cache->capacity)
+    {
+        list_unlink(&cache->partial, page);
+        list_push(&cache->full, page);
+    }
+
+    return obj;
+}
+
+/*******************************************************************************
+* function: slab_free
+* purpose: return an object to its slab, releasing the slab once it is empty
+* @ obj : object previously returned by slab_alloc on this cache, or NULL
+*******************************************************************************/
+
+void slab_free(struct slab *cache, void *obj)
+{
+    if (obj == NULL) return;
+
+    struct slab_page *page = SLAB_OF(obj);
+    assert(page->cache == cache && "object belongs to another cache");
+
+    *(void**) obj = page->free;
+    page->free = obj;
+
+    if (page->inuse-- == cache->capacity)
+    {
+        list_unlink(&cache->full, page);
+        list_push(&cache->partial, page);
+    }
+
+    if (page->inuse == 0)
+    {
+        list_unlink(&cache->partial, page);
+
+        if (cache->spares < SLAB_SPARE)
+        {
+            list_push(&cache->spare, page);
+            cache->spares++;
+        }
+        else page_free(cache, page);
+    }
+}
+
+/*******************************************************************************
+* function: slab_alloc_bulk
+* purpose: fill objs with up to n objects, draining one slab at a time
+* returns: total objects allocated, less than n only if malloc fails
+*******************************************************************************/
+
+size_t slab_alloc_bulk(struct slab *cache, void **objs, size_t n)
+{
+    assert(cache != NULL && "cache is null");
+
+    size_t total = 0;
+
+    while (total < n)
+    {
+        struct slab_page *page = cache->partial;
+
+        if (page == NULL)
+        {
+            page = slab_grow(cache);
+            if (page == NULL) break;
+        }
+
+        //take everything the slab can give before touching the lists again
+        while (total < n && page->inuse < cache->capacity)
+        {
+            void *obj = page->free;
+
+            if (obj != NULL) page->free = *(void**) obj;
+            else
+            {
+                obj = page->unused;
+                page->unused += cache->size;
+            }
+
+            page->inuse++;
+            objs[total++] = obj;
+        }
+
+        if (page->inuse == cache->capacity)
+        {
+            list_unlink(&cache->partial, page);
+            list_push(&cache->full, page);
+        }
+    }
+
+    return total;
+}
+
+/*******************************************************************************
+* function: slab_free_bulk
+* purpose: return n objects to their slabs
+*******************************************************************************/
+
+void slab_free_bulk(struct slab *cache, void **objs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        slab_free(cache, objs[i]);
+    }
+}
+
+/*******************************************************************************
+* function: slab_absorb
+* purpose: move every slab of src into dest, src is left empty but usable
+* note: both caches must hold objects of the same size from the same allocator
+*******************************************************************************/
+
+void slab_absorb(struct slab *dest, struct slab *src)
+{
+    assert(dest != NULL && src != NULL && "cache is null");
+    assert(dest->size == src->size && "caches hold different object sizes");
+    assert(dest->alloc == src->alloc && "caches use different allocators");
+
+    if (dest == src) return;
+
+    struct slab_page **lists[] = {&src->partial, &src->full, &src->spare};
+    struct slab_page **into[] = {&dest->partial, &dest->full, &dest->spare};
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        while (*lists[i] != NULL)
+        {
+            struct slab_page *page = *lists[i];
+
+            list_unlink(lists[i], page);
+            page->cache = dest;
+            list_push(into[i], page);
+        }
+    }
+
+    dest->spares += src->spares;
+    src->spares = 0;
+}
+
+/*******************************************************************************
+* function: slab_grow
+* purpose: place a spare or brand new slab on the partial list
+* returns: the slab, null if the system is out of memory
+*******************************************************************************/
+
+static struct slab_page *slab_grow(struct slab *cache)
+{
+    struct slab_page *page = cache->spare;
+
+    if (page != NULL)
+    {
+        list_unlink(&cache->spare, page);
+        cache->spares--;
+    }
+    else
+    {
+        page = page_alloc(cache);
+        if (page == NULL) return NULL;
+
+        page->cache = cache;
+        page->free = NULL;
+        page->unused = (char*) page + cache->offset;
+        page->inuse = 0;
+    }
+
+    assert(page->inuse == 0 && "spare slab is not empty");
+
+    list_push(&cache->partial, page);
+
+    return page;
+}
+
+/*******************************************************************************
+* function: list_push
+* purpose: place a slab at the head of a cache list
+*******************************************************************************/
+
+static inline void list_push(struct slab_page **list, struct slab_page *page)
+{
+    page->prev = NULL;
+    page->next = *list;
+
+    if (*list != NULL) (*list)->prev = page;
+
+    *list = page;
+}
+
+/*******************************************************************************
+* function: list_unlink
+* purpose: remove a slab from anywhere in a cache list
+*******************************************************************************/
+
+static inline void list_unlink(struct slab_page **list, struct slab_page *page)
+{
+    if (page->prev != NULL) page->prev->next = page->next;
+    else *list = page->next;
+
+    if (page->next != NULL) page->next->prev = page->prev;
+}
+
+/*******************************************************************************
+* function: list_release
+* purpose: hand every slab of a cache list back to the system
+*******************************************************************************/
+
+static void list_release(struct slab *cache, struct slab_page *page)
+{
+    while (page != NULL)
+    {
+        struct slab_page *next = page->next;
+        page_free(cache, page);
+        page = next;
+    }
+}
+
+/*******************************************************************************
+* function: page_alloc, page_free
+* purpose: one slab of SLAB_SIZE bytes aligned to SLAB_SIZE, from the allocator
+* of the cache if it has one and can align it, else from the platform
+*******************************************************************************/
+
+static inline struct slab_page *page_alloc(struct slab *cache)
+{
+    void *raw = NULL;
+
+    if (cache->alloc != NULL) raw = ALLOCATOR_ALIGNED(cache->alloc, SLAB_SIZE, SLAB_SIZE);
+
+    //an allocator may serve some slabs and not others, so each one records
+    //where it has to go back to
+    bool platform = raw == NULL;
+    if (platform && !PAGE_ALLOC(&raw)) return NULL;
+
+    struct slab_page *page = raw;
+    page->platform = platform;
+
+    return page;
+}
+
+static inline void page_free(struct slab *cache, struct slab_page *page)
+{
+    if (page->platform) PAGE_FREE(page);
+    else ALLOCATOR_RELEASE(cache->alloc, page, SLAB_SIZE);
+}
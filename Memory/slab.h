@@ -0,0 +1,50 @@
+/*
+* Author: Biren Patel
+* Description: Slab allocator API for fixed-size objects. A slab cache carves
+* objects of one size out of page-sized slabs, so node-heavy containers pay no
+* per-object header and keep their nodes packed together in memory.
+*/
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+/******************************************************************************/
+//opaque cache handle, one cache per object type and per container instance
+
+struct slab;
+
+/******************************************************************************/
+//constructors, slab_destroy releases every object in the cache at once
+
+struct slab *slab_create(size_t size);
+void slab_destroy(struct slab *cache);
+
+/******************************************************************************/
+//the same cache with its handle and slabs from an allocator, see allocator.h.
+//slab_size is the object size after rounding up to 8 bytes.
+
+struct allocator;
+
+struct slab *slab_create_with(size_t size, const struct allocator *alloc);
+size_t slab_size(const struct slab *cache);
+
+/******************************************************************************/
+//single object allocation functions, slab_alloc returns NULL on malloc failure
+
+void *slab_alloc(struct slab *cache);
+void slab_free(struct slab *cache, void *obj);
+
+/******************************************************************************/
+//bulk allocation functions, slab_alloc_bulk returns the objects placed in objs
+
+size_t slab_alloc_bulk(struct slab *cache, void **objs, size_t n);
+void slab_free_bulk(struct slab *cache, void **objs, size_t n);
+
+/******************************************************************************/
+//move every slab from src into dest, used when containers splice their nodes
+
+void slab_absorb(struct slab *dest, struct slab *src);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+* Author: Biren Patel
+* Description: Multithreaded alloc/free benchmark for the thread-caching pool.
+* Every thread replays its own small-block trace, and a fraction of the blocks
+* are swapped through a shared mailbox so that they are freed by a different
+* thread than the one that allocated them. The same workload is also run on a
+* plain mempool behind one global mutex to show what the thread caches buy.
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mempool.h"
+#include "tpool.h"
+
+/*******************************************************************************
+* benchmark parameters
+* @ POOL_SIZE : bytes given to the central pool of each run
+* @ OPS_PER_THREAD : alloc and free operations replayed by each thread
+* @ LIVE_SLOTS : maximum simultaneously live allocations per thread
+* @ MAILBOX_SLOTS : shared slots used to hand blocks to other threads
+* @ REMOTE_ODDS : one in REMOTE_ODDS frees is routed through the mailbox
+* @ MAX_THREADS : largest thread count measured
+*******************************************************************************/
+
+#define POOL_SIZE (256 * 1024 * 1024)
+#define OPS_PER_THREAD 1000000
+#define LIVE_SLOTS 256
+#define MAILBOX_SLOTS 1024
+#define REMOTE_ODDS 16
+#define MAX_THREADS 64
+
+/*******************************************************************************
+Both allocators are driven through the same pair of function pointers.
+*/
+
+struct backend
+{
+    void *(*alloc)(void *ctx, size_t size);
+    void (*release)(void *ctx, void *ptr);
+    void *ctx;
+};
+
+static void *tpool_alloc(void *ctx, size_t size) { return tmalloc(ctx, size); }
+static void tpool_release(void *ctx, void *ptr) { tfree(ctx, ptr); }
+
+struct locked_pool
+{
+    pthread_mutex_t lock;
+    struct mempool *pool;
+};
+
+static void *locked_alloc(void *ctx, size_t size)
+{
+    struct locked_pool *lp = ctx;
+    pthread_mutex_lock(&lp->lock);
+    void *ptr = pmalloc_from(lp->pool, size);
+    pthread_mutex_unlock(&lp->lock);
+    return ptr;
+}
+
+static void locked_release(void *ctx, void *ptr)
+{
+    struct locked_pool *lp = ctx;
+    pthread_mutex_lock(&lp->lock);
+    pfree_from(lp->pool, ptr);
+    pthread_mutex_unlock(&lp->lock);
+}
+
+/*******************************************************************************
+xorshift64 per thread, seeded by thread id so every run replays the same trace.
+*/
+
+static _Atomic(void*) mailbox[MAILBOX_SLOTS];
+static atomic_size_t failures;
+
+struct worker
+{
+    pthread_t thread;
+    struct backend *a;
+    uint64_t state;
+};
+
+static uint64_t trace_next(struct worker *w)
+{
+    w->state ^= w->state << 13;
+    w->state ^= w->state >> 7;
+    w->state ^= w->state << 17;
+    return w->state;
+}
+
+static void *worker_run(void *arg)
+{
+    struct worker *w = arg;
+    struct backend *a = w->a;
+    void *live[LIVE_SLOTS] = {0};
+
+    for (size_t op = 0; op < OPS_PER_THREAD; op++)
+    {
+        uint64_t dice = trace_next(w);
+        size_t i = dice % LIVE_SLOTS;
+
+        if (live[i] == NULL)
+        {
+            size_t size = (dice >> 32) % 100 == 0 ? 1024 + (dice >> 40) % 3072 : 8 + (dice >> 40) % 248;
+            live[i] = a->alloc(a->ctx, size);
+            if (live[i] == NULL) atomic_fetch_add(&failures, 1);
+        }
+        else if ((dice >> 16) % REMOTE_ODDS == 0)
+        {
+            //swap into the mailbox, whatever was there came from another thread
+            void *old = atomic_exchange(&mailbox[(dice >> 24) % MAILBOX_SLOTS], live[i]);
+            if (old != NULL) a->release(a->ctx, old);
+            live[i] = NULL;
+        }
+        else
+        {
+            a->release(a->ctx, live[i]);
+            live[i] = NULL;
+        }
+    }
+
+    for (size_t i = 0; i < LIVE_SLOTS; i++) a->release(a->ctx, live[i]);
+
+    return NULL;
+}
+
+/*******************************************************************************
+Wall clock time of one run at a given thread count, including thread startup.
+*/
+
+static double run(struct backend *a, int threads)
+{
+    static struct worker workers[MAX_THREADS];
+    struct timespec start, end;
+
+    timespec_get(&start, TIME_UTC);
+
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].a = a;
+        workers[t].state = 0x9E3779B97F4A7C15ULL * (uint64_t) (t + 1);
+        pthread_create(&workers[t].thread, NULL, worker_run, &workers[t]);
+    }
+
+    for (int t = 0; t < threads; t++) pthread_join(workers[t].thread, NULL);
+
+    timespec_get(&end, TIME_UTC);
+
+    for (size_t i = 0; i < MAILBOX_SLOTS; i++)
+    {
+        a->release(a->ctx, atomic_exchange(&mailbox[i], NULL));
+    }
+
+    return (double) (end.tv_sec - start.tv_sec) + 1e-9 * (double) (end.tv_nsec - start.tv_nsec);
+}
+
+/******************************************************************************/
+
+int main(void)
+{
+    printf("%8s %16s %16s\n", "threads", "tpool Mops/s", "mutex Mops/s");
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2)
+    {
+        struct tpool *tp = tpool_create(POOL_SIZE);
+        struct locked_pool lp = {.pool = mempool_create(POOL_SIZE)};
+
+        if (tp == NULL || lp.pool == NULL)
+        {
+            fprintf(stderr, "pool creation failed\n");
+            return EXIT_FAILURE;
+        }
+
+        pthread_mutex_init(&lp.lock, NULL);
+
+        struct backend cached = {tpool_alloc, tpool_release, tp};
+        struct backend locked = {locked_alloc, locked_release, &lp};
+
+        double ops = (double) threads * OPS_PER_THREAD;
+        double tpool_time = run(&cached, threads);
+        double mutex_time = run(&locked, threads);
+
+        printf("%8d %16.2f %16.2f\n", threads, ops / tpool_time / 1e6, ops / mutex_time / 1e6);
+
+        pthread_mutex_destroy(&lp.lock);
+        mempool_destroy(lp.pool);
+        tpool_destroy(tp);
+    }
+
+    printf("\nfailures: %zu\n", (size_t) atomic_load(&failures));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,495 @@
+/*
+* Author: Biren Patel
+* Description: Thread-caching front end over struct mempool. Each thread cache
+* is found through a pthread key and holds one free list per small size class.
+* Every block handed out carries an 8-byte prefix just before the user memory
+* which names its owning cache and size class, so tfree() can tell in O(1)
+* whether a block goes back on a local list or onto the return list of another
+* thread. Return lists are lock-free stacks drained by their owner on a miss.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "mempool.h"
+#include "tpool.h"
+
+/*******************************************************************************
+* general macros
+* @ TC_STEP : byte granularity of the small size classes
+* @ TC_CLASSES : total small size classes, the largest is TC_STEP * TC_CLASSES
+* @ TC_SMALL : largest request served from a thread cache
+* @ TC_REFILL : blocks fetched from the central pool per cache miss
+* @ TC_LIMIT : blocks a class may hold before half are returned to the pool
+* @ TC_TAG_BITS : low bits of a block prefix that hold the class tag
+* @ TC_ALIGN : alignment of struct tcache, frees the tag bits of its address
+* @ TC_LARGE : class tag of blocks served straight from the central pool
+* @ TC_MASK : extracts the class tag from a block prefix
+* @ SIZEOF_PREFIX : byte-size of the owner and class word before user memory
+* @ PREFIX_OF : access the prefix word via pointer to user memory
+* @ NEXT_OF : free list link, stored in the user memory of a cached block
+*******************************************************************************/
+
+#define TC_STEP 16
+#define TC_CLASSES 32
+#define TC_SMALL (TC_STEP * TC_CLASSES)
+#define TC_REFILL 16
+#define TC_LIMIT 64
+#define TC_TAG_BITS 6
+#define TC_ALIGN (1 << TC_TAG_BITS)
+#define TC_LARGE 63
+#define TC_MASK ((uintptr_t) TC_ALIGN - 1)
+#define SIZEOF_PREFIX (sizeof(uintptr_t))
+#define PREFIX_OF(ptr) (((uintptr_t*) (ptr))[-1])
+#define NEXT_OF(ptr) (*(void**) (ptr))
+
+#define CLASS_OF(size) ((size) == 0 ? 0 : ((size) - 1) / TC_STEP)
+#define CLASS_SIZE(c) (((size_t) (c) + 1) * TC_STEP)
+
+/*******************************************************************************
+* platform aligned allocation for the thread caches
+*******************************************************************************/
+
+#ifdef _WIN32
+    #include <malloc.h>
+    #define CACHE_ALLOC(ptr) ((*(ptr) = _aligned_malloc(sizeof(struct tcache), TC_ALIGN)) != NULL)
+    #define CACHE_FREE(ptr) _aligned_free(ptr)
+#else
+    #define CACHE_ALLOC(ptr) (posix_memalign((void**) (ptr), TC_ALIGN, sizeof(struct tcache)) == 0)
+    #define CACHE_FREE(ptr) free(ptr)
+#endif
+
+/*******************************************************************************
+* struct: tcache
+* purpose: per-thread cache of small blocks, one per thread per tpool
+* @ remote : lock-free stack of blocks freed by other threads, on its own line
+* @ bins : free list and length of each size class, touched only by the owner
+* @ pool : tpool that the cache belongs to
+* @ next : next cache in the registry of the tpool, guarded by the tpool lock
+* @ abandoned : owner thread has exited and the cache may be adopted
+*******************************************************************************/
+
+struct bin
+{
+    void *head;
+    size_t count;
+};
+
+struct tcache
+{
+    _Alignas(TC_ALIGN) _Atomic(void*) remote;
+    _Alignas(TC_ALIGN) struct bin bins[TC_CLASSES];
+    struct tpool *pool;
+    struct tcache *next;
+    bool abandoned;
+};
+
+/*******************************************************************************
+* struct: tpool
+* @ lock : guards the central pool and the cache registry
+* @ key : thread-specific pointer to the calling thread cache
+* @ central : backing memory pool shared by all threads
+* @ caches : registry of every cache ever created, live or abandoned
+*******************************************************************************/
+
+struct tpool
+{
+    pthread_mutex_t lock;
+    pthread_key_t key;
+    struct mempool *central;
+    struct tcache *caches;
+};
+
+static struct tcache *tcache_attach(struct tpool *pool);
+static void tcache_detach(void *arg);
+static void tcache_drain(struct tcache *cache);
+static bool tcache_refill(struct tcache *cache, unsigned c);
+static void tcache_release(struct tcache *cache, unsigned c, size_t n);
+static void *tmalloc_large(struct tpool *pool, size_t size);
+
+/******************************************************************************/
+
+struct tpool *tpool_create(size_t size)
+{
+    struct tpool *pool = malloc(sizeof(struct tpool));
+    if (pool == NULL) return NULL;
+
+    pool->central = mempool_create(size);
+    if (pool->central == NULL) goto central_fail;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) goto lock_fail;
+    if (pthread_key_create(&pool->key, tcache_detach) != 0) goto key_fail;
+
+    pool->caches = NULL;
+
+    return pool;
+
+    key_fail:
+        pthread_mutex_destroy(&pool->lock);
+    lock_fail:
+        mempool_destroy(pool->central);
+    central_fail:
+        free(pool);
+        return NULL;
+}
+
+/******************************************************************************/
+
+void tpool_destroy(struct tpool *pool)
+{
+    //deleting the key first stops any exit destructor from touching the pool
+    pthread_key_delete(pool->key);
+
+    struct tcache *curr = pool->caches;
+
+    while (curr != NULL)
+    {
+        struct tcache *next = curr->next;
+        CACHE_FREE(curr);
+        curr = next;
+    }
+
+    mempool_destroy(pool->central);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+/*******************************************************************************
+* function: tmalloc
+* purpose: pop a block from the calling thread cache, refill it on a miss
+*******************************************************************************/
+
+void *tmalloc(struct tpool *pool, size_t size)
+{
+    if (size > TC_SMALL) return tmalloc_large(pool, size);
+
+    struct tcache *cache = pthread_getspecific(pool->key);
+
+    if (cache == NULL)
+    {
+        cache = tcache_attach(pool);
+        if (cache == NULL) return NULL;
+    }
+
+    unsigned c = CLASS_OF(size);
+    struct bin *bin = &cache->bins[c];
+
+    if (bin->head == NULL && !tcache_refill(cache, c)) return NULL;
+
+    void *ptr = bin->head;
+    bin->head = NEXT_OF(ptr);
+    bin->count--;
+
+    return ptr;
+}
+
+/******************************************************************************/
+
+void *tcalloc(struct tpool *pool, size_t n, size_t size)
+{
+    if (size != 0 && n > SIZE_MAX / size) return NULL;
+
+    void *ptr = tmalloc(pool, n * size);
+    if (ptr != NULL) memset(ptr, 0, n * size);
+
+    return ptr;
+}
+
+/*******************************************************************************
+* function: trealloc
+* purpose: resize a block, small blocks stay put while the class still fits
+* note: unlike prealloc, a zero size frees the block and returns null
+*******************************************************************************/
+
+void *trealloc(struct tpool *pool, void *ptr, size_t size)
+{
+    if (ptr == NULL) return tmalloc(pool, size);
+
+    if (size == 0)
+    {
+        tfree(pool, ptr);
+        return NULL;
+    }
+
+    uintptr_t prefix = PREFIX_OF(ptr);
+    unsigned tag = prefix & TC_MASK;
+    size_t usable;
+
+    if (tag != TC_LARGE)
+    {
+        usable = CLASS_SIZE(tag);
+        if (size <= usable && CLASS_OF(size) == tag) return ptr;
+    }
+    else
+    {
+        usable = prefix >> TC_TAG_BITS;
+
+        //large to large resizes in place inside the central pool when possible
+        if (size > TC_SMALL && size <= SIZE_MAX - SIZEOF_PREFIX && size <= (UINTPTR_MAX >> TC_TAG_BITS))
+        {
+            pthread_mutex_lock(&pool->lock);
+            uintptr_t *base = prealloc_from(pool->central, &PREFIX_OF(ptr), size + SIZEOF_PREFIX);
+            pthread_mutex_unlock(&pool->lock);
+
+            if (base == NULL) return NULL;
+
+            base[0] = ((uintptr_t) size << TC_TAG_BITS) | TC_LARGE;
+            return base + 1;
+        }
+    }
+
+    void *new = tmalloc(pool, size);
+    if (new == NULL) return NULL;
+
+    memcpy(new, ptr, usable < size ? usable : size);
+    tfree(pool, ptr);
+
+    return new;
+}
+
+/*******************************************************************************
+* function: tfree
+* purpose: push a block onto its owner cache, locally or via the return list
+*******************************************************************************/
+
+void tfree(struct tpool *pool, void *ptr)
+{
+    if (ptr == NULL) return;
+
+    uintptr_t prefix = PREFIX_OF(ptr);
+    unsigned tag = prefix & TC_MASK;
+
+    if (tag == TC_LARGE)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pfree_from(pool->central, &PREFIX_OF(ptr));
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+
+    struct tcache *owner = (struct tcache*) (prefix & ~TC_MASK);
+
+    if (owner == pthread_getspecific(pool->key))
+    {
+        struct bin *bin = &owner->bins[tag];
+
+        NEXT_OF(ptr) = bin->head;
+        bin->head = ptr;
+
+        if (++bin->count > TC_LIMIT) tcache_release(owner, tag, TC_LIMIT / 2);
+    }
+    else
+    {
+        //release pairs with the acquire exchange in tcache_drain()
+        void *head = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+
+        do NEXT_OF(ptr) = head;
+        while (!atomic_compare_exchange_weak_explicit(&owner->remote, &head, ptr,
+                memory_order_release, memory_order_relaxed));
+    }
+}
+
+/******************************************************************************/
+
+void tpool_flush(struct tpool *pool)
+{
+    struct tcache *cache = pthread_getspecific(pool->key);
+    if (cache == NULL) return;
+
+    tcache_drain(cache);
+
+    for (unsigned c = 0; c < TC_CLASSES; c++)
+    {
+        tcache_release(cache, c, cache->bins[c].count);
+    }
+}
+
+/*******************************************************************************
+* function: tcache_attach
+* purpose: give the calling thread a cache, adopting an abandoned one if any
+* details: an abandoned cache may still be the owner of live blocks and of
+* blocks sitting on its return list, so recycling it keeps those reachable.
+*******************************************************************************/
+
+static struct tcache *tcache_attach(struct tpool *pool)
+{
+    struct tcache *cache;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (cache = pool->caches; cache != NULL; cache = cache->next)
+    {
+        if (cache->abandoned) break;
+    }
+
+    if (cache != NULL) cache->abandoned = false;
+    else if (CACHE_ALLOC(&cache))
+    {
+        atomic_init(&cache->remote, NULL);
+
+        for (unsigned c = 0; c < TC_CLASSES; c++)
+        {
+            cache->bins[c].head = NULL;
+            cache->bins[c].count = 0;
+        }
+
+        cache->pool = pool;
+        cache->abandoned = false;
+        cache->next = pool->caches;
+        pool->caches = cache;
+    }
+    else cache = NULL;
+
+    pthread_mutex_unlock(&pool->lock);
+
+    if (cache != NULL && pthread_setspecific(pool->key, cache) != 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        cache->abandoned = true;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    return cache;
+}
+
+/*******************************************************************************
+* function: tcache_detach
+* purpose: pthread key destructor, flush the cache and mark it for adoption
+*******************************************************************************/
+
+static void tcache_detach(void *arg)
+{
+    struct tcache *cache = arg;
+    struct tpool *pool = cache->pool;
+
+    tcache_drain(cache);
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (unsigned c = 0; c < TC_CLASSES; c++)
+    {
+        while (cache->bins[c].head != NULL)
+        {
+            void *ptr = cache->bins[c].head;
+            cache->bins[c].head = NEXT_OF(ptr);
+            pfree_from(pool->central, &PREFIX_OF(ptr));
+        }
+
+        cache->bins[c].count = 0;
+    }
+
+    cache->abandoned = true;
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*******************************************************************************
+* function: tcache_drain
+* purpose: take the whole return list in one exchange and sort it into bins
+*******************************************************************************/
+
+static void tcache_drain(struct tcache *cache)
+{
+    void *ptr = atomic_exchange_explicit(&cache->remote, NULL, memory_order_acquire);
+
+    while (ptr != NULL)
+    {
+        void *next = NEXT_OF(ptr);
+        struct bin *bin = &cache->bins[PREFIX_OF(ptr) & TC_MASK];
+
+        NEXT_OF(ptr) = bin->head;
+        bin->head = ptr;
+        bin->count++;
+
+        ptr = next;
+    }
+}
+
+/*******************************************************************************
+* function: tcache_refill
+* purpose: on a miss, first reclaim remote frees and only then lock the pool
+* returns: true if the class now has at least one block
+*******************************************************************************/
+
+static bool tcache_refill(struct tcache *cache, unsigned c)
+{
+    struct bin *bin = &cache->bins[c];
+
+    tcache_drain(cache);
+    if (bin->head != NULL) return true;
+
+    struct tpool *pool = cache->pool;
+    uintptr_t prefix = (uintptr_t) cache | c;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (unsigned i = 0; i < TC_REFILL; i++)
+    {
+        uintptr_t *base = pmalloc_from(pool->central, CLASS_SIZE(c) + SIZEOF_PREFIX);
+        if (base == NULL) break;
+
+        base[0] = prefix;
+        NEXT_OF(base + 1) = bin->head;
+        bin->head = base + 1;
+        bin->count++;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return bin->head != NULL;
+}
+
+/*******************************************************************************
+* function: tcache_release
+* purpose: return up to n blocks of class c to the central pool under one lock
+*******************************************************************************/
+
+static void tcache_release(struct tcache *cache, unsigned c, size_t n)
+{
+    struct bin *bin = &cache->bins[c];
+    struct tpool *pool = cache->pool;
+
+    if (n == 0) return;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (n-- > 0 && bin->head != NULL)
+    {
+        void *ptr = bin->head;
+        bin->head = NEXT_OF(ptr);
+        bin->count--;
+        pfree_from(pool->central, &PREFIX_OF(ptr));
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*******************************************************************************
+* function: tmalloc_large
+* purpose: serve a request above TC_SMALL straight from the central pool
+* details: the prefix records the request size in place of an owner, which
+* lets trealloc() copy the right number of bytes.
+*******************************************************************************/
+
+static void *tmalloc_large(struct tpool *pool, size_t size)
+{
+    if (size > SIZE_MAX - SIZEOF_PREFIX || size > (UINTPTR_MAX >> TC_TAG_BITS)) return NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    uintptr_t *base = pmalloc_from(pool->central, size + SIZEOF_PREFIX);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (base == NULL) return NULL;
+
+    base[0] = ((uintptr_t) size << TC_TAG_BITS) | TC_LARGE;
+
+    return base + 1;
+}
@@ -0,0 +1,64 @@
+/*
+* Author: Biren Patel
+* Description: Thread-safe front end for the memory pool. A tpool wraps one
+* central struct mempool behind a mutex, and every thread that allocates from
+* the tpool gets its own cache of small blocks sorted by size class. Allocation
+* and free on the owning thread never touch the lock, and blocks freed by any
+* other thread are pushed onto a lock-free return list owned by the cache they
+* came from. The central pool is only locked on a cache miss or overflow.
+*
+* note: requires C11 atomics and POSIX threads, see the makefile
+*/
+
+#ifndef TPOOL_H
+#define TPOOL_H
+
+#include <stddef.h>
+
+/******************************************************************************/
+//opaque handle, safe to share between any number of threads
+
+struct tpool;
+
+/*******************************************************************************
+* function: tpool_create
+* purpose: heap-allocated initialization of a thread-safe pool
+* @ size : total bytes of the central memory pool
+* returns: pool handle, null on failure
+*******************************************************************************/
+
+struct tpool *tpool_create(size_t size);
+
+/*******************************************************************************
+* function: tpool_destroy
+* purpose: release the central pool and every thread cache at once
+* note: no thread may use the pool during or after this call
+*******************************************************************************/
+
+void tpool_destroy(struct tpool *pool);
+
+/*******************************************************************************
+* function: tmalloc, tcalloc, trealloc, tfree
+* purpose: thread-safe counterparts of pmalloc, pcalloc, prealloc and pfree
+* note: a block may be freed or reallocated by any thread, not just its owner
+* note: returned pointers are only 8-byte aligned, not aligned like malloc. Each
+* block starts with an 8-byte owner and class prefix, so user memory sits 8
+* bytes past a pool-aligned address. Types needing more, such as long double or
+* SSE vectors, must be placed in a block at an offset the caller aligns.
+*******************************************************************************/
+
+void *tmalloc(struct tpool *pool, size_t size);
+void *tcalloc(struct tpool *pool, size_t n, size_t size);
+void *trealloc(struct tpool *pool, void *ptr, size_t size);
+void tfree(struct tpool *pool, void *ptr);
+
+/*******************************************************************************
+* function: tpool_flush
+* purpose: return every block held by the calling thread cache to the central
+* pool. Caches are flushed automatically on thread exit, this is for a thread
+* that is about to go idle for a long time.
+*******************************************************************************/
+
+void tpool_flush(struct tpool *pool);
+
+#endif
@@ -0,0 +1,319 @@
+/*
+* Author: Biren Patel
+* Description: Allocation trace recorder implementation. Live pointers map to
+* object ids through a fixed open addressing table, and records are batched in
+* a static buffer that is written out with write(2). Nothing here calls malloc,
+* and a spinlock serializes recording threads.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/*******************************************************************************
+* recorder parameters
+* @ TABLE_SIZE : capacity of the pointer to id table, a power of two
+* @ TABLE_FULL : new objects are dropped past 3/4 occupancy of the table
+* @ BUFFER_RECORDS : records batched before each write
+*******************************************************************************/
+
+#define TABLE_SIZE (1 << 20)
+#define TABLE_FULL (TABLE_SIZE / 4 * 3)
+#define BUFFER_RECORDS 4096
+
+/*******************************************************************************
+* struct: entry
+* purpose: live pointer and its object id, a null ptr marks an unused slot
+*******************************************************************************/
+
+struct entry
+{
+    void *ptr;
+    uint32_t id;
+};
+
+/*******************************************************************************
+* variable: recorder
+* purpose: state of the single trace being recorded
+* @ fd : trace file descriptor, -1 while not recording
+* @ lock : spinlock taken around every table and buffer update
+* @ origin : clock reading at trace_start()
+* @ next_id : id given to the next new object
+* @ live : occupied slots of the table
+* @ count : records waiting in the buffer
+*******************************************************************************/
+
+static struct
+{
+    int fd;
+    volatile int lock;
+    struct timespec origin;
+    uint32_t next_id;
+    size_t live;
+    size_t count;
+    struct trace_record buffer[BUFFER_RECORDS];
+    struct entry table[TABLE_SIZE];
+} recorder = {.fd = -1};
+
+/*******************************************************************************
+* function: lock, unlock
+* purpose: spinlock on the GCC builtins, a mutex could allocate on first use
+*******************************************************************************/
+
+static inline void lock(void)
+{
+    while (__sync_lock_test_and_set(&recorder.lock, 1)) continue;
+}
+
+static inline void unlock(void)
+{
+    __sync_lock_release(&recorder.lock);
+}
+
+/*******************************************************************************
+* function: flush
+* purpose: write every buffered record, retrying on partial writes
+*******************************************************************************/
+
+static void flush(void)
+{
+    const char *bytes = (const char*) recorder.buffer;
+    size_t left = recorder.count * sizeof(struct trace_record);
+
+    while (left > 0)
+    {
+        ssize_t n = write(recorder.fd, bytes, left);
+        if (n <= 0) break;
+
+        bytes += n;
+        left -= (size_t) n;
+    }
+
+    recorder.count = 0;
+}
+
+/*******************************************************************************
+* function: append
+* purpose: buffer one record stamped with the time since trace_start()
+*******************************************************************************/
+
+static void append(unsigned op, unsigned align, uint32_t id, size_t size)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t nanos = (uint64_t) (now.tv_sec - recorder.origin.tv_sec) * 1000000000u
+                   + (uint64_t) now.tv_nsec - (uint64_t) recorder.origin.tv_nsec;
+
+    struct trace_record *record = &recorder.buffer[recorder.count++];
+
+    record->stamp = nanos << 8 | (uint64_t) align << 3 | op;
+    record->id = id;
+    record->size = size > UINT32_MAX ? UINT32_MAX : (uint32_t) size;
+
+    if (recorder.count == BUFFER_RECORDS) flush();
+}
+
+/*******************************************************************************
+* function: slot_of
+* purpose: home slot of a pointer in the table
+*******************************************************************************/
+
+static inline size_t slot_of(void *ptr)
+{
+    uint64_t h = (uint64_t) (uintptr_t) ptr * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (h >> 44) & (TABLE_SIZE - 1);
+}
+
+/*******************************************************************************
+* function: insert
+* purpose: give ptr a new id, or the id it is moving with after a realloc
+* returns: the id, 0 if the table is full and the object is dropped
+*******************************************************************************/
+
+static uint32_t insert(void *ptr, uint32_t id)
+{
+    if (recorder.live >= TABLE_FULL) return 0;
+    if (id == 0) id = recorder.next_id++;
+
+    size_t i = slot_of(ptr);
+    while (recorder.table[i].ptr != NULL) i = (i + 1) & (TABLE_SIZE - 1);
+
+    recorder.table[i] = (struct entry) {ptr, id};
+    recorder.live++;
+
+    return id;
+}
+
+/*******************************************************************************
+* function: erase
+* purpose: forget ptr, with backward shift deletion to keep probe runs intact
+* returns: the id of ptr, 0 if ptr is unknown
+*******************************************************************************/
+
+static uint32_t erase(void *ptr)
+{
+    size_t mask = TABLE_SIZE - 1;
+    size_t i = slot_of(ptr);
+
+    while (recorder.table[i].ptr != ptr)
+    {
+        if (recorder.table[i].ptr == NULL) return 0;
+        i = (i + 1) & mask;
+    }
+
+    uint32_t id = recorder.table[i].id;
+    recorder.live--;
+
+    for (size_t j = (i + 1) & mask; recorder.table[j].ptr != NULL; j = (j + 1) & mask)
+    {
+        size_t home = slot_of(recorder.table[j].ptr);
+
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            recorder.table[i] = recorder.table[j];
+            i = j;
+        }
+    }
+
+    recorder.table[i].ptr = NULL;
+
+    return id;
+}
+
+/******************************************************************************/
+
+bool trace_start(const char *path)
+{
+    if (recorder.fd != -1) return false;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return false;
+
+    if (write(fd, TRACE_MAGIC, 8) != 8)
+    {
+        close(fd);
+        return false;
+    }
+
+    lock();
+
+    memset(recorder.table, 0, sizeof(recorder.table));
+    recorder.live = 0;
+    recorder.count = 0;
+    recorder.next_id = 1;
+    clock_gettime(CLOCK_MONOTONIC, &recorder.origin);
+    recorder.fd = fd;
+
+    unlock();
+
+    return true;
+}
+
+/******************************************************************************/
+
+void trace_stop(void)
+{
+    lock();
+
+    if (recorder.fd != -1)
+    {
+        flush();
+        close(recorder.fd);
+        recorder.fd = -1;
+    }
+
+    unlock();
+}
+
+/*******************************************************************************
+The fd check before locking keeps untraced calls down to one load. A racing
+trace_stop() is caught again under the lock.
+*/
+
+static void record_new(unsigned op, unsigned align, void *ptr, size_t size)
+{
+    if (recorder.fd == -1 || ptr == NULL) return;
+
+    lock();
+
+    if (recorder.fd != -1)
+    {
+        uint32_t id = insert(ptr, 0);
+        if (id != 0) append(op, align, id, size);
+    }
+
+    unlock();
+}
+
+void trace_malloc(void *ptr, size_t size)
+{
+    record_new(TRACE_MALLOC, 0, ptr, size);
+}
+
+void trace_calloc(void *ptr, size_t size)
+{
+    record_new(TRACE_CALLOC, 0, ptr, size);
+}
+
+void trace_memalign(void *ptr, size_t alignment, size_t size)
+{
+    unsigned align = alignment > 1 ? 63 - (unsigned) __builtin_clzll(alignment) : 0;
+    record_new(TRACE_MEMALIGN, align > 31 ? 31 : align, ptr, size);
+}
+
+void trace_realloc(void *old, void *ptr, size_t size)
+{
+    if (recorder.fd == -1) return;
+    if (old == NULL)
+    {
+        trace_malloc(ptr, size);
+        return;
+    }
+
+    //realloc to zero bytes frees, a failed realloc leaves old untouched
+    if (ptr == NULL)
+    {
+        if (size == 0) trace_free(old);
+        return;
+    }
+
+    lock();
+
+    if (recorder.fd != -1)
+    {
+        uint32_t id = erase(old);
+
+        if (id == 0)
+        {
+            id = insert(ptr, 0);
+            if (id != 0) append(TRACE_MALLOC, 0, id, size);
+        }
+        else if (insert(ptr, id) != 0) append(TRACE_REALLOC, 0, id, size);
+    }
+
+    unlock();
+}
+
+void trace_free(void *ptr)
+{
+    if (recorder.fd == -1 || ptr == NULL) return;
+
+    lock();
+
+    if (recorder.fd != -1)
+    {
+        uint32_t id = erase(ptr);
+        if (id != 0) append(TRACE_FREE, 0, id, 0);
+    }
+
+    unlock();
+}
@@ -0,0 +1,92 @@
+/*
+* Author: Biren Patel
+* Description: Allocation trace recorder. Every malloc, calloc, realloc, aligned
+* allocation, and free passed to the recorder is appended to a compact binary
+* file as one 16-byte record, and the pointer is replaced by a dense object id
+* so that a trace can be replayed against any allocator by replay.c. The
+* recorder never allocates, which lets trace_preload.c call it from inside
+* malloc itself.
+*
+* note: requires POSIX for open, write, and clock_gettime
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*******************************************************************************
+* file format
+* @ TRACE_MAGIC : first 8 bytes of every trace file, the version is the last
+* @ TRACE_MALLOC : new object of size bytes
+* @ TRACE_CALLOC : new zeroed object of size bytes
+* @ TRACE_MEMALIGN : new object of size bytes aligned to 2^TRACE_ALIGN bytes
+* @ TRACE_REALLOC : object id changes to size bytes and may move
+* @ TRACE_FREE : object id is released, size is 0
+* @ TRACE_OP : operation of a record
+* @ TRACE_ALIGN : log2 alignment of a TRACE_MEMALIGN record
+* @ TRACE_NANOS : nanoseconds from trace_start() to the operation
+* note: records are in host byte order, and sizes over 4 GiB are clamped
+*******************************************************************************/
+
+#define TRACE_MAGIC "MEMTRC01"
+
+#define TRACE_MALLOC 0
+#define TRACE_CALLOC 1
+#define TRACE_MEMALIGN 2
+#define TRACE_REALLOC 3
+#define TRACE_FREE 4
+
+#define TRACE_OP(record) ((unsigned) ((record)->stamp & 0x7))
+#define TRACE_ALIGN(record) ((unsigned) ((record)->stamp >> 3 & 0x1F))
+#define TRACE_NANOS(record) ((record)->stamp >> 8)
+
+/*******************************************************************************
+* struct: trace_record
+* purpose: one operation of a trace
+* @ stamp : nanoseconds << 8 | log2 alignment << 3 | operation
+* @ id : object id, ids start at 1 and are never reused within a trace
+* @ size : bytes requested
+*******************************************************************************/
+
+struct trace_record
+{
+    uint64_t stamp;
+    uint32_t id;
+    uint32_t size;
+};
+
+/*******************************************************************************
+* function: trace_start
+* purpose: create or truncate the trace file and begin recording
+* returns: false if a trace is already recording or the file cannot be opened
+*******************************************************************************/
+
+bool trace_start(const char *path);
+
+/*******************************************************************************
+* function: trace_stop
+* purpose: flush and close the trace file, later calls record nothing
+*******************************************************************************/
+
+void trace_stop(void);
+
+/*******************************************************************************
+* functions: trace_malloc, trace_calloc, trace_memalign, trace_realloc,
+*            trace_free
+* purpose: record an operation just after the allocator has performed it
+* @ ptr : block returned by the allocator, failed allocations are not recorded
+* @ old : block passed to realloc, the object keeps its id when it moves
+* note: blocks allocated before trace_start() are unknown to the recorder. Their
+* frees are skipped and their reallocs are recorded as new objects.
+*******************************************************************************/
+
+void trace_malloc(void *ptr, size_t size);
+void trace_calloc(void *ptr, size_t size);
+void trace_memalign(void *ptr, size_t alignment, size_t size);
+void trace_realloc(void *old, void *ptr, size_t size);
+void trace_free(void *ptr);
+
+#endif
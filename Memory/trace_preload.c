@@ -0,0 +1,99 @@
+/*
+* Author: Biren Patel
+* Description: LD_PRELOAD shim that records every heap operation of an
+* unmodified program. The C allocation functions are replaced by wrappers that
+* call the glibc implementations and then the recorder. The trace is written
+* to the file named by the MEMTRACE environment variable, memory.trace if unset.
+*
+* usage: MEMTRACE=out.trace LD_PRELOAD=./trace_preload.so ./program
+* note: glibc only, see the preload target of the makefile
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+/*******************************************************************************
+glibc exports its allocator under these names as well, so the wrappers need no
+dlsym lookup, which would itself allocate before the shim is ready.
+*/
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/*******************************************************************************
+Recording starts once the shim is loaded, so the allocations made by the
+dynamic loader before then are unknown to the trace.
+*/
+
+__attribute__((constructor)) static void trace_preload_start(void)
+{
+    const char *path = getenv("MEMTRACE");
+    trace_start(path != NULL ? path : "memory.trace");
+}
+
+__attribute__((destructor)) static void trace_preload_stop(void)
+{
+    trace_stop();
+}
+
+/******************************************************************************/
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    trace_malloc(ptr, size);
+    return ptr;
+}
+
+void *calloc(size_t n, size_t size)
+{
+    void *ptr = __libc_calloc(n, size);
+    trace_calloc(ptr, n * size);
+    return ptr;
+}
+
+void *realloc(void *old, size_t size)
+{
+    void *ptr = __libc_realloc(old, size);
+    trace_realloc(old, ptr, size);
+    return ptr;
+}
+
+void free(void *ptr)
+{
+    trace_free(ptr);
+    __libc_free(ptr);
+}
+
+/*******************************************************************************
+The aligned variants all funnel into __libc_memalign. Their free is recorded
+by the free wrapper above like any other block.
+*/
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+    trace_memalign(ptr, alignment, size);
+    return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*) || alignment & (alignment - 1)) return EINVAL;
+
+    void *ptr = memalign(alignment, size);
+    if (ptr == NULL) return ENOMEM;
+
+    *out = ptr;
+    return 0;
+}
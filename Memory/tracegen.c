@@ -0,0 +1,187 @@
+/*
+* Author: Biren Patel
+* Description: Synthetic allocation workloads built from the integration tests
+* of the container suites. Each suite repeats the leak check of its test file
+* through the real container code for several rounds, so running this program
+* under trace_preload.so yields a trace of genuine container traffic for the
+* replay driver. The Unity cases are skipped since they allocate almost nothing.
+*
+* usage: tracegen.exe darray | list | sll | all
+* note: the makefile traces target records one trace file per suite
+*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../Data Structures/Dynamic Array/dynamic_array.h"
+#include "../Data Structures/Linked List/Double/list.h"
+#include "../Data Structures/Linked List/Single/sll.h"
+
+/*******************************************************************************
+* workload parameters
+* @ ROUNDS : repetitions of each integration test
+*******************************************************************************/
+
+#define ROUNDS 40
+
+/*******************************************************************************
+The payload types and destructors are the ones of the test files.
+*/
+
+struct object
+{
+    int i;
+    double x;
+    char c;
+};
+
+struct point
+{
+    double x;
+    double y;
+};
+
+static void darray_free(void *header)
+{
+    struct darray_header *dh = header;
+
+    for (size_t i = 0; i < dh->count; ++i) free(dh->data[i]);
+
+    free(dh->queue);
+    free(dh);
+}
+
+static void sll_free(void *list)
+{
+    struct sll *s = list;
+
+    while (s->head != NULL) free(sll_remove_head(s));
+
+    free(s);
+}
+
+/*******************************************************************************
+test_dynamic_array.c: 20000 appends, then 5000 rounds of pop, popleft, and peek
+*/
+
+static void darray_suite(void)
+{
+    darray d = darray_create(512, darray_free);
+    assert(d != NULL && "darray_create failed");
+
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        struct object *obj = malloc(sizeof(struct object));
+        assert(obj != NULL && "malloc failed");
+
+        obj->i = 42;
+        obj->x = 3.14;
+        obj->c = 'z';
+
+        int status = darray_append(&d, obj);
+        assert(status == 0 && "darray_append failed");
+        (void) status;
+    }
+
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        free(darray_pop(d));
+        free(darray_popleft(d));
+        darray_peek(d);
+    }
+
+    darray_destroy(d);
+}
+
+/*******************************************************************************
+test_list.c: 2500 pushes alternating between the ends, then 1000 pops of each
+*/
+
+static void list_suite(void)
+{
+    struct list *list = list_create(free);
+    assert(list != NULL && "list_create failed");
+
+    for (size_t i = 0; i < 2500; ++i)
+    {
+        struct point *p = malloc(sizeof(struct point));
+        assert(p != NULL && "malloc failed");
+
+        p->x = 1.0;
+        p->y = 2.0;
+
+        i % 2 == 0 ? list_push_head(list, p) : list_push_tail(list, p);
+    }
+
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        free(list_pop_tail(list));
+        free(list_pop_head(list));
+    }
+
+    list_destroy(list);
+}
+
+/*******************************************************************************
+test_sll.c: 5000 insertions at the head, then 2500 removals from the tail
+*/
+
+static void sll_suite(void)
+{
+    struct sll *list = sll_create(sll_free);
+    assert(list != NULL && "sll_create failed");
+
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        struct point *p = malloc(sizeof(struct point));
+        assert(p != NULL && "malloc failed");
+
+        p->x = 1.0;
+        p->y = 2.0;
+
+        sll_insert_head(list, p);
+    }
+
+    for (size_t i = 0; i < 2500; ++i) free(sll_remove_tail(list));
+
+    sll_destroy(list);
+}
+
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *name;
+        void (*run)(void);
+    }
+    suites[] =
+    {
+        {"darray", darray_suite},
+        {"list", list_suite},
+        {"sll", sll_suite},
+    };
+
+    size_t total = sizeof(suites) / sizeof(suites[0]);
+    const char *pick = argc > 1 ? argv[1] : "all";
+    int ran = 0;
+
+    for (size_t s = 0; s < total; s++)
+    {
+        if (strcmp(pick, "all") != 0 && strcmp(pick, suites[s].name) != 0) continue;
+
+        for (int r = 0; r < ROUNDS; r++) suites[s].run();
+        ran++;
+    }
+
+    if (ran == 0)
+    {
+        fprintf(stderr, "usage: %s darray | list | sll | all\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <immintrin.h>
 
 #include "timeit.h"
@@ -243,6 +244,374 @@ void test_simd_pcg_32_bit_insecure_generator(void)
     }
 }
 
+/*******************************************************************************
+Given the same seed, does a PCG 64i generator built in caller storage output the
+same stream as one built on the heap? Both go through the same hash of the seed,
+so any drift means the inplace variant lays out or seeds its state differently.
+*/
+
+void test_deterministic_seed_pcg64_inplace_output(void)
+{
+    //arrange
+    uint64_t storage[RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    
+    generator_64bit rng_1 = random_init_pcg64_insecure(42, NULL);
+    assert(rng_1 != NULL && "malloc failure");
+    
+    generator_64bit rng_2 = random_init_pcg64_insecure_inplace(storage, sizeof(storage), 42, NULL);
+    assert(rng_2 != NULL && "buffer failure");
+    
+    //act-assert
+    for (size_t i = 0; i < BIG_SIMULATION; i++)
+    {
+        uint64_t result_1 = rng_1->next(rng_1->state);
+        uint64_t result_2 = rng_2->next(rng_2->state);
+        
+        TEST_ASSERT_EQUAL_UINT64(result_1, result_2);
+    }
+    
+    free(rng_1->state);
+}
+
+/*******************************************************************************
+Given a seed, do two batches of PCG 64i generators output the same stream at the
+same index, and does every index within a batch output its own stream? Two of
+eight 64-bit streams agreeing on a draw has odds of about 2^-59 per draw, so a
+single match across the simulation is treated as a failure.
+*/
+
+#define BATCH_GENERATORS 8
+
+void test_deterministic_seed_pcg64_batch_output(void)
+{
+    //arrange
+    uint64_t storage_1[BATCH_GENERATORS * RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    uint64_t storage_2[BATCH_GENERATORS * RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    generator_64bit rngs_1[BATCH_GENERATORS];
+    generator_64bit rngs_2[BATCH_GENERATORS];
+    
+    int error_1 = random_init_pcg64_insecure_batch(storage_1, sizeof(storage_1), rngs_1, BATCH_GENERATORS, 42);
+    assert(error_1 == RANDOM_SUCCESS && "buffer failure");
+    
+    int error_2 = random_init_pcg64_insecure_batch(storage_2, sizeof(storage_2), rngs_2, BATCH_GENERATORS, 42);
+    assert(error_2 == RANDOM_SUCCESS && "buffer failure");
+    
+    size_t matches = 0;
+    
+    //act-assert
+    for (size_t i = 0; i < MID_SIMULATION; i++)
+    {
+        uint64_t results[BATCH_GENERATORS];
+        
+        for (size_t j = 0; j < BATCH_GENERATORS; j++)
+        {
+            results[j] = rngs_1[j]->next(rngs_1[j]->state);
+            uint64_t result_2 = rngs_2[j]->next(rngs_2[j]->state);
+            
+            TEST_ASSERT_EQUAL_UINT64(results[j], result_2);
+        }
+        
+        for (size_t j = 0; j < BATCH_GENERATORS; j++)
+        {
+            for (size_t k = j + 1; k < BATCH_GENERATORS; k++)
+            {
+                if (results[j] == results[k]) matches++;
+            }
+        }
+    }
+    
+    TEST_ASSERT_EQUAL_UINT64(0, matches);
+}
+
+/*******************************************************************************
+Reservoir sampling should leave every item of a stream of n items in a size k
+reservoir with probability k/n, whatever its position in the stream. A stream of
+100 integers is fed through a reservoir of 10 items, and at 50,000 simulations
+the tolerance on each of the 100 inclusion rates of 0.1 is set as +/- 0.01.
+*/
+
+#define STREAM_ITEMS 100
+#define RESERVOIR_ITEMS 10
+
+void test_reservoir_includes_each_stream_item_with_probability_k_over_n(void)
+{
+    //arrange
+    uint64_t storage[RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    generator_64bit rng = random_init_pcg64_insecure_inplace(storage, sizeof(storage), 0, NULL);
+    assert(rng != NULL && "rdrand failure");
+    
+    float results[STREAM_ITEMS] = {0};
+    
+    //act
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        reservoir r = random_reservoir_create(RESERVOIR_ITEMS, sizeof(int), false, NULL);
+        assert(r != NULL && "malloc failure");
+        
+        for (int j = 0; j < STREAM_ITEMS; j++)
+        {
+            int *slot = random_reservoir_offer(rng, r);
+            if (slot) *slot = j;
+        }
+        
+        TEST_ASSERT_EQUAL_UINT64(RESERVOIR_ITEMS, random_reservoir_count(r));
+        
+        for (uint64_t j = 0; j < random_reservoir_count(r); j++)
+        {
+            results[*(int *) random_reservoir_get(r, j)]++;
+        }
+        
+        random_reservoir_destroy(r);
+    }
+    
+    //assert
+    for (size_t i = 0; i < STREAM_ITEMS; i++)
+    {
+        results[i] /= SMALL_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.01f, 0.1f, results[i]);
+    }
+}
+
+/*******************************************************************************
+Same as above, except that the caller drops every run of items the reservoir
+would reject as announced by random_reservoir_skip, and only offers the rest.
+Skipping must not change the inclusion probability of any item.
+*/
+
+void test_reservoir_skip_keeps_inclusion_probability_k_over_n(void)
+{
+    //arrange
+    uint64_t storage[RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    generator_64bit rng = random_init_pcg64_insecure_inplace(storage, sizeof(storage), 0, NULL);
+    assert(rng != NULL && "rdrand failure");
+    
+    float results[STREAM_ITEMS] = {0};
+    
+    //act
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        reservoir r = random_reservoir_create(RESERVOIR_ITEMS, sizeof(int), false, NULL);
+        assert(r != NULL && "malloc failure");
+        
+        int j = 0;
+        
+        while (true)
+        {
+            j += (int) random_reservoir_skip(r);
+            if (j >= STREAM_ITEMS) break;
+            
+            int *slot = random_reservoir_offer(rng, r);
+            if (slot) *slot = j;
+            j++;
+        }
+        
+        for (uint64_t k = 0; k < random_reservoir_count(r); k++)
+        {
+            results[*(int *) random_reservoir_get(r, k)]++;
+        }
+        
+        random_reservoir_destroy(r);
+    }
+    
+    //assert
+    for (size_t i = 0; i < STREAM_ITEMS; i++)
+    {
+        results[i] /= SMALL_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.01f, 0.1f, results[i]);
+    }
+}
+
+/*******************************************************************************
+The first 30 items of the stream go to one reservoir and the last 70 to another,
+then the second is merged into the first. The merged reservoir must look like a
+single reservoir over all 100 items, so every item is again included at 0.1 and
+neither part of the stream is favored for its size.
+*/
+
+void test_reservoir_merge_is_uniform_over_the_combined_stream(void)
+{
+    //arrange
+    uint64_t storage[RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    generator_64bit rng = random_init_pcg64_insecure_inplace(storage, sizeof(storage), 0, NULL);
+    assert(rng != NULL && "rdrand failure");
+    
+    float results[STREAM_ITEMS] = {0};
+    
+    //act
+    for (size_t i = 0; i < SMALL_SIMULATION; i++)
+    {
+        reservoir head = random_reservoir_create(RESERVOIR_ITEMS, sizeof(int), false, NULL);
+        reservoir tail = random_reservoir_create(RESERVOIR_ITEMS, sizeof(int), false, NULL);
+        assert(head != NULL && tail != NULL && "malloc failure");
+        
+        for (int j = 0; j < STREAM_ITEMS; j++)
+        {
+            int *slot = random_reservoir_offer(rng, j < 30 ? head : tail);
+            if (slot) *slot = j;
+        }
+        
+        int status = random_reservoir_merge(rng, head, tail);
+        TEST_ASSERT_EQUAL_INT(RANDOM_SUCCESS, status);
+        TEST_ASSERT_EQUAL_UINT64(RESERVOIR_ITEMS, random_reservoir_count(head));
+        
+        for (uint64_t k = 0; k < random_reservoir_count(head); k++)
+        {
+            results[*(int *) random_reservoir_get(head, k)]++;
+        }
+        
+        random_reservoir_destroy(head);
+        random_reservoir_destroy(tail);
+    }
+    
+    //assert
+    for (size_t i = 0; i < STREAM_ITEMS; i++)
+    {
+        results[i] /= SMALL_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.01f, 0.1f, results[i]);
+    }
+}
+
+/*******************************************************************************
+Weighted reservoir sampling (A-ExpJ) keeps the same items in distribution as k
+successive weighted draws without replacement. The exact inclusion probability
+of each item is the total probability of every ordered sequence of k draws that
+contains it, which is small enough to enumerate for 20 items and k = 3. Item i
+of the stream carries weight i, so item 0 must never be kept and the inclusion
+rate must rise with every unit of weight. At 500,000 simulations the tolerance
+on each rate is set as +/- 0.005, while adjacent rates differ by at least 0.013.
+*/
+
+#define WEIGHTED_STREAM_ITEMS 20
+#define WEIGHTED_RESERVOIR_ITEMS 3
+
+static void weighted_inclusion(double *expected, bool *drawn, double p, int depth)
+{
+    if (depth == WEIGHTED_RESERVOIR_ITEMS)
+    {
+        for (int i = 0; i < WEIGHTED_STREAM_ITEMS; i++)
+        {
+            if (drawn[i]) expected[i] += p;
+        }
+        
+        return;
+    }
+    
+    double remaining = 0.0;
+    
+    for (int i = 0; i < WEIGHTED_STREAM_ITEMS; i++)
+    {
+        if (!drawn[i]) remaining += i;
+    }
+    
+    for (int i = 1; i < WEIGHTED_STREAM_ITEMS; i++)
+    {
+        if (drawn[i]) continue;
+        
+        drawn[i] = true;
+        weighted_inclusion(expected, drawn, p * i / remaining, depth + 1);
+        drawn[i] = false;
+    }
+}
+
+static void assert_weighted_inclusion(float *results)
+{
+    double expected[WEIGHTED_STREAM_ITEMS] = {0};
+    bool drawn[WEIGHTED_STREAM_ITEMS] = {false};
+    
+    weighted_inclusion(expected, drawn, 1.0, 0);
+    
+    for (size_t i = 0; i < WEIGHTED_STREAM_ITEMS; i++)
+    {
+        results[i] /= MID_SIMULATION;
+        TEST_ASSERT_FLOAT_WITHIN(.005f, (float) expected[i], results[i]);
+        
+        if (i > 0) TEST_ASSERT_TRUE(results[i] > results[i - 1]);
+    }
+    
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, results[0]);
+}
+
+void test_weighted_reservoir_includes_items_in_proportion_to_weight(void)
+{
+    //arrange
+    uint64_t storage[RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    generator_64bit rng = random_init_pcg64_insecure_inplace(storage, sizeof(storage), 0, NULL);
+    assert(rng != NULL && "rdrand failure");
+    
+    float results[WEIGHTED_STREAM_ITEMS] = {0};
+    
+    //act
+    for (size_t i = 0; i < MID_SIMULATION; i++)
+    {
+        reservoir r = random_reservoir_create(WEIGHTED_RESERVOIR_ITEMS, sizeof(int), true, NULL);
+        assert(r != NULL && "malloc failure");
+        
+        for (int j = 0; j < WEIGHTED_STREAM_ITEMS; j++)
+        {
+            int *slot = random_reservoir_offer_weighted(rng, r, j);
+            if (slot) *slot = j;
+        }
+        
+        TEST_ASSERT_EQUAL_UINT64(WEIGHTED_RESERVOIR_ITEMS, random_reservoir_count(r));
+        
+        for (uint64_t k = 0; k < random_reservoir_count(r); k++)
+        {
+            results[*(int *) random_reservoir_get(r, k)]++;
+        }
+        
+        random_reservoir_destroy(r);
+    }
+    
+    //assert
+    assert_weighted_inclusion(results);
+}
+
+/*******************************************************************************
+Merging two weighted reservoirs keeps the largest keys across both, so it must
+give the same inclusion probabilities as one reservoir over the whole stream.
+The first 7 of the 20 weighted items above go to one reservoir and the rest to
+another, and the merged rates are held to the same tolerance.
+*/
+
+void test_weighted_reservoir_merge_keeps_inclusion_probabilities(void)
+{
+    //arrange
+    uint64_t storage[RANDOM_SIZEOF_PCG64_INSECURE / sizeof(uint64_t)];
+    generator_64bit rng = random_init_pcg64_insecure_inplace(storage, sizeof(storage), 0, NULL);
+    assert(rng != NULL && "rdrand failure");
+    
+    float results[WEIGHTED_STREAM_ITEMS] = {0};
+    
+    //act
+    for (size_t i = 0; i < MID_SIMULATION; i++)
+    {
+        reservoir head = random_reservoir_create(WEIGHTED_RESERVOIR_ITEMS, sizeof(int), true, NULL);
+        reservoir tail = random_reservoir_create(WEIGHTED_RESERVOIR_ITEMS, sizeof(int), true, NULL);
+        assert(head != NULL && tail != NULL && "malloc failure");
+        
+        for (int j = 0; j < WEIGHTED_STREAM_ITEMS; j++)
+        {
+            int *slot = random_reservoir_offer_weighted(rng, j < 7 ? head : tail, j);
+            if (slot) *slot = j;
+        }
+        
+        int status = random_reservoir_merge(rng, head, tail);
+        TEST_ASSERT_EQUAL_INT(RANDOM_SUCCESS, status);
+        TEST_ASSERT_EQUAL_UINT64(WEIGHTED_RESERVOIR_ITEMS, random_reservoir_count(head));
+        
+        for (uint64_t k = 0; k < random_reservoir_count(head); k++)
+        {
+            results[*(int *) random_reservoir_get(head, k)]++;
+        }
+        
+        random_reservoir_destroy(head);
+        random_reservoir_destroy(tail);
+    }
+    
+    //assert
+    assert_weighted_inclusion(results);
+}
+
 /*******************************************************************************
 Benchmarks on 1 million draws.
 */
@@ -304,6 +673,13 @@ int main(void)
         RUN_TEST(test_von_neumann_debiaser_outputs_all_unbiased_bits);
         RUN_TEST(test_cyclic_autocorrelation_of_alternating_bitstream);
         RUN_TEST(test_simd_pcg_32_bit_insecure_generator);
+        RUN_TEST(test_deterministic_seed_pcg64_inplace_output);
+        RUN_TEST(test_deterministic_seed_pcg64_batch_output);
+        RUN_TEST(test_reservoir_includes_each_stream_item_with_probability_k_over_n);
+        RUN_TEST(test_reservoir_skip_keeps_inclusion_probability_k_over_n);
+        RUN_TEST(test_reservoir_merge_is_uniform_over_the_combined_stream);
+        RUN_TEST(test_weighted_reservoir_includes_items_in_proportion_to_weight);
+        RUN_TEST(test_weighted_reservoir_merge_keeps_inclusion_probabilities);
     UNITY_END();
     
     speed_test();
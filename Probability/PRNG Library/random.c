@@ -93,64 +93,126 @@ struct xorshift64
 };
 #define SIZEOF_XORSHIFT64 (sizeof(struct xorshift64))
 
+/*******************************************************************************
+The full SplitMix64 generator, including Vigna's golden gamma increment. Unlike
+random_hash, which remixes a single value, this walks a sequence with a period
+of 2^64 and is used to expand one seed into many independent generator seeds.
+*/
+
+static uint64_t random_splitmix(uint64_t *value)
+{
+    *value += 0x9e3779b97f4a7c15ULL;
+    
+    uint64_t i = *value;
+    
+    return random_hash(&i);
+}
+
 /*******************************************************************************
 PCG64 insecure seeding. The increment must be odd. This library is non-crypto 
 so we use the faster rdrand instruction to avoid the rdseed extractor and to 
-minimize risk of underflow. This function demonstrates the general init approach
-for all generators:
+minimize risk of underflow. A single rdrand draw is hashed into both the state
+and the increment. This function demonstrates the general init approach for all
+generators:
 
-1. allocate the abstract interface and pocket the generator just in front of it
+1. pocket the generator just in front of the abstract interface in one block
 2. seed the internal state
 3. hook the callbacks, where next() is unique to each generator
+
+The malloc variant simply reserves the block and defers to the inplace variant.
 */
 
-generator_64bit random_init_pcg64_insecure(uint64_t seed, int *error)
+static void random_hook_pcg64_insecure(struct generator_64bit *g64b, struct pcg64_insecure *pcg64i)
 {
-    //allocate both interface and generator together for cache locality
-    int bytes = SIZEOF_PCG64_INSECURE + SIZEOF_GENERATOR_64BIT;
-    struct pcg64_insecure * pcg64i = malloc(bytes);
+    pcg64i->increment |= 1;
     
-    if (!pcg64i)
+    g64b->state = (void*) pcg64i;
+    g64b->next = random_next_pcg64_insecure;
+    g64b->rint = random_int_64;
+    g64b->bern = random_bernoulli_64;
+    g64b->bino = random_binomial_64;
+}
+
+generator_64bit random_init_pcg64_insecure_inplace(void *buf, size_t len, uint64_t seed, int *error)
+{
+    if (!buf || len < SIZEOF_PCG64_INSECURE + SIZEOF_GENERATOR_64BIT || (uintptr_t) buf % 8)
     {
-        if (error) *error = RANDOM_MALLOC_FAIL;
+        if (error) *error = RANDOM_BUFFER_FAIL;
         return NULL;
     }
     
+    struct pcg64_insecure *pcg64i = buf;
     struct generator_64bit *g64b = (void*) ((char*) pcg64i + SIZEOF_PCG64_INSECURE);
     
     //seed the generator
-    if (seed != 0)
+    if (seed == 0 && !random_try_rdrand(&seed, 10))
     {
-        pcg64i->state = random_hash(&seed);
-        pcg64i->increment = random_hash(&seed);
+        if (error) *error = RANDOM_RDRAND_FAIL;
+        return NULL;
     }
-    else
+    
+    pcg64i->state = random_hash(&seed);
+    pcg64i->increment = random_hash(&seed);
+    
+    //hook pcg into the interface and return the generator, use state to recover
+    random_hook_pcg64_insecure(g64b, pcg64i);
+    
+    if (error) *error = RANDOM_SUCCESS;
+    return g64b;
+}
+
+generator_64bit random_init_pcg64_insecure(uint64_t seed, int *error)
+{
+    //allocate both interface and generator together for cache locality
+    size_t bytes = SIZEOF_PCG64_INSECURE + SIZEOF_GENERATOR_64BIT;
+    void *buf = malloc(bytes);
+    
+    if (!buf)
     {
-        if (!random_try_rdrand(&pcg64i->state, 10))
-        {
-            if (error) *error = RANDOM_RDRAND_FAIL;
-            return NULL;
-        }
-        
-        if (!random_try_rdrand(&pcg64i->increment, 10))
-        {
-            if (error) *error = RANDOM_RDRAND_FAIL;
-            return NULL;
-        }
+        if (error) *error = RANDOM_MALLOC_FAIL;
+        return NULL;
     }
     
-    pcg64i->increment |= 1;
+    generator_64bit g64b = random_init_pcg64_insecure_inplace(buf, bytes, seed, error);
     
-    //hook pcg into the interface
-    g64b->state = (void*) pcg64i;
-    g64b->next = random_next_pcg64_insecure;
-    g64b->rint = random_int_64;
-    g64b->bern = random_bernoulli_64;
-    g64b->bino = random_binomial_64;
+    if (!g64b) free(buf);
     
-    //drop the pcg handle and return the genreator, use state ptr to recover
-    if (error) *error = RANDOM_SUCCESS;
-    return g64b;    
+    return g64b;
+}
+
+/*******************************************************************************
+Batch seeding lays out n generators contiguously at a fixed stride. Distinct
+SplitMix64 outputs per state and per increment give each generator its own PCG
+stream, so the batch costs one rdrand call and no allocation at all.
+*/
+
+int random_init_pcg64_insecure_batch(void *buf, size_t len, generator_64bit *rngs, size_t n, uint64_t seed)
+{
+    const size_t stride = SIZEOF_PCG64_INSECURE + SIZEOF_GENERATOR_64BIT;
+    assert(stride == RANDOM_SIZEOF_PCG64_INSECURE && "public size out of sync");
+    
+    if (!buf || !rngs || len / stride < n || (uintptr_t) buf % 8)
+    {
+        return RANDOM_BUFFER_FAIL;
+    }
+    
+    //nonzero seeds are hashed first for parity with the single generator init
+    if (seed != 0) random_hash(&seed);
+    else if (!random_try_rdrand(&seed, 10)) return RANDOM_RDRAND_FAIL;
+    
+    for (size_t i = 0; i < n; i++)
+    {
+        struct pcg64_insecure *pcg64i = (void*) ((char*) buf + i * stride);
+        struct generator_64bit *g64b = (void*) ((char*) pcg64i + SIZEOF_PCG64_INSECURE);
+        
+        pcg64i->state = random_splitmix(&seed);
+        pcg64i->increment = random_splitmix(&seed);
+        
+        random_hook_pcg64_insecure(g64b, pcg64i);
+        rngs[i] = g64b;
+    }
+    
+    return RANDOM_SUCCESS;
 }
 
 /*******************************************************************************
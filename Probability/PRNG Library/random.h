@@ -7,6 +7,8 @@
 #ifndef SCIPACK_RANDOM_H
 #define SCIPACK_RANDOM_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /*******************************************************************************
@@ -28,6 +30,8 @@ enum RANDOM_ERROR_CODES
     RANDOM_SUCCESS              = 0,
     RANDOM_RDRAND_FAIL          = 1,
     RANDOM_MALLOC_FAIL          = 2,
+    RANDOM_MISMATCH_FAIL        = 3,
+    RANDOM_BUFFER_FAIL          = 4,
 };
 
 /*******************************************************************************
@@ -74,5 +78,108 @@ struct generator_64bit
 *******************************************************************************/
 generator_64bit random_init_pcg64_insecure(uint64_t seed, int *error);
 
+/*******************************************************************************
+* NAME: RANDOM_SIZEOF_*
+* DESC: bytes of caller storage needed to construct one generator in place
+*******************************************************************************/
+#define RANDOM_SIZEOF_PCG64_INSECURE (sizeof(struct generator_64bit) + 2 * sizeof(uint64_t))
+
+/*******************************************************************************
+* NAME: random_init_*_inplace
+* DESC: construct a generator inside caller-provided storage without malloc
+* OUTP: null on error, check error argument for details
+* NOTE: the generator is valid for the lifetime of buf and is never destroyed
+* @ buf : 8-byte aligned storage, i.e., from an arena or the stack
+* @ len : bytes available at buf, at least RANDOM_SIZEOF_* for the generator
+* @ seed : zero for non-deterministic seeding
+* @ error : can be passed as null, else one of enum RANDOM_ERROR_CODES
+*******************************************************************************/
+generator_64bit random_init_pcg64_insecure_inplace(void *buf, size_t len, uint64_t seed, int *error);
+
+/*******************************************************************************
+* NAME: random_init_*_batch
+* DESC: construct n independently seeded generators back to back inside buf
+* OUTP: one of enum RANDOM_ERROR_CODES
+* NOTE: one seed, or one rdrand draw when seed is zero, is expanded by SplitMix64
+* into every state and stream, so rdrand is called at most once per batch.
+* @ buf : 8-byte aligned storage of at least n * RANDOM_SIZEOF_* bytes
+* @ len : bytes available at buf
+* @ rngs : array of n handles filled on success
+* @ n : total generators to construct
+* @ seed : zero for non-deterministic seeding
+*******************************************************************************/
+int random_init_pcg64_insecure_batch(void *buf, size_t len, generator_64bit *rngs, size_t n, uint64_t seed);
+
+
+/*******************************************************************************
+* NAME: reservoir
+* DESC: fixed capacity sample of k items drawn from a stream of unknown length
+* NOTE: items are copied in and out by the caller through slot pointers, so the
+* reservoir never buffers the stream and never calls the rng for skipped items.
+*******************************************************************************/
+typedef struct reservoir * reservoir;
+
+/*******************************************************************************
+* NAME: random_reservoir_create
+* DESC: allocate an empty reservoir for k items of a fixed byte size
+* OUTP: null on error, check error argument for details
+* @ k : total items held by the reservoir once the stream exceeds k items
+* @ size : byte size of each item, i.e., sizeof(char *) to sample pointers
+* @ weighted : true for A-ExpJ weighted sampling, else Algorithm L
+* @ error : can be passed as null, else one of enum RANDOM_ERROR_CODES
+*******************************************************************************/
+reservoir random_reservoir_create(uint64_t k, size_t size, bool weighted, int *error);
+
+/*******************************************************************************
+* NAME: random_reservoir_destroy
+* DESC: release the reservoir, items held by pointer are not freed
+*******************************************************************************/
+void random_reservoir_destroy(reservoir r);
+
+/*******************************************************************************
+* NAME: random_reservoir_offer
+* DESC: offer the next stream item to an unweighted reservoir (Algorithm L)
+* OUTP: slot where the caller must copy the item, null if the item is rejected
+* NOTE: a returned slot may hold an evicted item which the caller may release
+*******************************************************************************/
+void *random_reservoir_offer(generator_64bit rng, reservoir r);
+
+/*******************************************************************************
+* NAME: random_reservoir_offer_weighted
+* DESC: offer the next stream item to a weighted reservoir (A-ExpJ)
+* OUTP: slot where the caller must copy the item, null if the item is rejected
+* NOTE: a returned slot may hold an evicted item which the caller may release
+* @ weight : positive item weight, nonpositive weights are never sampled
+*******************************************************************************/
+void *random_reservoir_offer_weighted(generator_64bit rng, reservoir r, double weight);
+
+/*******************************************************************************
+* NAME: random_reservoir_skip
+* DESC: consume the run of upcoming items that an unweighted reservoir rejects
+* OUTP: total items the caller may drop without parsing or offering them
+* NOTE: the item after the skipped run must be passed to random_reservoir_offer
+*******************************************************************************/
+uint64_t random_reservoir_skip(reservoir r);
+
+/*******************************************************************************
+* NAME: random_reservoir_merge
+* DESC: combine src into dest as if dest had also seen the stream behind src
+* OUTP: one of enum RANDOM_ERROR_CODES, src is left unchanged
+* NOTE: both reservoirs must share k, item size, and weighting
+*******************************************************************************/
+int random_reservoir_merge(generator_64bit rng, reservoir dest, reservoir src);
+
+/*******************************************************************************
+* NAME: random_reservoir_count
+* DESC: total items currently held, at most k
+*******************************************************************************/
+uint64_t random_reservoir_count(reservoir r);
+
+/*******************************************************************************
+* NAME: random_reservoir_get
+* DESC: access the item held at index i
+* OUTP: null if i is not less than random_reservoir_count()
+*******************************************************************************/
+void *random_reservoir_get(reservoir r, uint64_t i);
 
 #endif
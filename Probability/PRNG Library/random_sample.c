@@ -0,0 +1,376 @@
+/*
+* NAME: Copyright (c) 2020, Biren Patel
+* DESC: streaming reservoir samplers driven by the generator_64bit interface
+* LISC: MIT License
+*/
+
+#include "random.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+A reservoir holds k items of a fixed byte size along with the bookkeeping for
+both samplers. The keys and heap are only maintained during weighted sampling,
+but the unweighted sampler borrows them during a merge. Everything lives in one
+allocation, with the items placed last so the caller data is 8-byte aligned.
+
+@ k : capacity of the reservoir
+@ n : total items seen on the stream, including those from merged reservoirs
+@ filled : total slots holding an item, at most k
+@ next : Algorithm L, 1-based stream index of the next accepted item
+@ size : byte size of each item
+@ W : Algorithm L, largest key in the reservoir under the smallest-k scheme
+@ jump : A-ExpJ, remaining stream weight to skip before the next acceptance
+@ key : log-keys of each slot, where the k largest keys are kept
+@ heap : slot indices arranged as a min-heap on key
+@ item : k slots of size bytes each
+*/
+
+struct reservoir
+{
+    uint64_t k;
+    uint64_t n;
+    uint64_t filled;
+    uint64_t next;
+    size_t size;
+    double W;
+    double jump;
+    double *key;
+    uint64_t *heap;
+    char *item;
+    bool weighted;
+};
+
+#define SIZEOF_RESERVOIR (sizeof(struct reservoir))
+#define SLOT(r, i) ((void *) ((r)->item + (i) * (r)->size))
+
+/*******************************************************************************
+The uniform draws below feed logarithms, so they must exclude both endpoints.
+The top 53 bits of the generator are centered on the half-ulp to give (0, 1).
+*/
+
+static inline double random_uniform(generator_64bit rng)
+{
+    return ((double) (rng->next(rng->state) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+static inline uint64_t random_slot(generator_64bit rng, reservoir r)
+{
+    //rint uses clz on max - min which is undefined when k is one
+    return r->k > 1 ? rng->rint(rng, 0, r->k - 1) : 0;
+}
+
+/*******************************************************************************
+Binary min-heap over slot indices. The item bytes never move, only the indices.
+*/
+
+static void heap_sift_up(reservoir r, uint64_t i)
+{
+    uint64_t slot = r->heap[i];
+
+    while (i > 0)
+    {
+        uint64_t parent = (i - 1) / 2;
+
+        if (r->key[r->heap[parent]] <= r->key[slot]) break;
+
+        r->heap[i] = r->heap[parent];
+        i = parent;
+    }
+
+    r->heap[i] = slot;
+}
+
+static void heap_sift_down(reservoir r, uint64_t i)
+{
+    uint64_t slot = r->heap[i];
+
+    while (2 * i + 1 < r->filled)
+    {
+        uint64_t child = 2 * i + 1;
+
+        if (child + 1 < r->filled && r->key[r->heap[child + 1]] < r->key[r->heap[child]])
+        {
+            child++;
+        }
+
+        if (r->key[slot] <= r->key[r->heap[child]]) break;
+
+        r->heap[i] = r->heap[child];
+        i = child;
+    }
+
+    r->heap[i] = slot;
+}
+
+/*******************************************************************************
+Algorithm L (Li 1994). Conceptually every item receives a uniform key and the
+reservoir keeps the k smallest. W is the largest retained key, and the number
+of items skipped before some key falls under W is geometric. Each acceptance
+shrinks W by the maximum of k uniforms, so the rng is called O(k log(n/k)) times.
+*/
+
+static uint64_t random_reservoir_gap(generator_64bit rng, double W)
+{
+    double gap = floor(log(random_uniform(rng)) / log1p(-W));
+
+    //saturate rather than overflow on vanishingly small W
+    if (!(gap < 0x1.0p62)) return (uint64_t) 1 << 62;
+
+    return (uint64_t) gap;
+}
+
+static void random_reservoir_advance(generator_64bit rng, reservoir r)
+{
+    r->W *= exp(log(random_uniform(rng)) / (double) r->k);
+    r->next = r->n + random_reservoir_gap(rng, r->W) + 1;
+}
+
+/*******************************************************************************
+A-ExpJ (Efraimidis and Spirakis 2006). Item keys are u^(1/w), kept here as the
+log-key log(u)/w to avoid underflow on large weights. The reservoir keeps the k
+largest keys and the stream weight skipped before the next acceptance is drawn
+directly from the smallest retained key T as log(u)/log(T).
+*/
+
+static void random_reservoir_jump(generator_64bit rng, reservoir r)
+{
+    double threshold = r->key[r->heap[0]];
+
+    if (threshold < 0.0) r->jump = log(random_uniform(rng)) / threshold;
+    else r->jump = HUGE_VAL;
+}
+
+/******************************************************************************/
+
+reservoir random_reservoir_create(uint64_t k, size_t size, bool weighted, int *error)
+{
+    assert(k > 0 && "reservoir capacity must be positive");
+    assert(size > 0 && "reservoir item size must be positive");
+
+    size_t bytes = SIZEOF_RESERVOIR + k * (sizeof(double) + sizeof(uint64_t) + size);
+    struct reservoir *r = malloc(bytes);
+
+    if (!r)
+    {
+        if (error) *error = RANDOM_MALLOC_FAIL;
+        return NULL;
+    }
+
+    r->k = k;
+    r->n = 0;
+    r->filled = 0;
+    r->next = 0;
+    r->size = size;
+    r->W = 0.0;
+    r->jump = 0.0;
+    r->key = (void *) (r + 1);
+    r->heap = (void *) (r->key + k);
+    r->item = (void *) (r->heap + k);
+    r->weighted = weighted;
+
+    if (error) *error = RANDOM_SUCCESS;
+    return r;
+}
+
+/******************************************************************************/
+
+void random_reservoir_destroy(reservoir r)
+{
+    free(r);
+}
+
+/******************************************************************************/
+
+void *random_reservoir_offer(generator_64bit rng, reservoir r)
+{
+    assert(!r->weighted && "use random_reservoir_offer_weighted");
+
+    r->n++;
+
+    //fill phase, the first k items are always accepted
+    if (r->filled < r->k)
+    {
+        void *slot = SLOT(r, r->filled++);
+
+        if (r->filled == r->k)
+        {
+            r->W = 1.0;
+            random_reservoir_advance(rng, r);
+        }
+
+        return slot;
+    }
+
+    //skip phase, a single comparison per rejected item
+    if (r->n != r->next) return NULL;
+
+    void *slot = SLOT(r, random_slot(rng, r));
+    random_reservoir_advance(rng, r);
+
+    return slot;
+}
+
+/******************************************************************************/
+
+void *random_reservoir_offer_weighted(generator_64bit rng, reservoir r, double weight)
+{
+    assert(r->weighted && "use random_reservoir_offer");
+
+    r->n++;
+
+    if (!(weight > 0.0)) return NULL;
+
+    //fill phase, every item with positive weight is accepted with a fresh key
+    if (r->filled < r->k)
+    {
+        uint64_t slot = r->filled++;
+
+        r->key[slot] = log(random_uniform(rng)) / weight;
+        r->heap[r->filled - 1] = slot;
+        heap_sift_up(r, r->filled - 1);
+
+        if (r->filled == r->k) random_reservoir_jump(rng, r);
+
+        return SLOT(r, slot);
+    }
+
+    //skip phase, subtract weight until the exponential jump is exhausted
+    r->jump -= weight;
+    if (r->jump > 0.0) return NULL;
+
+    //the new key is drawn conditioned on exceeding the evicted threshold
+    uint64_t slot = r->heap[0];
+    double t = exp(weight * r->key[slot]);
+    double u = t + (1.0 - t) * random_uniform(rng);
+
+    r->key[slot] = log(u) / weight;
+    heap_sift_down(r, 0);
+    random_reservoir_jump(rng, r);
+
+    return SLOT(r, slot);
+}
+
+/******************************************************************************/
+
+uint64_t random_reservoir_skip(reservoir r)
+{
+    assert(!r->weighted && "skip is undefined for weighted reservoirs");
+
+    if (r->filled < r->k) return 0;
+
+    uint64_t skipped = r->next - r->n - 1;
+    r->n = r->next - 1;
+
+    return skipped;
+}
+
+/*******************************************************************************
+Merging keeps the k largest keys across both reservoirs. Weighted reservoirs
+already store their keys. Algorithm L only tracks W, but given W the remaining
+k - 1 keys are iid uniform on the far side of W and the threshold itself sits in
+an arbitrary slot, so keys can be redrawn exactly at merge time. Keys here are
+mirrored as 1 - key so both samplers keep the largest keys in the same heap.
+*/
+
+static double random_reservoir_rekey(generator_64bit rng, reservoir r, uint64_t i, uint64_t hot)
+{
+    if (r->filled < r->k) return log(random_uniform(rng));
+    else if (i == hot) return log1p(-r->W);
+    else return log1p(-r->W * random_uniform(rng));
+}
+
+static void random_reservoir_insert(reservoir r, double key, const void *item)
+{
+    uint64_t slot;
+
+    if (r->filled < r->k)
+    {
+        slot = r->filled++;
+        r->heap[r->filled - 1] = slot;
+        r->key[slot] = key;
+        heap_sift_up(r, r->filled - 1);
+    }
+    else if (key > r->key[r->heap[0]])
+    {
+        slot = r->heap[0];
+        r->key[slot] = key;
+        heap_sift_down(r, 0);
+    }
+    else return;
+
+    memcpy(SLOT(r, slot), item, r->size);
+}
+
+int random_reservoir_merge(generator_64bit rng, reservoir dest, reservoir src)
+{
+    if (dest->k != src->k || dest->size != src->size || dest->weighted != src->weighted)
+    {
+        return RANDOM_MISMATCH_FAIL;
+    }
+
+    //unweighted destination keys are drawn and then heapified in place
+    if (!dest->weighted)
+    {
+        uint64_t hot = random_slot(rng, dest);
+
+        for (uint64_t i = 0; i < dest->filled; i++)
+        {
+            dest->key[i] = random_reservoir_rekey(rng, dest, i, hot);
+            dest->heap[i] = i;
+        }
+
+        for (uint64_t i = dest->filled / 2; i-- > 0;)
+        {
+            heap_sift_down(dest, i);
+        }
+    }
+
+    //stream the source items through the destination heap
+    uint64_t hot = random_slot(rng, src);
+
+    for (uint64_t i = 0; i < src->filled; i++)
+    {
+        double key;
+
+        if (src->weighted) key = src->key[i];
+        else key = random_reservoir_rekey(rng, src, i, hot);
+
+        random_reservoir_insert(dest, key, SLOT(src, i));
+    }
+
+    dest->n += src->n;
+
+    //restart the skip state from the merged threshold, both are memoryless
+    if (dest->filled == dest->k)
+    {
+        if (dest->weighted) random_reservoir_jump(rng, dest);
+        else
+        {
+            dest->W = -expm1(dest->key[dest->heap[0]]);
+            dest->next = dest->n + random_reservoir_gap(rng, dest->W) + 1;
+        }
+    }
+
+    return RANDOM_SUCCESS;
+}
+
+/******************************************************************************/
+
+uint64_t random_reservoir_count(reservoir r)
+{
+    return r->filled;
+}
+
+/******************************************************************************/
+
+void *random_reservoir_get(reservoir r, uint64_t i)
+{
+    if (i >= r->filled) return NULL;
+
+    return SLOT(r, i);
+}